@@ -0,0 +1,295 @@
+// Copyright 2016 Zipscene, LLC
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+// Measures the cost of the Javascript and binding layers around running a network: the raw addon
+// object against ANN's wrappers, arrays against typed arrays, and single against batch and
+// asynchronous runs, on networks of a few sizes.  Reports the time, bytes allocated and GC time per
+// input, and inputs per second, and compares them with a baseline saved by an earlier run.
+//
+// Usage: npm run bench -- [options]
+//   (or node --expose-gc bench/binding-overhead.js; without --expose-gc allocations aren't measured)
+// Options:
+//   --min-time=seconds     time spent on each case (default 0.5)
+//   --filter=text          only run cases whose name contains text
+//   --baseline=file        baseline to compare with (default bench/binding-baseline.json, if it exists)
+//   --save-baseline[=file] save the results as the baseline
+//   --tolerance=fraction   slowdown from the baseline reported as a regression (default 0.2)
+//   --json                 print the results as JSON instead of a table
+// Exits with status 2 if any case regressed.
+
+var fs = require('fs');
+var path = require('path');
+var PerformanceObserver = require('perf_hooks').PerformanceObserver;
+var fanny = require('../lib/index');
+
+var BATCH_SIZE = 256;
+// Calls made while measuring allocations; few enough that a young generation GC is unlikely
+var ALLOCATION_CALLS = 200;
+var SIZES = [
+	{ name: 'small', layers: [ 4, 8, 2 ] },
+	{ name: 'medium', layers: [ 64, 128, 10 ] },
+	{ name: 'large', layers: [ 256, 512, 64 ] }
+];
+
+function parseArgs(argv) {
+	var options = {
+		minTime: 0.5,
+		filter: '',
+		baseline: path.join(__dirname, 'binding-baseline.json'),
+		saveBaseline: null,
+		tolerance: 0.2,
+		json: false
+	};
+	argv.forEach(function(arg) {
+		var eq = arg.indexOf('=');
+		var name = (eq === -1) ? arg : arg.slice(0, eq);
+		var value = (eq === -1) ? null : arg.slice(eq + 1);
+		if (name === '--min-time') options.minTime = Number(value);
+		else if (name === '--filter') options.filter = value;
+		else if (name === '--baseline') options.baseline = value;
+		else if (name === '--save-baseline') options.saveBaseline = value || options.baseline;
+		else if (name === '--tolerance') options.tolerance = Number(value);
+		else if (name === '--json') options.json = true;
+		else throw new Error('Unknown option ' + arg);
+	});
+	if (!(options.minTime > 0) || !(options.tolerance >= 0)) throw new Error('Invalid option value');
+	return options;
+}
+
+// Total time and number of garbage collections, from the time the observer was started
+var gcTotals = { count: 0, ms: 0 };
+var gcObserver = new PerformanceObserver(function(list) {
+	list.getEntries().forEach(function(entry) {
+		gcTotals.count++;
+		gcTotals.ms += entry.duration;
+	});
+});
+gcObserver.observe({ entryTypes: [ 'gc' ] });
+
+// GC entries are delivered asynchronously, so this waits for any from the last case
+function flushGcEntries() {
+	return new Promise(function(resolve) {
+		setImmediate(function() { setImmediate(resolve); });
+	});
+}
+
+function elapsedSeconds(start) {
+	var diff = process.hrtime(start);
+	return diff[0] + diff[1] / 1e9;
+}
+
+function allocatedBytes() {
+	var usage = process.memoryUsage();
+	return usage.heapUsed + usage.external;
+}
+
+// Returns the bytes allocated per call by fn(), or null if gc() isn't exposed.  Takes the smallest
+// of a few measurements, since one can include allocations by the runtime itself.
+function measureAllocations(fn) {
+	if (!global.gc) return null;
+	var i;
+	for (i = 0; i < ALLOCATION_CALLS; i++) fn();
+	var best = Infinity;
+	for (var attempt = 0; attempt < 3; attempt++) {
+		global.gc();
+		var before = allocatedBytes();
+		for (i = 0; i < ALLOCATION_CALLS; i++) fn();
+		best = Math.min(best, Math.max(0, allocatedBytes() - before) / ALLOCATION_CALLS);
+	}
+	return best;
+}
+
+// Calls fn() repeatedly for at least minTime seconds.  Resolves with the number of calls, the time
+// they took and the GC time during them.
+function timeSync(fn, minTime) {
+	for (var i = 0; i < 100; i++) fn();
+	return flushGcEntries().then(function() {
+		var gcBefore = gcTotals.ms;
+		var calls = 0;
+		var start = process.hrtime();
+		var elapsed;
+		do {
+			for (var j = 0; j < 100; j++) fn();
+			calls += 100;
+			elapsed = elapsedSeconds(start);
+		} while (elapsed < minTime);
+		return flushGcEntries().then(function() {
+			return { calls: calls, seconds: elapsed, gcMs: gcTotals.ms - gcBefore };
+		});
+	});
+}
+
+// Same, for a function returning a promise.  Each call waits for the previous one to finish, so
+// this measures the latency of a call including the round trip through the thread pool.
+function timeAsync(fn, minTime) {
+	var calls = 0;
+	var start, gcBefore;
+	function loop() {
+		return fn().then(function() {
+			calls++;
+			var elapsed = elapsedSeconds(start);
+			if (elapsed < minTime) return loop();
+			return flushGcEntries().then(function() {
+				return { calls: calls, seconds: elapsed, gcMs: gcTotals.ms - gcBefore };
+			});
+		});
+	}
+	return fn().then(flushGcEntries).then(function() {
+		gcBefore = gcTotals.ms;
+		start = process.hrtime();
+		return loop();
+	});
+}
+
+// Returns the cases for one network size.  perCall is the number of inputs each call runs, which
+// results are divided by so batch and single runs can be compared.
+function getCases(size) {
+	var ann = fanny.createANN({ layers: size.layers });
+	ann.randomizeWeights(-0.3, 0.3);
+	var numInput = ann.info.numInput;
+	var arrayInput = [];
+	for (var i = 0; i < numInput; i++) arrayInput.push(Math.sin(i * 0.37));
+	var typedInput = new Float32Array(arrayInput);
+	var typedOutput = new Float32Array(ann.info.numOutput);
+	var batchInputs = new Float32Array(numInput * BATCH_SIZE);
+	for (i = 0; i < batchInputs.length; i++) batchInputs[i] = Math.sin(i * 0.37);
+	var raw = ann._fanny;
+	function rawRunAsync() {
+		return new Promise(function(resolve, reject) {
+			raw.runAsync(arrayInput, function(err, res) {
+				if (err) return reject(err);
+				resolve(res);
+			});
+		});
+	}
+	return [
+		{ name: 'FANNY.run array (raw addon)', perCall: 1, fn: function() { raw.run(arrayInput); } },
+		{ name: 'ANN.run array', perCall: 1, fn: function() { ann.run(arrayInput); } },
+		{ name: 'ANN.run typed array', perCall: 1, fn: function() { ann.run(typedInput); } },
+		{ name: 'ANN.runInto', perCall: 1, fn: function() { ann.runInto(typedInput, typedOutput); } },
+		{ name: 'ANN.runArgmax', perCall: 1, fn: function() { ann.runArgmax(typedInput); } },
+		{ name: 'ANN.runBatch x' + BATCH_SIZE, perCall: BATCH_SIZE, fn: function() { ann.runBatch(batchInputs, BATCH_SIZE); } },
+		{ name: 'FANNY.runAsync (raw addon)', perCall: 1, async: true, fn: rawRunAsync },
+		{ name: 'ANN.runAsync', perCall: 1, async: true, fn: function() { return ann.runAsync(arrayInput); } },
+		{ name: 'ANN.runBatchAsync x' + BATCH_SIZE, perCall: BATCH_SIZE, async: true, fn: function() {
+			return ann.runBatchAsync(batchInputs, BATCH_SIZE);
+		} }
+	];
+}
+
+function runCase(size, testCase, options) {
+	var allocations = testCase.async ? null : measureAllocations(testCase.fn);
+	var timing = testCase.async ? timeAsync(testCase.fn, options.minTime) : timeSync(testCase.fn, options.minTime);
+	return timing.then(function(t) {
+		var inputs = t.calls * testCase.perCall;
+		return {
+			size: size.name,
+			layers: size.layers,
+			name: testCase.name,
+			inputsPerCall: testCase.perCall,
+			nsPerInput: t.seconds * 1e9 / inputs,
+			inputsPerSec: inputs / t.seconds,
+			bytesPerInput: (allocations === null) ? null : allocations / testCase.perCall,
+			gcNsPerInput: t.gcMs * 1e6 / inputs
+		};
+	});
+}
+
+function resultKey(result) {
+	return result.size + '/' + result.name;
+}
+
+// Marks results slower than the baseline by more than the tolerance, or allocating more
+function compareWithBaseline(results, baseline, tolerance) {
+	var byKey = {};
+	baseline.results.forEach(function(result) { byKey[resultKey(result)] = result; });
+	var regressions = 0;
+	results.forEach(function(result) {
+		var base = byKey[resultKey(result)];
+		if (!base) return;
+		result.baselineNsPerInput = base.nsPerInput;
+		result.change = result.nsPerInput / base.nsPerInput - 1;
+		// Allocation measurements vary by a few bytes between runs
+		var moreAllocation = result.bytesPerInput !== null && base.bytesPerInput !== null &&
+			result.bytesPerInput > base.bytesPerInput * (1 + tolerance) + 16;
+		result.regressed = result.change > tolerance || moreAllocation;
+		if (result.regressed) regressions++;
+	});
+	return regressions;
+}
+
+function pad(value, width) {
+	var str = String(value);
+	while (str.length < width) str = ' ' + str;
+	return str;
+}
+
+function printTable(results) {
+	console.log(
+		'size    case                               ns/input    inputs/sec  bytes/input  gc ns/input  vs baseline'
+	);
+	results.forEach(function(r) {
+		var change = (r.change === undefined) ? '' : ((r.change >= 0 ? '+' : '') + (r.change * 100).toFixed(1) + '%');
+		if (r.regressed) change += '  REGRESSION';
+		console.log(
+			(r.size + '        ').slice(0, 8) +
+			(r.name + '                                   ').slice(0, 33) +
+			pad(r.nsPerInput.toFixed(1), 11) +
+			pad(Math.round(r.inputsPerSec), 14) +
+			pad((r.bytesPerInput === null) ? '-' : r.bytesPerInput.toFixed(0), 13) +
+			pad(r.gcNsPerInput.toFixed(1), 13) +
+			'  ' + change
+		);
+	});
+}
+
+function main() {
+	var options = parseArgs(process.argv.slice(2));
+	var work = [];
+	SIZES.forEach(function(size) {
+		getCases(size).forEach(function(testCase) {
+			if (options.filter && (size.name + '/' + testCase.name).indexOf(options.filter) === -1) return;
+			work.push({ size: size, testCase: testCase });
+		});
+	});
+	var results = [];
+	return work.reduce(function(prev, item) {
+		return prev.then(function() {
+			return runCase(item.size, item.testCase, options).then(function(result) {
+				results.push(result);
+			});
+		});
+	}, Promise.resolve()).then(function() {
+		gcObserver.disconnect();
+		var regressions = 0;
+		if (!options.saveBaseline && fs.existsSync(options.baseline)) {
+			regressions = compareWithBaseline(results, JSON.parse(fs.readFileSync(options.baseline, 'utf8')), options.tolerance);
+		}
+		var report = {
+			node: process.version,
+			gcExposed: !!global.gc,
+			minTime: options.minTime,
+			results: results
+		};
+		if (options.json) {
+			console.log(JSON.stringify(report, null, '\t'));
+		} else {
+			printTable(results);
+			if (!global.gc) console.log('Run with node --expose-gc to measure allocations');
+		}
+		if (options.saveBaseline) {
+			fs.writeFileSync(options.saveBaseline, JSON.stringify(report, null, '\t') + '\n');
+			if (!options.json) console.log('Saved baseline to ' + options.saveBaseline);
+		}
+		if (regressions) {
+			console.error(regressions + ' case(s) regressed from the baseline');
+			process.exitCode = 2;
+		}
+	});
+}
+
+main().catch(function(err) {
+	console.error(err);
+	process.exit(1);
+});
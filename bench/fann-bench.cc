@@ -0,0 +1,333 @@
+// Copyright 2016 Zipscene, LLC
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+// Native micro-benchmarks of FANN itself, without Node or the addon in the way.  Built by binding.gyp
+// as bench-floatfann, bench-doublefann and bench-fixedfann when configured with --fanny_bench=1
+// ("npm run build:bench" does this).  Measures running, training and testing networks of several
+// topologies on datasets of several sizes, loading and saving networks, and TrainingData operations,
+// and writes the results to stdout as JSON so they can be compared between releases.
+//
+// Usage: bench-floatfann [--min-time=seconds] [--sizes=n,n,...] [--filter=text] [--tmp-dir=dir]
+
+#include "fann-includes.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+#if defined FANNY_FLOAT
+const char *DATATYPE = "float";
+#elif defined FANNY_DOUBLE
+const char *DATATYPE = "double";
+#else
+const char *DATATYPE = "fixed";
+#endif
+
+struct Topology {
+	const char *name;
+	FANN::network_type_enum type;
+	// Only used by sparse networks
+	float connectionRate;
+	std::vector<unsigned int> layers;
+};
+
+std::vector<Topology> getTopologies() {
+	std::vector<Topology> topologies;
+	Topology tiny = { "tiny", FANN::LAYER, 1, { 2, 4, 1 } };
+	Topology wide = { "wide", FANN::LAYER, 1, { 64, 512, 10 } };
+	Topology deep = { "deep", FANN::LAYER, 1, { 32, 64, 64, 64, 64, 64, 10 } };
+	Topology sparse = { "sparse", FANN::LAYER, 0.25f, { 64, 256, 256, 10 } };
+	Topology shortcut = { "shortcut", FANN::SHORTCUT, 1, { 16, 32, 32, 4 } };
+	topologies.push_back(tiny);
+	topologies.push_back(wide);
+	topologies.push_back(deep);
+	topologies.push_back(sparse);
+	topologies.push_back(shortcut);
+	return topologies;
+}
+
+struct Options {
+	double minTime;
+	std::vector<unsigned int> sizes;
+	std::string filter;
+	std::string tmpDir;
+};
+
+// Result of timing one operation
+struct Measurement {
+	// Calls per round and number of rounds
+	unsigned long iterations;
+	unsigned int rounds;
+	// Median and fastest round, per call
+	double nsPerOp;
+	double minNsPerOp;
+};
+
+double nowNs() {
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Times fn() in rounds of enough calls to take a fifth of minTime each, for at least five rounds
+// and minTime in total
+template<typename Fn>
+Measurement measure(Fn fn, double minTime) {
+	static const unsigned int MIN_ROUNDS = 5;
+	double roundNs = minTime * 1e9 / MIN_ROUNDS;
+	// Warm up, and find how many calls fill a round
+	unsigned long iterations = 1;
+	for (;;) {
+		double start = nowNs();
+		for (unsigned long i = 0; i < iterations; i++) fn();
+		double elapsed = nowNs() - start;
+		if (elapsed >= roundNs || iterations >= (1UL << 30)) break;
+		double scale = (elapsed > 0) ? roundNs / elapsed : 10;
+		iterations = (unsigned long)std::ceil(iterations * std::min(std::max(scale, 1.5), 10.0));
+	}
+	std::vector<double> perOp;
+	double total = 0;
+	while (perOp.size() < MIN_ROUNDS || total < minTime * 1e9) {
+		double start = nowNs();
+		for (unsigned long i = 0; i < iterations; i++) fn();
+		double elapsed = nowNs() - start;
+		total += elapsed;
+		perOp.push_back(elapsed / iterations);
+	}
+	std::sort(perOp.begin(), perOp.end());
+	Measurement m;
+	m.iterations = iterations;
+	m.rounds = (unsigned int)perOp.size();
+	m.nsPerOp = perOp[perOp.size() / 2];
+	m.minNsPerOp = perOp[0];
+	return m;
+}
+
+// Collects results and writes them as JSON
+class Report {
+public:
+	explicit Report(const Options &_options) : options(_options), first(true) {
+		printf("{\n\t\"benchmark\": \"fann-native\",\n\t\"datatype\": \"%s\",\n\t\"minTime\": %g,\n\t\"results\": [", DATATYPE, options.minTime);
+	}
+
+	~Report() {
+		printf("\n\t]\n}\n");
+	}
+
+	// Returns whether a benchmark with the given name and topology should run
+	bool enabled(const std::string &name, const std::string &topology) const {
+		return options.filter.empty() || (name + "/" + topology).find(options.filter) != std::string::npos;
+	}
+
+	// samples is the dataset size, or 0 for benchmarks without one
+	void add(const std::string &name, const Topology *topology, unsigned int samples, const Measurement &m) {
+		printf("%s\n\t\t{ \"name\": \"%s\", \"topology\": \"%s\", \"layers\": [", first ? "" : ",", name.c_str(), topology ? topology->name : "");
+		if (topology) {
+			for (size_t i = 0; i < topology->layers.size(); i++) printf("%s%u", i ? ", " : "", topology->layers[i]);
+		}
+		printf("], \"samples\": %u, \"iterations\": %lu, \"rounds\": %u, \"nsPerOp\": %.1f, \"minNsPerOp\": %.1f, \"opsPerSec\": %.3f",
+			samples, m.iterations, m.rounds, m.nsPerOp, m.minNsPerOp, 1e9 / m.nsPerOp);
+		if (samples) printf(", \"nsPerSample\": %.2f", m.nsPerOp / samples);
+		printf(" }");
+		fflush(stdout);
+		fprintf(stderr, "%-14s %-9s %7u  %14.1f ns/op\n", name.c_str(), topology ? topology->name : "", samples, m.nsPerOp);
+		first = false;
+	}
+
+private:
+	const Options &options;
+	bool first;
+};
+
+// Multiplier of fixed point values in datasets not used with a network
+const unsigned int DATA_MULTIPLIER = 1 << 13;
+
+// Returns the multiplier of the network's fixed point values, or 1 for floating point networks
+unsigned int getMultiplier(FANN::neural_net *net) {
+	#ifdef FANNY_FIXED
+	return net->get_multiplier();
+	#else
+	return 1;
+	#endif
+}
+
+// Converts a value between -1 and 1 to fann_type
+fann_type toFannType(double value, unsigned int multiplier) {
+	#ifdef FANNY_FIXED
+	return (fann_type)std::floor(value * multiplier + 0.5);
+	#else
+	return (fann_type)value;
+	#endif
+}
+
+// Fills data with samples of numInput inputs and numOutput outputs that are always the same
+void fillDataset(FANN::training_data &data, unsigned int samples, unsigned int numInput, unsigned int numOutput, unsigned int multiplier) {
+	std::vector<fann_type> inputs((size_t)samples * numInput);
+	std::vector<fann_type> outputs((size_t)samples * numOutput);
+	for (size_t i = 0; i < inputs.size(); i++) inputs[i] = toFannType(std::sin(i * 0.37), multiplier);
+	for (size_t i = 0; i < outputs.size(); i++) outputs[i] = toFannType(std::cos(i * 0.11), multiplier);
+	data.set_train_data(samples, numInput, &inputs[0], numOutput, &outputs[0]);
+}
+
+FANN::neural_net *createNet(const Topology &topology) {
+	FANN::neural_net *net;
+	if (topology.connectionRate < 1) {
+		net = new FANN::neural_net(topology.connectionRate, (unsigned int)topology.layers.size(), &topology.layers[0]);
+	} else {
+		net = new FANN::neural_net(topology.type, (unsigned int)topology.layers.size(), &topology.layers[0]);
+	}
+	net->set_activation_function_hidden(FANN::SIGMOID_SYMMETRIC);
+	net->set_activation_function_output(FANN::SIGMOID_SYMMETRIC);
+	unsigned int multiplier = getMultiplier(net);
+	net->randomize_weights(toFannType(-0.3, multiplier), toFannType(0.3, multiplier));
+	return net;
+}
+
+void benchNetworks(Report &report, const Options &options) {
+	std::vector<Topology> topologies = getTopologies();
+	for (size_t t = 0; t < topologies.size(); t++) {
+		const Topology &topology = topologies[t];
+		FANN::neural_net *net = createNet(topology);
+		unsigned int numInput = net->get_num_input();
+		unsigned int numOutput = net->get_num_output();
+		unsigned int multiplier = getMultiplier(net);
+
+		if (report.enabled("run", topology.name)) {
+			std::vector<fann_type> input(numInput);
+			for (unsigned int i = 0; i < numInput; i++) input[i] = toFannType(std::sin(i * 0.37), multiplier);
+			report.add("run", &topology, 0, measure([&]() { net->run(&input[0]); }, options.minTime));
+		}
+
+		for (size_t s = 0; s < options.sizes.size(); s++) {
+			unsigned int samples = options.sizes[s];
+			FANN::training_data data;
+			fillDataset(data, samples, numInput, numOutput, multiplier);
+			if (report.enabled("test_data", topology.name)) {
+				report.add("test_data", &topology, samples, measure([&]() { net->test_data(data); }, options.minTime));
+			}
+			#ifndef FANNY_FIXED
+			if (report.enabled("train_epoch", topology.name)) {
+				// Trains a copy so later benchmarks see the original weights
+				FANN::neural_net trained(*net);
+				report.add("train_epoch", &topology, samples, measure([&]() { trained.train_epoch(data); }, options.minTime));
+			}
+			#endif
+		}
+
+		std::string filename = options.tmpDir + "/fann-bench-" + std::to_string(getpid()) + ".net";
+		if (report.enabled("save", topology.name)) {
+			report.add("save", &topology, 0, measure([&]() { net->save(filename); }, options.minTime));
+		}
+		if (report.enabled("load", topology.name)) {
+			net->save(filename);
+			report.add("load", &topology, 0, measure([&]() { FANN::neural_net loaded(filename); }, options.minTime));
+		}
+		unlink(filename.c_str());
+		delete net;
+	}
+}
+
+void benchTrainingData(Report &report, const Options &options) {
+	// Datasets shaped for the wide topology
+	static const unsigned int NUM_INPUT = 64;
+	static const unsigned int NUM_OUTPUT = 10;
+	std::string filename = options.tmpDir + "/fann-bench-" + std::to_string(getpid()) + ".data";
+	for (size_t s = 0; s < options.sizes.size(); s++) {
+		unsigned int samples = options.sizes[s];
+		FANN::training_data data;
+		fillDataset(data, samples, NUM_INPUT, NUM_OUTPUT, DATA_MULTIPLIER);
+		if (report.enabled("data_create", "")) {
+			report.add("data_create", NULL, samples, measure([&]() {
+				FANN::training_data created;
+				fillDataset(created, samples, NUM_INPUT, NUM_OUTPUT, DATA_MULTIPLIER);
+			}, options.minTime));
+		}
+		if (report.enabled("data_shuffle", "")) {
+			report.add("data_shuffle", NULL, samples, measure([&]() { data.shuffle_train_data(); }, options.minTime));
+		}
+		if (report.enabled("data_scale", "")) {
+			report.add("data_scale", NULL, samples, measure([&]() { data.scale_train_data(toFannType(-1, DATA_MULTIPLIER), toFannType(1, DATA_MULTIPLIER)); }, options.minTime));
+		}
+		if (report.enabled("data_subset", "")) {
+			report.add("data_subset", NULL, samples, measure([&]() {
+				FANN::training_data subset(data);
+				subset.subset_train_data(0, samples / 2);
+			}, options.minTime));
+		}
+		if (report.enabled("data_merge", "")) {
+			report.add("data_merge", NULL, samples, measure([&]() {
+				FANN::training_data merged(data);
+				merged.merge_train_data(data);
+			}, options.minTime));
+		}
+		if (report.enabled("data_save", "")) {
+			report.add("data_save", NULL, samples, measure([&]() { data.save_train(filename); }, options.minTime));
+		}
+		if (report.enabled("data_read", "")) {
+			data.save_train(filename);
+			report.add("data_read", NULL, samples, measure([&]() {
+				FANN::training_data read;
+				read.read_train_from_file(filename);
+			}, options.minTime));
+		}
+	}
+	unlink(filename.c_str());
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+	options.minTime = 0.5;
+	options.sizes.push_back(256);
+	options.sizes.push_back(4096);
+	const char *tmpDir = getenv("TMPDIR");
+	options.tmpDir = (tmpDir && *tmpDir) ? tmpDir : "/tmp";
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		size_t eq = arg.find('=');
+		std::string name = arg.substr(0, eq);
+		std::string value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+		if (name == "--min-time") {
+			options.minTime = atof(value.c_str());
+			if (!(options.minTime > 0)) return false;
+		} else if (name == "--sizes") {
+			options.sizes.clear();
+			for (size_t pos = 0; pos <= value.size();) {
+				size_t comma = value.find(',', pos);
+				if (comma == std::string::npos) comma = value.size();
+				unsigned int size = (unsigned int)atoi(value.substr(pos, comma - pos).c_str());
+				if (!size) return false;
+				options.sizes.push_back(size);
+				pos = comma + 1;
+			}
+		} else if (name == "--filter") {
+			options.filter = value;
+		} else if (name == "--tmp-dir") {
+			options.tmpDir = value;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+int main(int argc, char **argv) {
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		fprintf(stderr, "Usage: %s [--min-time=seconds] [--sizes=n,n,...] [--filter=text] [--tmp-dir=dir]\n", argv[0]);
+		return 1;
+	}
+	// Networks get the same random weights on every run
+	fann_disable_seed_rand();
+	srand(1);
+	Report report(options);
+	benchNetworks(report, options);
+	benchTrainingData(report, options);
+	return 0;
+}
@@ -0,0 +1,76 @@
+// Copyright 2016 Zipscene, LLC
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+// Compares inference speed of the fixed point addon with the float addon on the same network,
+// with both the FANN and SIMD engines.
+// Usage: node bench/fixed-vs-float.js [layer sizes...]   (default: 64 256 256 16)
+
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+var fanny = require('../lib/index');
+
+var layers = process.argv.slice(2).map(Number);
+if (!layers.length) layers = [ 64, 256, 256, 16 ];
+var numRuns = 1000;
+var minSeconds = 1;
+
+// Runs fn repeatedly for at least minSeconds and returns the average time per call, in seconds
+function time(fn) {
+	fn();
+	var calls = 0;
+	var start = process.hrtime();
+	var elapsed;
+	do {
+		fn();
+		calls++;
+		var diff = process.hrtime(start);
+		elapsed = diff[0] + diff[1] / 1e9;
+	} while (elapsed < minSeconds);
+	return elapsed / calls;
+}
+
+var floatAnn = fanny.createANN({ layers: layers, activationFunctions: { hidden: 'SIGMOID_SYMMETRIC', output: 'SIGMOID_SYMMETRIC' } });
+floatAnn.randomizeWeights(-0.3, 0.3);
+var filename = path.join(os.tmpdir(), 'fanny-bench-' + process.pid + '.net');
+
+floatAnn.save(filename, true)
+	.then(function() {
+		return fanny.loadANN(filename, 'fixed');
+	})
+	.then(function(fixedAnn) {
+		fs.unlinkSync(filename);
+		var numInput = layers[0];
+		var floatInputs = new Float32Array(numRuns * numInput);
+		var fixedInputs = new Int32Array(numRuns * numInput);
+		for (var i = 0; i < floatInputs.length; i++) {
+			floatInputs[i] = Math.sin(i * 0.37);
+			fixedInputs[i] = Math.round(floatInputs[i] * fixedAnn.info.multiplier);
+		}
+		var nets = [
+			{ name: 'float', ann: floatAnn, inputs: floatInputs },
+			{ name: 'fixed', ann: fixedAnn, inputs: fixedInputs }
+		];
+
+		console.log('layers ' + layers.join('-') + ', SIMD level ' + fanny.getSimdLevel('fixed'));
+		console.log('datatype  engine  run() us   runBatch() us/input');
+		[ 'fann', 'simd' ].forEach(function(engine) {
+			nets.forEach(function(net) {
+				net.ann.setOption('engine', engine);
+				var single = net.inputs.subarray(0, numInput);
+				var runTime = time(function() { net.ann.run(single); });
+				var batchTime = time(function() { net.ann.runBatch(net.inputs, numRuns); }) / numRuns;
+				console.log(
+					(net.name + '     ').slice(0, 10) +
+					(engine + '    ').slice(0, 8) +
+					(runTime * 1e6).toFixed(2) + '      ' +
+					(batchTime * 1e6).toFixed(2)
+				);
+			});
+		});
+	})
+	.catch(function(err) {
+		console.error(err);
+		process.exit(1);
+	});
@@ -1,4 +1,8 @@
 {
+	"variables": {
+		# Set to 1 to also build the native benchmarks in bench/fann-bench.cc
+		"fanny_bench%": 0
+	},
 	"targets": [
 		{
 			"target_name": "addon-floatfann",
@@ -6,7 +10,21 @@
 				"src/addon.cc",
 				"src/fanny.cc",
 				"src/utils.cc",
-				"src/training-data.cc"
+				"src/training-data.cc",
+				"src/compiled-net.cc",
+				"src/quantized-net.cc",
+				"src/simd-kernels.cc",
+				"src/source-generator.cc",
+				"src/small-net.cc",
+				"src/weight-snapshot.cc",
+				"src/addon-data.cc",
+				"src/shared-net.cc",
+				"src/ensemble.cc",
+				"src/prediction-cache.cc",
+				"src/output-reduction.cc",
+				"src/latency-histogram.cc",
+				"src/parallel-trainer.cc",
+				"src/mini-batch-trainer.cc"
 			],
 			"libraries": [
 				"../fann/lib/libfloatfann.a"
@@ -23,7 +41,21 @@
 				"src/addon.cc",
 				"src/fanny.cc",
 				"src/utils.cc",
-				"src/training-data.cc"
+				"src/training-data.cc",
+				"src/compiled-net.cc",
+				"src/quantized-net.cc",
+				"src/simd-kernels.cc",
+				"src/source-generator.cc",
+				"src/small-net.cc",
+				"src/weight-snapshot.cc",
+				"src/addon-data.cc",
+				"src/shared-net.cc",
+				"src/ensemble.cc",
+				"src/prediction-cache.cc",
+				"src/output-reduction.cc",
+				"src/latency-histogram.cc",
+				"src/parallel-trainer.cc",
+				"src/mini-batch-trainer.cc"
 			],
 			"libraries": [
 				"../fann/lib/libdoublefann.a"
@@ -40,7 +72,21 @@
 				"src/addon.cc",
 				"src/fanny.cc",
 				"src/utils.cc",
-				"src/training-data.cc"
+				"src/training-data.cc",
+				"src/compiled-net.cc",
+				"src/quantized-net.cc",
+				"src/simd-kernels.cc",
+				"src/source-generator.cc",
+				"src/small-net.cc",
+				"src/weight-snapshot.cc",
+				"src/addon-data.cc",
+				"src/shared-net.cc",
+				"src/ensemble.cc",
+				"src/prediction-cache.cc",
+				"src/output-reduction.cc",
+				"src/latency-histogram.cc",
+				"src/parallel-trainer.cc",
+				"src/mini-batch-trainer.cc"
 			],
 			"libraries": [
 				"../fann/lib/libfixedfann.a"
@@ -52,5 +98,53 @@
 			"cflags_cc": [ "-fPIC" ]
 		}
 
+	],
+	"conditions": [
+		[ "fanny_bench==1", {
+			"targets": [
+				{
+					"target_name": "bench-floatfann",
+					"type": "executable",
+					"sources": [
+						"bench/fann-bench.cc"
+					],
+					"libraries": [
+						"../fann/lib/libfloatfann.a"
+					],
+					"include_dirs": [ "src", "fann/include" ],
+					"defines": [
+						"FANNY_FLOAT"
+					]
+				},
+				{
+					"target_name": "bench-doublefann",
+					"type": "executable",
+					"sources": [
+						"bench/fann-bench.cc"
+					],
+					"libraries": [
+						"../fann/lib/libdoublefann.a"
+					],
+					"include_dirs": [ "src", "fann/include" ],
+					"defines": [
+						"FANNY_DOUBLE"
+					]
+				},
+				{
+					"target_name": "bench-fixedfann",
+					"type": "executable",
+					"sources": [
+						"bench/fann-bench.cc"
+					],
+					"libraries": [
+						"../fann/lib/libfixedfann.a"
+					],
+					"include_dirs": [ "src", "fann/include" ],
+					"defines": [
+						"FANNY_FIXED"
+					]
+				}
+			]
+		} ]
 	]
 }
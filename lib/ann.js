@@ -8,6 +8,7 @@ var XError = require('xerror');
 var utils = require('./utils');
 var createTrainingData = require('./training-data').createTrainingData;
 var pasync = require('pasync');
+var RunStream = require('./run-stream');
 var ACTIVATION_FUNCTIONS = [
 	'LINEAR', 'THRESHOLD', 'THRESHOLD_SYMMETRIC', 'SIGMOID', 'SIGMOID_STEPWISE',
 	'SIGMOID_SYMMETRIC', 'SIGMOID_SYMMETRIC_STEPWISE', 'GAUSSIAN', 'GAUSSIAN_SYMMETRIC',
@@ -66,11 +67,15 @@ var annConfigSchema = createSchema({
 var annOptionsSchema = createSchema({
 	trainingAlgorithm: {
 		type: String,
-		enum: [ 'INCREMENTAL', 'BATCH', 'RPROP', 'QUICKPROP', 'SARPROP' ]
+		enum: [ 'INCREMENTAL', 'BATCH', 'RPROP', 'QUICKPROP', 'SARPROP', 'MINIBATCH' ]
 	},
 	learningRate: {
 		type: Number
 	},
+	batchSize: {
+		type: Number,
+		min: 1
+	},
 	trainErrorFunction: {
 		type: String,
 		enum: [ 'LINEAR', 'TANH' ]
@@ -171,6 +176,36 @@ var annOptionsSchema = createSchema({
 	},
 	userDataString: {
 		type: String
+	},
+	runConcurrency: {
+		type: Number,
+		min: 1
+	},
+	engine: {
+		type: String,
+		enum: [ 'fann', 'simd' ]
+	},
+	activationMode: {
+		type: String,
+		enum: [ 'exact', 'fast' ]
+	},
+	predictionCache: {
+		type: 'object',
+		properties: {
+			maxBytes: {
+				type: Number,
+				required: true,
+				min: 0
+			},
+			quantum: {
+				type: Number,
+				default: 0,
+				min: 0
+			}
+		}
+	},
+	collectStats: {
+		type: Boolean
 	}
 });
 
@@ -200,36 +235,56 @@ function wrapThrows(fn) {
 	};
 }
 
+// Starts queued operations.  Operations normally run one at a time, but consecutive concurrent
+// operations (runs) may run alongside each other, up to the runConcurrency option.
 function nextQueueOp(ann) {
-	if (ann._opQueue.length) {
-		ann._currentlyRunning = true;
-		var op = ann._opQueue.shift();
-		var promise;
-		try {
-			promise = op.fn.apply(ann, op.args);
-		} catch (ex) {
-			op.waiter.reject(ex);
-			nextQueueOp(ann);
-			return;
-		}
-		if (!promise || typeof promise.then !== 'function') {
-			op.waiter.resolve(promise);
-			nextQueueOp(ann);
-			return;
+	while (ann._opQueue.length) {
+		var op = ann._opQueue[0];
+		if (ann._runningOps) {
+			if (!op.concurrent || ann._runningExclusive) break;
+			if (ann._runningOps >= ann._fanny.getRunConcurrency()) break;
 		}
-		promise.then(function(res) {
-			op.waiter.resolve(res);
-			nextQueueOp(ann);
-		}, function(err) {
-			op.waiter.reject(err);
-			nextQueueOp(ann);
-		}).catch(pasync.abort);
-	} else {
-		ann._currentlyRunning = false;
+		ann._opQueue.shift();
+		startQueueOp(ann, op);
+	}
+	ann._currentlyRunning = ann._runningOps > 0;
+}
+
+function startQueueOp(ann, op) {
+	ann._runningOps++;
+	ann._currentlyRunning = true;
+	if (!op.concurrent) ann._runningExclusive = true;
+	var finish = function() {
+		ann._runningOps--;
+		if (!op.concurrent) ann._runningExclusive = false;
+	};
+	var promise;
+	try {
+		promise = op.fn.apply(ann, op.args);
+	} catch (ex) {
+		finish();
+		op.waiter.reject(ex);
+		nextQueueOp(ann);
+		return;
 	}
+	if (!promise || typeof promise.then !== 'function') {
+		finish();
+		op.waiter.resolve(promise);
+		nextQueueOp(ann);
+		return;
+	}
+	promise.then(function(res) {
+		finish();
+		op.waiter.resolve(res);
+		nextQueueOp(ann);
+	}, function(err) {
+		finish();
+		op.waiter.reject(err);
+		nextQueueOp(ann);
+	}).catch(pasync.abort);
 }
 
-function asyncOpQueue(fn) {
+function asyncOpQueue(fn, concurrent) {
 	fn = wrapThrows(fn);
 	return function() {
 		var self = this;
@@ -237,9 +292,10 @@ function asyncOpQueue(fn) {
 		self._opQueue.push({
 			fn: fn,
 			args: Array.prototype.slice.call(arguments, 0),
-			waiter: waiter
+			waiter: waiter,
+			concurrent: !!concurrent
 		});
-		if (!self._currentlyRunning) nextQueueOp(self);
+		nextQueueOp(self);
 		return waiter.promise;
 	};
 };
@@ -260,9 +316,27 @@ function ANN(fanny, datatype) {
 	this._recalculateInfo();
 	this._opQueue = [];
 	this._currentlyRunning = false;
+	this._runningOps = 0;
+	this._runningExclusive = false;
+	this._microBatching = null;
 	var userDataString = this.getOption('userDataString');
 	if (userDataString && userDataString[0] === '{') {
 		this.userData = JSON.parse(userDataString);
+		restoreTrainingSettings(this);
+	}
+}
+
+// FANN's file format has no MINIBATCH algorithm (FANN trains it as BATCH), so save() records it and
+// the batch size in the user data string under this key, and loading restores them
+var TRAINING_SETTINGS_KEY = '_fannyTraining';
+
+function restoreTrainingSettings(ann) {
+	var settings = ann.userData[TRAINING_SETTINGS_KEY];
+	if (!settings) return;
+	delete ann.userData[TRAINING_SETTINGS_KEY];
+	if (settings.trainingAlgorithm === 'MINIBATCH' && ann._fanny.getTrainingAlgorithm() === 'TRAIN_BATCH') {
+		ann._fanny.setTrainingAlgorithm('TRAIN_MINIBATCH');
+		if (settings.batchSize >= 1) ann._fanny.setBatchSize(settings.batchSize);
 	}
 }
 
@@ -399,6 +473,15 @@ var annOptionFunctions = {
 		}
 	},
 
+	batchSize: {
+		setValue: function(value) {
+			this._fanny.setBatchSize(value);
+		},
+		getValue: function() {
+			return this._fanny.getBatchSize();
+		}
+	},
+
 	learningMomentum: {
 		setValue: function(value) {
 			this._fanny.setLearningMomentum(value);
@@ -536,6 +619,49 @@ var annOptionFunctions = {
 		getValue: function() {
 			return this._fanny.getUserDataString();
 		}
+	},
+	runConcurrency: {
+		setValue: function(value) {
+			this._fanny.setRunConcurrency(value);
+		},
+		getValue: function() {
+			return this._fanny.getRunConcurrency();
+		}
+	},
+	engine: {
+		setValue: function(value) {
+			this._fanny.setEngine(value);
+		},
+		getValue: function() {
+			return this._fanny.getEngine();
+		}
+	},
+	activationMode: {
+		setValue: function(value) {
+			this._fanny.setActivationMode(value);
+		},
+		getValue: function() {
+			return this._fanny.getActivationMode();
+		}
+	},
+	predictionCache: {
+		setValue: function(value) {
+			this._fanny.setPredictionCache(value.maxBytes, value.quantum);
+		},
+		getValue: function() {
+			return {
+				maxBytes: this._fanny.getPredictionCacheSize(),
+				quantum: this._fanny.getPredictionCacheQuantum()
+			};
+		}
+	},
+	collectStats: {
+		setValue: function(value) {
+			this._fanny.setStatsEnabled(value);
+		},
+		getValue: function() {
+			return this._fanny.getStatsEnabled();
+		}
 	}
 };
 
@@ -573,6 +699,39 @@ ANN.prototype.clone = blockOnAsync(function() {
 	return new ANN(fanny, this._datatype);
 });
 
+// Copies the network's layout and weights into a new SharedArrayBuffer.  Pass it to worker threads
+// and attach to it there with attachANN() to run the model without a copy of its weights per thread.
+ANN.prototype.exportShared = blockOnAsync(function() {
+	if (typeof SharedArrayBuffer === 'undefined') {
+		throw new XError(XError.UNSUPPORTED_OPERATION, 'SharedArrayBuffer is not available');
+	}
+	var buffer = new SharedArrayBuffer(this._fanny.getSharedSize());
+	this._fanny.exportShared(new Uint8Array(buffer));
+	return buffer;
+});
+
+// Returns the prediction cache's hits and misses since the last reset, and its number of entries
+// and approximate size in bytes
+ANN.prototype.getPredictionCacheStats = function() {
+	return this._fanny.getPredictionCacheStats();
+};
+
+ANN.prototype.resetPredictionCacheStats = function() {
+	this._fanny.resetPredictionCacheStats();
+};
+
+// Returns latency histograms recorded while the collectStats option is set, or null if it isn't.
+// run covers synchronous runs, runQueue and runExecute the time asynchronous runs spend queued and
+// running, and trainEpoch training epochs.  Each has the count and the mean, p50, p90, p99 and max
+// in milliseconds.
+ANN.prototype.getStats = function() {
+	return this._fanny.getStats();
+};
+
+ANN.prototype.resetStats = function() {
+	this._fanny.resetStats();
+};
+
 ANN.prototype._recalculateInfo = function() {
 	this.info = {};
 	var fns = {
@@ -584,7 +743,9 @@ ANN.prototype._recalculateInfo = function() {
 		multiplier: 'getMultiplier',
 		networkType: 'getNetworkType',
 		connectionRate: 'getConnectionRate',
-		numLayers: 'getNumLayers'
+		numLayers: 'getNumLayers',
+		specializedKernel: 'getSpecializedKernel',
+		shared: 'isShared'
 	};
 	for (var key in fns) {
 		if (this._fanny[fns[key]]) {
@@ -595,14 +756,27 @@ ANN.prototype._recalculateInfo = function() {
 
 ANN.prototype.save = asyncOpQueue(function(filename, toFixed) {
 	var self = this;
+	var curUserDataString = self.getOption('userDataString');
+	var isJSON = !curUserDataString || curUserDataString[0] === '{';
+	var isMiniBatch = self.getOption('trainingAlgorithm') === 'MINIBATCH';
+	if (isMiniBatch && !isJSON) {
+		throw new XError(XError.INVALID_ARGUMENT, 'MINIBATCH can only be saved along with JSON user data');
+	}
 	return new Promise(function(resolve, reject) {
 		var cb = function(err) {
+			// The settings only belong in the file
+			if (isMiniBatch) self._fanny.setUserDataString(JSON.stringify(self.userData));
 			if (err) return reject(err);
 			resolve();
 		};
-		var curUserDataString = self.getOption('userDataString');
-		if (!curUserDataString || curUserDataString[0] === '{') {
-			self._fanny.setUserDataString(JSON.stringify(self.userData));
+		if (isJSON) {
+			var userData = self.userData;
+			if (isMiniBatch) {
+				userData = {};
+				for (var key in self.userData) userData[key] = self.userData[key];
+				userData[TRAINING_SETTINGS_KEY] = { trainingAlgorithm: 'MINIBATCH', batchSize: self.getOption('batchSize') };
+			}
+			self._fanny.setUserDataString(JSON.stringify(userData));
 		}
 		if (toFixed) {
 			self._fanny.saveToFixed(filename, cb);
@@ -616,6 +790,12 @@ ANN.prototype.save = asyncOpQueue(function(filename, toFixed) {
 // options can include: maxEpochs, progressInterval (in epochs), desiredError, cascade (boolean true for cascade training),
 //   maxNeurons (for cascade training), stopFunction (either "MSE" or "BIT").  Without supplying an options object, this
 //   only trains a single epoch.
+// options.threads (default 1) trains on several threads when training on data with the BATCH, RPROP, QUICKPROP or
+//   SARPROP algorithm.  Each epoch splits the data between the threads.  It's ignored for other algorithms.
+// options.hogwild (boolean) trains the INCREMENTAL algorithm on options.threads threads, which update the weights
+//   without locking.  Results aren't reproducible.
+// With the MINIBATCH algorithm, the weights are updated after every batchSize datapairs (an ANN option), and
+//   options.threads is ignored.
 // Options for cascading: maxNeurons (default 10000), progressInterval, desiredError
 // Options for non-cascading: maxEpochs (default 2000000000), progressInerval, desiredError
 // progress is an optional callback that is periodically called for multi-epoch training.  It receives a single
@@ -652,6 +832,16 @@ ANN.prototype.train = asyncOpQueue(function(data, options, progress) {
 	if (!options.maxNeurons) options.maxNeurons = 10000;
 	if (typeof options.desiredError !== 'number') options.desiredError = 0;
 	if (!options.progressInterval) options.progressInterval = 1;
+	var threads = (options.threads === undefined) ? 1 : options.threads;
+	if (typeof threads !== 'number' || Math.floor(threads) !== threads || threads < 1) {
+		throw new XError(XError.INVALID_ARGUMENT, 'threads must be a positive integer');
+	}
+	if (threads > 1 && (filename || options.cascade)) {
+		throw new XError(XError.INVALID_ARGUMENT, 'threads is only supported when training on TrainingData without cascade');
+	}
+	if (options.hogwild && self.getOption('trainingAlgorithm') !== 'INCREMENTAL') {
+		throw new XError(XError.INVALID_ARGUMENT, 'hogwild requires the INCREMENTAL training algorithm');
+	}
 	if (options.stopFunction) {
 		self._fanny.setTrainStopFunction('STOPFUNC_' + options.stopFunction);
 	}
@@ -682,6 +872,7 @@ ANN.prototype.train = asyncOpQueue(function(data, options, progress) {
 			options.desiredError,
 			cb
 		];
+		if (threads > 1) args.splice(4, 0, threads, !!options.hogwild);
 		if (!options.cascade) {
 			if (filename) {
 				self._fanny.trainOnFile.apply(self._fanny, args);
@@ -698,11 +889,25 @@ ANN.prototype.train = asyncOpQueue(function(data, options, progress) {
 	});
 });
 
+// Returns true for arrays and numeric typed arrays, both of which are accepted as data
+function isNumberArray(value) {
+	return Array.isArray(value) || (ArrayBuffer.isView(value) && !(value instanceof DataView));
+}
+
 ANN.prototype.run = blockOnAsync(function(inputs) {
 	return this._fanny.run(inputs);
 });
 
-ANN.prototype.runAsync = asyncOpQueue(function(inputs) {
+// Like run(), but writes the outputs into the given typed array (which must match the network's
+// datatype) instead of allocating a new array.  Returns the output typed array.
+ANN.prototype.runInto = blockOnAsync(wrapThrows(function(inputs, outputs) {
+	if (!ArrayBuffer.isView(outputs) || outputs instanceof DataView) {
+		throw new XError(XError.INVALID_ARGUMENT, 'outputs must be a typed array');
+	}
+	return this._fanny.runInto(inputs, outputs);
+}));
+
+var queuedRunAsync = asyncOpQueue(function(inputs) {
 	var self = this;
 	return new Promise(function(resolve, reject) {
 		self._fanny.runAsync(inputs, function(err, res) {
@@ -710,6 +915,193 @@ ANN.prototype.runAsync = asyncOpQueue(function(inputs) {
 			resolve(res);
 		});
 	});
+}, true);
+
+ANN.prototype.runAsync = function(inputs) {
+	if (this._microBatching) return microBatchRun(this, inputs);
+	return queuedRunAsync.call(this, inputs);
+};
+
+// Validates arguments to runBatch() and runBatchAsync().  inputs must be a typed array containing
+// count sets of inputs back-to-back; count defaults to however many complete sets it holds.
+function getBatchCount(ann, inputs, count) {
+	if (!ArrayBuffer.isView(inputs) || inputs instanceof DataView) {
+		throw new XError(XError.INVALID_ARGUMENT, 'inputs must be a typed array');
+	}
+	if (count === undefined || count === null) count = inputs.length / ann.info.numInput;
+	if (typeof count !== 'number' || Math.floor(count) !== count || count < 0) {
+		throw new XError(XError.INVALID_ARGUMENT, 'count must be a non-negative integer');
+	}
+	if (inputs.length !== count * ann.info.numInput) {
+		throw new XError(XError.INVALID_ARGUMENT, 'inputs must contain count * numInput values');
+	}
+	return count;
+}
+
+// Runs count sets of inputs, stored back-to-back in a typed array (Float32Array for float networks,
+// Float64Array for double, Int32Array for fixed; other numeric typed arrays are converted).  Returns
+// a typed array of the same kind containing count * numOutput outputs.
+ANN.prototype.runBatch = blockOnAsync(function(inputs, count) {
+	return this._fanny.runBatch(inputs, getBatchCount(this, inputs, count));
+});
+
+ANN.prototype.runBatchAsync = asyncOpQueue(function(inputs, count) {
+	var self = this;
+	count = getBatchCount(self, inputs, count);
+	return new Promise(function(resolve, reject) {
+		self._fanny.runBatchAsync(inputs, count, function(err, res) {
+			if (err) return reject(new XError(err));
+			resolve(res);
+		});
+	});
+}, true);
+
+// The following run the network and reduce its outputs natively, so only the result is passed back
+// to Javascript.  Returns the index of the largest output.
+ANN.prototype.runArgmax = blockOnAsync(wrapThrows(function(inputs) {
+	return this._fanny.runReduced(inputs, 'argmax', 0);
+}));
+
+// Returns an array of the indices of the k largest outputs, largest first
+ANN.prototype.runTopK = blockOnAsync(wrapThrows(function(inputs, k) {
+	return this._fanny.runReduced(inputs, 'topk', k);
+}));
+
+// Returns a Uint32Array bitmask of the outputs at or above threshold: output i is bit i % 32 of
+// element Math.floor(i / 32)
+ANN.prototype.runThreshold = blockOnAsync(wrapThrows(function(inputs, threshold) {
+	return this._fanny.runReduced(inputs, 'threshold', threshold);
+}));
+
+// Batch versions of the above, taking inputs and count as runBatch() does.  Each returns a
+// Uint32Array of every run's result back-to-back.
+ANN.prototype.runBatchArgmax = blockOnAsync(wrapThrows(function(inputs, count) {
+	return this._fanny.runBatchReduced(inputs, getBatchCount(this, inputs, count), 'argmax', 0);
+}));
+
+ANN.prototype.runBatchTopK = blockOnAsync(wrapThrows(function(inputs, k, count) {
+	return this._fanny.runBatchReduced(inputs, getBatchCount(this, inputs, count), 'topk', k);
+}));
+
+ANN.prototype.runBatchThreshold = blockOnAsync(wrapThrows(function(inputs, threshold, count) {
+	return this._fanny.runBatchReduced(inputs, getBatchCount(this, inputs, count), 'threshold', threshold);
+}));
+
+var TYPED_ARRAY_CLASSES = {
+	float: Float32Array,
+	double: Float64Array,
+	fixed: Int32Array
+};
+
+function hrtimeMs(start) {
+	var diff = process.hrtime(start);
+	return diff[0] * 1000 + diff[1] / 1e6;
+}
+
+// Queues a single runAsync() call to be executed as part of the next micro-batch
+function microBatchRun(ann, inputs) {
+	var mb = ann._microBatching;
+	if (!isNumberArray(inputs) || inputs.length !== ann.info.numInput) {
+		return Promise.reject(new XError(XError.INVALID_ARGUMENT, 'inputs must be an array of numInput numbers'));
+	}
+	var waiter = pasync.waiter();
+	mb.pending.push({ inputs: inputs, waiter: waiter, queuedAt: process.hrtime() });
+	if (mb.pending.length >= mb.maxBatchSize) {
+		flushMicroBatch(ann);
+	} else if (!mb.timer) {
+		if (mb.maxWait >= 1) {
+			mb.timer = setTimeout(function() { flushMicroBatch(ann); }, mb.maxWait);
+		} else {
+			mb.timer = setImmediate(function() { flushMicroBatch(ann); });
+		}
+	}
+	return waiter.promise;
+}
+
+// Runs all pending micro-batched requests as one native batch and resolves each request
+function flushMicroBatch(ann) {
+	var mb = ann._microBatching;
+	if (mb.timer) {
+		if (mb.maxWait >= 1) clearTimeout(mb.timer); else clearImmediate(mb.timer);
+		mb.timer = null;
+	}
+	if (!mb.pending.length) return;
+	var batch = mb.pending;
+	mb.pending = [];
+	var numInput = ann.info.numInput;
+	var numOutput = ann.info.numOutput;
+	var inputs = new TYPED_ARRAY_CLASSES[ann._datatype](batch.length * numInput);
+	var stats = mb.stats;
+	for (var i = 0; i < batch.length; i++) {
+		inputs.set(batch[i].inputs, i * numInput);
+		var delay = hrtimeMs(batch[i].queuedAt);
+		stats.totalQueueDelay += delay;
+		if (delay > stats.maxQueueDelay) stats.maxQueueDelay = delay;
+	}
+	stats.batches++;
+	stats.requests += batch.length;
+	if (batch.length > stats.maxBatchSize) stats.maxBatchSize = batch.length;
+	ann.runBatchAsync(inputs, batch.length)
+		.then(function(outputs) {
+			for (var i = 0; i < batch.length; i++) {
+				batch[i].waiter.resolve(Array.prototype.slice.call(outputs, i * numOutput, (i + 1) * numOutput));
+			}
+		}, function(err) {
+			for (var i = 0; i < batch.length; i++) batch[i].waiter.reject(err);
+		})
+		.catch(pasync.abort);
+}
+
+// Enables collecting concurrent runAsync() calls into native batches.  A batch is sent once it
+// reaches maxBatchSize requests or maxWait milliseconds after its first request.  A maxWait under
+// 1 millisecond sends the batch on the next turn of the event loop.
+ANN.prototype.enableMicroBatching = wrapThrows(function(options) {
+	options = options || {};
+	var maxBatchSize = (options.maxBatchSize === undefined) ? 64 : options.maxBatchSize;
+	var maxWait = (options.maxWait === undefined) ? 0.2 : options.maxWait;
+	if (typeof maxBatchSize !== 'number' || Math.floor(maxBatchSize) !== maxBatchSize || maxBatchSize < 1) {
+		throw new XError(XError.INVALID_ARGUMENT, 'maxBatchSize must be a positive integer');
+	}
+	if (typeof maxWait !== 'number' || Number.isNaN(maxWait) || maxWait < 0) {
+		throw new XError(XError.INVALID_ARGUMENT, 'maxWait must be a non-negative number');
+	}
+	if (this._microBatching) flushMicroBatch(this);
+	this._microBatching = {
+		maxBatchSize: maxBatchSize,
+		maxWait: maxWait,
+		pending: [],
+		timer: null,
+		stats: { batches: 0, requests: 0, maxBatchSize: 0, totalQueueDelay: 0, maxQueueDelay: 0 }
+	};
+});
+
+// Sends any pending requests and returns runAsync() to running each call individually
+ANN.prototype.disableMicroBatching = function() {
+	if (!this._microBatching) return;
+	flushMicroBatch(this);
+	this._microBatching = null;
+};
+
+// Returns counters for tuning micro-batching.  Queue delays are in milliseconds.
+ANN.prototype.getMicroBatchingStats = function() {
+	if (!this._microBatching) return null;
+	var stats = this._microBatching.stats;
+	return {
+		batches: stats.batches,
+		requests: stats.requests,
+		pending: this._microBatching.pending.length,
+		averageBatchSize: stats.batches ? stats.requests / stats.batches : 0,
+		maxBatchSize: stats.maxBatchSize,
+		averageQueueDelay: stats.requests ? stats.totalQueueDelay / stats.requests : 0,
+		maxQueueDelay: stats.maxQueueDelay
+	};
+};
+
+// Returns an object mode Transform stream that runs each record written to it and emits its outputs.
+// Records are run in native batches of options.batchSize (default 256); options.highWaterMark is the
+// number of outputs buffered before the stream stops accepting records (default batchSize).
+ANN.prototype.createRunStream = wrapThrows(function(options) {
+	return new RunStream(this, TYPED_ARRAY_CLASSES[this._datatype], options);
 });
 
 ANN.prototype.randomizeWeights = blockOnAsync(wrapThrows(function(min, max) {
@@ -967,14 +1359,14 @@ ANN.prototype.setWeight = blockOnAsync(wrapThrows(function(fromNeuron, toNeuron,
 }));
 
 ANN.prototype.trainOne = blockOnAsync(wrapThrows(function(input, output) {
-	if (!Array.isArray(input) || !Array.isArray(output)) {
+	if (!isNumberArray(input) || !isNumberArray(output)) {
 		throw new XError(XError.INVALID_ARGUMENT, 'Both input and output should be arrays');
 	}
 	return this._fanny.train(input, output);
 }));
 
 ANN.prototype.testOne = blockOnAsync(wrapThrows(function(input, output) {
-	if (!Array.isArray(input) || !Array.isArray(output)) {
+	if (!isNumberArray(input) || !isNumberArray(output)) {
 		throw new XError(XError.INVALID_ARGUMENT, 'Both input and output should be arrays');
 	}
 	if (input.length !== this.info.numInput) {
@@ -986,6 +1378,23 @@ ANN.prototype.testOne = blockOnAsync(wrapThrows(function(input, output) {
 	return this._fanny.test(input, output);
 }));
 
+ANN.prototype.quantize = blockOnAsync(function(data) {
+	if (!data || !data._fannyTrainingData) {
+		throw new XError(XError.INVALID_ARGUMENT, 'data must be an instanceof TrainingData');
+	}
+	return this._fanny.quantize(data._fannyTrainingData);
+});
+
+// Returns C++ source for a standalone copy of the network, with its layer sizes and weights
+// compiled in.  Build it with buildGeneratedModule() to get a native module with its own run().
+ANN.prototype.generateSource = blockOnAsync(function(name) {
+	if (name === undefined) name = 'fannyNet';
+	if (typeof name !== 'string' || !/^[A-Za-z_][A-Za-z0-9_]*$/.test(name)) {
+		throw new XError(XError.INVALID_ARGUMENT, 'name must be a valid C++ identifier');
+	}
+	return this._fanny.generateSource(name);
+});
+
 ANN.prototype.testData = asyncOpQueue(function(data) {
 	var self = this;
 	if (!data || !data._fannyTrainingData) {
@@ -1064,9 +1473,24 @@ function loadANN(filename, datatype) {
 	});
 }
 
+// Creates a network whose weights are read in place from a SharedArrayBuffer returned by
+// exportShared(), which may come from another thread.  Its weights are read-only: training or
+// setting weights throws, but clone() makes a private copy that can be changed.  The datatype must
+// be the one of the exported network.
+var attachANN = wrapThrows(function(buffer, datatype) {
+	if (typeof SharedArrayBuffer === 'undefined' || !(buffer instanceof SharedArrayBuffer)) {
+		throw new XError(XError.INVALID_ARGUMENT, 'buffer must be a SharedArrayBuffer');
+	}
+	if (!datatype) datatype = 'float';
+	var addon = utils.getAddon(datatype);
+	var fanny = new addon.FANNY(new Uint8Array(buffer));
+	return new ANN(fanny, datatype);
+});
+
 module.exports = {
 	createANN: createANN,
 	loadANN: loadANN,
+	attachANN: attachANN,
 	annConfigSchema: annConfigSchema,
 	annOptionsSchema: annOptionsSchema
 };
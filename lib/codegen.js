@@ -0,0 +1,45 @@
+// Copyright 2016 Zipscene, LLC
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+var fs = require('fs');
+var path = require('path');
+var childProcess = require('child_process');
+var XError = require('xerror');
+
+// Builds the source from ann.generateSource() into a native module exporting numInput, numOutput
+// and run(inputs).  options.dir is where the source and build files go, options.name is the module
+// name (default 'fannyNet') and options.nodeGyp is the node-gyp executable to run.  Resolves with
+// the path of the built .node file.
+function buildGeneratedModule(ann, options) {
+	if (!options || typeof options.dir !== 'string') {
+		return Promise.reject(new XError(XError.INVALID_ARGUMENT, 'options.dir is required'));
+	}
+	var name = options.name || 'fannyNet';
+	var dir = path.resolve(options.dir);
+	return Promise.resolve(ann.generateSource(name)).then(function(source) {
+		if (!fs.existsSync(dir)) fs.mkdirSync(dir);
+		fs.writeFileSync(path.join(dir, name + '.cc'), source);
+		var gyp = {
+			targets: [ {
+				target_name: name,
+				sources: [ name + '.cc' ],
+				include_dirs: [ path.dirname(require.resolve('nan')) ],
+				defines: [ 'FANNY_GENERATED_ADDON' ],
+				cflags: [ '-O3' ],
+				xcode_settings: { OTHER_CFLAGS: [ '-O3' ] }
+			} ]
+		};
+		fs.writeFileSync(path.join(dir, 'binding.gyp'), JSON.stringify(gyp, null, '\t'));
+		return new Promise(function(resolve, reject) {
+			childProcess.execFile(options.nodeGyp || 'node-gyp', [ 'rebuild' ], { cwd: dir }, function(err, stdout, stderr) {
+				if (err) return reject(new XError(XError.INTERNAL_ERROR, 'Error building generated module: ' + stderr, err));
+				resolve(path.join(dir, 'build', 'Release', name + '.node'));
+			});
+		});
+	});
+}
+
+module.exports = {
+	buildGeneratedModule: buildGeneratedModule
+};
@@ -0,0 +1,157 @@
+// Copyright 2016 Zipscene, LLC
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+var XError = require('xerror');
+var utils = require('./utils');
+
+var COMBINE_MODES = [ 'mean', 'weighted', 'all' ];
+
+// Runs several networks with the same numbers of inputs and outputs on the same inputs in one native
+// call.  The ensemble keeps its own copies of the networks, taken when it's created, so later
+// changes to them don't affect it.  options.weights gives a weight per network for the 'weighted'
+// combine mode.
+function Ensemble(anns, options) {
+	options = options || {};
+	if (!Array.isArray(anns) || !anns.length) {
+		throw new XError(XError.INVALID_ARGUMENT, 'anns must be a non-empty array of networks');
+	}
+	var datatype = anns[0]._datatype;
+	var fannys = anns.map(function(ann) {
+		if (!ann || !ann._fanny) throw new XError(XError.INVALID_ARGUMENT, 'anns must be a non-empty array of networks');
+		if (ann._datatype !== datatype) throw new XError(XError.INVALID_ARGUMENT, 'All networks must have the same datatype');
+		if (ann._currentlyRunning) {
+			throw new XError(XError.INTERNAL_ERROR, 'Cannot execute this operation while training or running ann');
+		}
+		return ann._fanny;
+	});
+	var addon = utils.getAddon(datatype);
+	try {
+		this._ensemble = new addon.Ensemble(fannys.map(function(fanny) {
+			return new addon.FANNY(fanny);
+		}), options.weights);
+	} catch (ex) {
+		throw new XError(XError.INVALID_ARGUMENT, ex);
+	}
+	this._datatype = datatype;
+	this.info = {
+		numMembers: this._ensemble.getNumMembers(),
+		numInput: this._ensemble.getNumInput(),
+		numOutput: this._ensemble.getNumOutput()
+	};
+	// Asynchronous runs execute one at a time, each across up to its own number of threads
+	this._queue = Promise.resolve();
+	this._runningAsync = 0;
+}
+
+function getCombine(mode) {
+	if (mode === undefined) return 'mean';
+	if (COMBINE_MODES.indexOf(mode) === -1) {
+		throw new XError(XError.INVALID_ARGUMENT, 'mode must be one of ' + COMBINE_MODES.join(', '));
+	}
+	return mode;
+}
+
+function getBatchCount(ensemble, inputs, count) {
+	if (!ArrayBuffer.isView(inputs) || inputs instanceof DataView) {
+		throw new XError(XError.INVALID_ARGUMENT, 'inputs must be a typed array');
+	}
+	if (count === undefined || count === null) count = inputs.length / ensemble.info.numInput;
+	if (typeof count !== 'number' || Math.floor(count) !== count || count < 0) {
+		throw new XError(XError.INVALID_ARGUMENT, 'count must be a non-negative integer');
+	}
+	if (inputs.length !== count * ensemble.info.numInput) {
+		throw new XError(XError.INVALID_ARGUMENT, 'inputs must contain count * numInput values');
+	}
+	return count;
+}
+
+// Splits one run's outputs in 'all' mode into an array of outputs per member
+function splitMembers(ensemble, outputs) {
+	var numOutput = ensemble.info.numOutput;
+	var result = [];
+	for (var m = 0; m < ensemble.info.numMembers; m++) {
+		result.push(Array.prototype.slice.call(outputs, m * numOutput, (m + 1) * numOutput));
+	}
+	return result;
+}
+
+function checkNotRunning(ensemble) {
+	if (ensemble._runningAsync) {
+		throw new XError(XError.INTERNAL_ERROR, 'Cannot execute this operation while running ensemble');
+	}
+}
+
+// Runs every network on one set of inputs.  mode is 'mean' (the default), 'weighted' or 'all'.
+// Returns an array of outputs, or for 'all' an array of each network's outputs.
+Ensemble.prototype.run = function(inputs, mode) {
+	checkNotRunning(this);
+	var combine = getCombine(mode);
+	var outputs;
+	try {
+		outputs = this._ensemble.run(inputs, combine);
+	} catch (ex) {
+		throw new XError(XError.INVALID_ARGUMENT, ex);
+	}
+	return (combine === 'all') ? splitMembers(this, outputs) : outputs;
+};
+
+// Runs count sets of inputs stored back-to-back in a typed array.  Returns a typed array with the
+// combined outputs of each run; for 'all', each run has every network's outputs one after another.
+Ensemble.prototype.runBatch = function(inputs, count, mode) {
+	checkNotRunning(this);
+	count = getBatchCount(this, inputs, count);
+	return this._ensemble.runBatch(inputs, count, getCombine(mode));
+};
+
+// Asynchronous version of run().  options.mode is the combine mode and options.threads the number
+// of threads the networks are spread across (default 1).
+Ensemble.prototype.runAsync = function(inputs, options) {
+	var self = this;
+	options = options || {};
+	if (!Array.isArray(inputs) || inputs.length !== self.info.numInput) {
+		return Promise.reject(new XError(XError.INVALID_ARGUMENT, 'inputs must be an array of numInput numbers'));
+	}
+	var typedInputs = new Float64Array(inputs);
+	return self.runBatchAsync(typedInputs, 1, options).then(function(outputs) {
+		return (options.mode === 'all') ? splitMembers(self, outputs) : Array.prototype.slice.call(outputs);
+	});
+};
+
+// Asynchronous version of runBatch().  Takes the same options as runAsync().
+Ensemble.prototype.runBatchAsync = function(inputs, count, options) {
+	var self = this;
+	options = options || {};
+	var combine, threads;
+	try {
+		count = getBatchCount(self, inputs, count);
+		combine = getCombine(options.mode);
+		threads = (options.threads === undefined) ? 1 : options.threads;
+		if (typeof threads !== 'number' || Math.floor(threads) !== threads || threads < 1) {
+			throw new XError(XError.INVALID_ARGUMENT, 'threads must be a positive integer');
+		}
+	} catch (ex) {
+		return Promise.reject(ex);
+	}
+	self._runningAsync++;
+	var run = self._queue.then(function() {
+		return new Promise(function(resolve, reject) {
+			self._ensemble.runBatchAsync(inputs, count, combine, threads, function(err, res) {
+				if (err) return reject(new XError(err));
+				resolve(res);
+			});
+		});
+	});
+	var finish = function() { self._runningAsync--; };
+	self._queue = run.then(finish, finish);
+	return run;
+};
+
+function createEnsemble(anns, options) {
+	return new Ensemble(anns, options);
+}
+
+module.exports = {
+	Ensemble: Ensemble,
+	createEnsemble: createEnsemble
+};
@@ -4,7 +4,15 @@
 
 var td = require('./training-data');
 var ann = require('./ann');
+var ensemble = require('./ensemble');
 for (var key in td) module.exports[key] = td[key];
 for (var key in ann) module.exports[key] = ann[key];
+for (var key in ensemble) module.exports[key] = ensemble[key];
 module.exports.getAddon = require('./utils').getAddon;
+module.exports.buildGeneratedModule = require('./codegen').buildGeneratedModule;
+
+// Returns the instruction set ("scalar", "sse2", "avx2" or "avx512") used by the SIMD engine
+module.exports.getSimdLevel = function(datatype) {
+	return module.exports.getAddon(datatype).FANNY.getSimdLevel();
+};
 
@@ -0,0 +1,79 @@
+// Copyright 2016 Zipscene, LLC
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+var Transform = require('stream').Transform;
+var util = require('util');
+var XError = require('xerror');
+
+// Object mode stream that runs each input record (an array or typed array of numInput numbers)
+// through the network and emits its outputs as an array, in order.  Records are collected into
+// typed array batches of batchSize runs, which run on the thread pool with runBatchAsync().  One
+// batch is in flight while the next is being filled; once that one is full too, writes wait for the
+// first to finish.  ArrayType is the typed array class for the network's datatype.
+function RunStream(ann, ArrayType, options) {
+	options = options || {};
+	var batchSize = (options.batchSize === undefined) ? 256 : options.batchSize;
+	if (typeof batchSize !== 'number' || Math.floor(batchSize) !== batchSize || batchSize < 1) {
+		throw new XError(XError.INVALID_ARGUMENT, 'batchSize must be a positive integer');
+	}
+	var highWaterMark = (options.highWaterMark === undefined) ? batchSize : options.highWaterMark;
+	if (typeof highWaterMark !== 'number' || Math.floor(highWaterMark) !== highWaterMark || highWaterMark < 1) {
+		throw new XError(XError.INVALID_ARGUMENT, 'highWaterMark must be a positive integer');
+	}
+	Transform.call(this, { objectMode: true, highWaterMark: highWaterMark });
+	this._ann = ann;
+	this._numInput = ann.info.numInput;
+	this._numOutput = ann.info.numOutput;
+	this._batchSize = batchSize;
+	// Two input buffers, so one can be filled while the other is running
+	this._buffers = [ new ArrayType(batchSize * this._numInput), new ArrayType(batchSize * this._numInput) ];
+	this._fillIndex = 0;
+	this._count = 0;
+	// Resolves once the batch in flight has run and its outputs have been pushed.  Never rejects.
+	this._inFlight = Promise.resolve();
+}
+util.inherits(RunStream, Transform);
+
+RunStream.prototype._transform = function(record, encoding, cb) {
+	var isArray = Array.isArray(record) || (ArrayBuffer.isView(record) && !(record instanceof DataView));
+	if (!isArray || record.length !== this._numInput) {
+		return cb(new XError(XError.INVALID_ARGUMENT, 'Each record must be an array of numInput numbers'));
+	}
+	this._buffers[this._fillIndex].set(record, this._count * this._numInput);
+	this._count++;
+	if (this._count === this._batchSize) {
+		this._sendBatch(cb);
+	} else {
+		cb();
+	}
+};
+
+RunStream.prototype._flush = function(cb) {
+	if (this._count) this._sendBatch(function() {});
+	this._inFlight.then(function() { cb(); });
+};
+
+// Runs the filled buffer once the batch in flight is done, calling cb as soon as it's started.
+// Errors from running it destroy the stream.
+RunStream.prototype._sendBatch = function(cb) {
+	var self = this;
+	var inputs = self._buffers[self._fillIndex];
+	var count = self._count;
+	var numOutput = self._numOutput;
+	self._fillIndex = 1 - self._fillIndex;
+	self._count = 0;
+	self._inFlight = self._inFlight.then(function() {
+		var running = self._ann.runBatchAsync(inputs.subarray(0, count * self._numInput), count);
+		cb();
+		return running;
+	}).then(function(outputs) {
+		for (var i = 0; i < count; i++) {
+			self.push(Array.prototype.slice.call(outputs, i * numOutput, (i + 1) * numOutput));
+		}
+	}, function(err) {
+		self.destroy(err);
+	});
+};
+
+module.exports = RunStream;
@@ -0,0 +1,45 @@
+#include "addon-data.h"
+#include <map>
+#include <mutex>
+
+namespace fanny {
+
+// Worker threads load and unload the addon concurrently
+static std::mutex addonDataMutex;
+static std::map<v8::Isolate *, AddonData *> addonDataByIsolate;
+
+AddonData *AddonData::create() {
+	v8::Isolate *isolate = v8::Isolate::GetCurrent();
+	AddonData *data = new AddonData();
+	data->isolate = isolate;
+	{
+		std::lock_guard<std::mutex> lock(addonDataMutex);
+		addonDataByIsolate[isolate] = data;
+	}
+	#if NODE_MAJOR_VERSION > 10 || (NODE_MAJOR_VERSION == 10 && NODE_MINOR_VERSION >= 2)
+	node::AddEnvironmentCleanupHook(isolate, destroy, data);
+	#endif
+	return data;
+}
+
+AddonData *AddonData::get() {
+	std::lock_guard<std::mutex> lock(addonDataMutex);
+	std::map<v8::Isolate *, AddonData *>::const_iterator it = addonDataByIsolate.find(v8::Isolate::GetCurrent());
+	return it == addonDataByIsolate.end() ? NULL : it->second;
+}
+
+AddonData::~AddonData() {
+	fannyConstructorTpl.Reset();
+	fannyConstructor.Reset();
+	trainingDataConstructorTpl.Reset();
+}
+
+void AddonData::destroy(void *data) {
+	{
+		std::lock_guard<std::mutex> lock(addonDataMutex);
+		addonDataByIsolate.erase(((AddonData *)data)->isolate);
+	}
+	delete (AddonData *)data;
+}
+
+}
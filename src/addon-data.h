@@ -0,0 +1,36 @@
+#ifndef FANNY_ADDON_DATA_H
+#define FANNY_ADDON_DATA_H
+
+#include <nan.h>
+
+namespace fanny {
+
+// Handles the addon keeps for each isolate it's loaded in: the main thread's, and one for each
+// worker thread that requires it.  Handles belong to the isolate that created them, so they can't
+// be shared through statics.
+class AddonData {
+public:
+	Nan::Persistent<v8::FunctionTemplate> fannyConstructorTpl;
+	Nan::Persistent<v8::Function> fannyConstructor;
+	Nan::Persistent<v8::FunctionTemplate> trainingDataConstructorTpl;
+
+	// Creates the data for the current isolate.  It's freed when the isolate's environment is torn
+	// down.
+	static AddonData *create();
+	// Returns the data for the current isolate
+	static AddonData *get();
+
+private:
+	AddonData() : isolate(NULL) {}
+	AddonData(const AddonData &);
+	AddonData &operator=(const AddonData &);
+	~AddonData();
+
+	static void destroy(void *data);
+
+	v8::Isolate *isolate;
+};
+
+}
+
+#endif
@@ -1,11 +1,15 @@
 #include <nan.h>
+#include "addon-data.h"
 #include "fanny.h"
 #include "training-data.h"
+#include "ensemble.h"
 
 NAN_MODULE_INIT(init) {
+	fanny::AddonData::create();
 	fanny::FANNY::Init(target);
 	fanny::TrainingData::Init(target);
+	fanny::Ensemble::Init(target);
 }
 
-NODE_MODULE(fanny, init);
-
+// Context-aware, so worker threads can load the addon too
+NAN_MODULE_WORKER_ENABLED(fanny, init)
@@ -0,0 +1,493 @@
+#include "compiled-net.h"
+#include "fann-access.h"
+#include "simd-kernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+// Helper from FANN's internal header, used to mirror fann_update_MSE()
+#ifndef fann_abs
+#define fann_abs(value) (((value) > 0) ? (value) : -(value))
+#endif
+
+namespace fanny {
+
+const unsigned int CompiledNet::BATCH_SIZE;
+const size_t CompiledNet::NO_BLOCK;
+
+static std::atomic<unsigned long> nextCompiledNetId(1);
+
+// Layers whose nonzero weights fill less than this fraction of the matrix over their source range
+// are stored as compressed sparse rows
+static const double sparseDensityThreshold = 0.25;
+
+// Most neurons in a triangular block.  Larger blocks move more of each row into the block's matrix
+// product, but make the triangle applied a layer at a time larger.  A multiple of every
+// AlignedBuffer row alignment, so padded triangle columns fit in the block's sums.
+static const unsigned int triangularBlockNeurons = 32;
+
+#ifdef FANNY_FIXED
+// Fixed point products are summed with integer adds, so a single row's product isn't held up by
+// multiply-add latency the way float rows are, and the triangle's 32-bit multiplies only add to
+// the time between neurons.  Fixed point networks run layer by layer.
+static const bool useTriangularBlocks = false;
+#else
+static const bool useTriangularBlocks = true;
+#endif
+
+CompiledNet::CompiledNet() : id(nextCompiledNetId++) {}
+
+#ifdef FANNY_FIXED
+// Activation functions FANN can evaluate in fixed point
+static bool isFixedActivationSupported(enum fann_activationfunc_enum fn) {
+	switch (fn) {
+		case FANN_SIGMOID:
+		case FANN_SIGMOID_STEPWISE:
+		case FANN_SIGMOID_SYMMETRIC:
+		case FANN_SIGMOID_SYMMETRIC_STEPWISE:
+		case FANN_THRESHOLD:
+		case FANN_THRESHOLD_SYMMETRIC:
+		case FANN_LINEAR:
+		case FANN_LINEAR_PIECE:
+		case FANN_LINEAR_PIECE_SYMMETRIC:
+			return true;
+		default:
+			return false;
+	}
+}
+#endif
+
+std::shared_ptr<CompiledNet> CompiledNet::compile(FANN::neural_net *net, bool fastActivations) {
+	std::shared_ptr<CompiledNet> empty;
+	struct fann *ann = getFannStruct(net);
+	if (!ann || !ann->first_layer || ann->last_layer - ann->first_layer < 2) return empty;
+
+	std::shared_ptr<CompiledNet> cn(new CompiledNet());
+	struct fann_neuron *firstNeuron = ann->first_layer->first_neuron;
+	cn->numInput = ann->num_input;
+	cn->numOutput = ann->num_output;
+	cn->totalNeurons = ann->total_neurons;
+	size_t alignElements = AlignedBuffer<fann_type>::ALIGNMENT / sizeof(fann_type);
+	cn->valueStride = (cn->totalNeurons + alignElements - 1) / alignElements * alignElements;
+	cn->outputFirst = (unsigned int)((ann->last_layer - 1)->first_neuron - firstNeuron);
+	cn->activationFunctions.assign(cn->totalNeurons, FANN_LINEAR);
+	cn->steepnesses.assign(cn->totalNeurons, 0);
+	cn->fastActivations = fastActivations;
+	#ifdef FANNY_FIXED
+	cn->decimalPoint = ann->decimal_point;
+	cn->multiplier = ann->multiplier;
+	cn->stepwise.resize(cn->totalNeurons);
+	#endif
+
+	// The last neuron of the input layer is its bias
+	cn->biasNeurons.push_back((unsigned int)(ann->first_layer->last_neuron - 1 - firstNeuron));
+
+	// Mirror fann_run(): fully connected networks read each neuron's sources from a contiguous
+	// range of neurons; otherwise the connections array lists them.
+	bool fullyConnected = ann->connection_rate >= 1;
+	// Index of the c-th source of a neuron in layerIt
+	auto sourceOf = [&](struct fann_layer *layerIt, struct fann_neuron *neuron, unsigned int c) -> unsigned int {
+		if (!fullyConnected) return (unsigned int)(ann->connections[neuron->first_con + c] - firstNeuron);
+		unsigned int first = (ann->network_type == FANN_NETTYPE_SHORTCUT) ? 0 : (unsigned int)((layerIt - 1)->first_neuron - firstNeuron);
+		return first + c;
+	};
+	// FANN layer each entry of cn->layers was built from
+	std::vector<struct fann_layer *> fannLayers;
+	for (struct fann_layer *layerIt = ann->first_layer + 1; layerIt != ann->last_layer; layerIt++) {
+		Layer layer;
+		layer.first = (unsigned int)(layerIt->first_neuron - firstNeuron);
+		layer.count = 0;
+		layer.srcFirst = 0;
+		layer.srcCount = 0;
+		unsigned int srcEnd = 0;
+		size_t nonzeroWeights = 0;
+		for (struct fann_neuron *neuronIt = layerIt->first_neuron; neuronIt != layerIt->last_neuron; neuronIt++) {
+			unsigned int index = (unsigned int)(neuronIt - firstNeuron);
+			if (neuronIt->first_con == neuronIt->last_con) {
+				cn->biasNeurons.push_back(index);
+				continue;
+			}
+			// Computed neurons must be contiguous, with bias neurons after them
+			if (index != layer.first + layer.count) return empty;
+
+			unsigned int numConnections = neuronIt->last_con - neuronIt->first_con;
+			for (unsigned int c = 0; c < numConnections; c++) {
+				unsigned int src = sourceOf(layerIt, neuronIt, c);
+				// Sources must all be computed before this layer
+				if (src >= layer.first) return empty;
+				if (layer.count == 0 && c == 0) layer.srcFirst = src;
+				layer.srcFirst = std::min(layer.srcFirst, src);
+				srcEnd = std::max(srcEnd, src + 1);
+				if (ann->weights[neuronIt->first_con + c] != 0) nonzeroWeights++;
+			}
+
+			cn->activationFunctions[index] = neuronIt->activation_function;
+			cn->steepnesses[index] = neuronIt->activation_steepness;
+			#ifdef FANNY_FIXED
+			if (!isFixedActivationSupported(neuronIt->activation_function)) return empty;
+			bool symmetric = neuronIt->activation_function == FANN_SIGMOID_SYMMETRIC || neuronIt->activation_function == FANN_SIGMOID_SYMMETRIC_STEPWISE;
+			bool sigmoid = symmetric || neuronIt->activation_function == FANN_SIGMOID || neuronIt->activation_function == FANN_SIGMOID_STEPWISE;
+			if (sigmoid) {
+				if (neuronIt->activation_steepness == 0) return empty;
+				for (int i = 0; i < 6; i++) {
+					cn->stepwise[index].v[i] = (symmetric ? ann->sigmoid_symmetric_values[i] : ann->sigmoid_values[i]) / neuronIt->activation_steepness;
+					cn->stepwise[index].r[i] = symmetric ? ann->sigmoid_symmetric_results[i] : ann->sigmoid_results[i];
+				}
+			}
+			#endif
+			layer.count++;
+		}
+		if (layer.count == 0) continue;
+		layer.srcCount = srcEnd - layer.srcFirst;
+		layer.segmentFirst = cn->activationSegments.size();
+		for (unsigned int i = layer.first; i < layer.first + layer.count; i++) {
+			if (i == layer.first || cn->activationFunctions[i] != cn->activationSegments.back().activationFunction) {
+				ActivationSegment segment;
+				segment.first = i;
+				segment.count = 0;
+				segment.activationFunction = cn->activationFunctions[i];
+				cn->activationSegments.push_back(segment);
+			}
+			cn->activationSegments.back().count++;
+		}
+		layer.segmentCount = cn->activationSegments.size() - layer.segmentFirst;
+
+		// Layers with few nonzero weights over their source range are stored as compressed sparse
+		// rows, skipping zero weights; the rest are stored dense, with zeros for missing connections
+		double density = (double)nonzeroWeights / ((double)layer.count * layer.srcCount);
+		layer.sparse = density < sparseDensityThreshold;
+		layer.sparseRowFirst = cn->sparseRowStarts.size();
+		if (layer.sparse) {
+			for (struct fann_neuron *neuronIt = layerIt->first_neuron; neuronIt != layerIt->first_neuron + layer.count; neuronIt++) {
+				cn->sparseRowStarts.push_back((uint32_t)cn->sparseColumns.size());
+				for (unsigned int c = 0; c < neuronIt->last_con - neuronIt->first_con; c++) {
+					fann_type weight = ann->weights[neuronIt->first_con + c];
+					if (weight == 0) continue;
+					cn->sparseColumns.push_back(sourceOf(layerIt, neuronIt, c));
+					cn->sparseWeights.push_back(weight);
+				}
+			}
+			cn->sparseRowStarts.push_back((uint32_t)cn->sparseColumns.size());
+		}
+		layer.block = NO_BLOCK;
+		cn->layers.push_back(layer);
+		fannLayers.push_back(layerIt);
+	}
+	if (cn->layers.empty()) return empty;
+
+	// Group runs of small dense layers that read every earlier neuron, as cascade training adds,
+	// into triangular blocks.  A block needs at least two layers to gain anything.
+	for (size_t l = 0; useTriangularBlocks && l < cn->layers.size();) {
+		size_t end = l;
+		unsigned int count = 0;
+		while (end < cn->layers.size()) {
+			const Layer &layer = cn->layers[end];
+			if (layer.sparse || layer.srcFirst != 0 || layer.srcCount != layer.first) break;
+			if (count + layer.count > triangularBlockNeurons) break;
+			if (end > l && layer.first != cn->layers[end - 1].first + cn->layers[end - 1].count) break;
+			count += layer.count;
+			end++;
+		}
+		if (end - l < 2) {
+			l = std::max(end, l + 1);
+			continue;
+		}
+		TriangularBlock block;
+		block.first = cn->layers[l].first;
+		block.count = count;
+		for (; l < end; l++) cn->layers[l].block = cn->blocks.size();
+		cn->blocks.push_back(block);
+	}
+
+	// Lay out dense rows, padded so each one starts on an aligned boundary
+	size_t totalWeights = 0;
+	for (size_t l = 0; l < cn->layers.size(); l++) {
+		Layer &layer = cn->layers[l];
+		unsigned int rowLength = (layer.sparse || layer.block != NO_BLOCK) ? 0 : layer.srcCount;
+		layer.stride = (rowLength + alignElements - 1) / alignElements * alignElements;
+		layer.weightOffset = totalWeights;
+		totalWeights += layer.stride * layer.count;
+	}
+	for (size_t b = 0; b < cn->blocks.size(); b++) {
+		TriangularBlock &block = cn->blocks[b];
+		block.stride = (block.first + alignElements - 1) / alignElements * alignElements;
+		block.weightOffset = totalWeights;
+		totalWeights += block.stride * block.count;
+		block.triangleStride = (block.count + alignElements - 1) / alignElements * alignElements;
+		block.triangleOffset = totalWeights;
+		totalWeights += block.triangleStride * block.count;
+	}
+
+	cn->weights.resize(totalWeights);
+	for (size_t l = 0; l < cn->layers.size(); l++) {
+		const Layer &layer = cn->layers[l];
+		if (layer.sparse) continue;
+		for (unsigned int r = 0; r < layer.count; r++) {
+			struct fann_neuron *neuron = firstNeuron + layer.first + r;
+			for (unsigned int c = 0; c < neuron->last_con - neuron->first_con; c++) {
+				unsigned int src = sourceOf(fannLayers[l], neuron, c);
+				fann_type weight = ann->weights[neuron->first_con + c];
+				if (layer.block == NO_BLOCK) {
+					cn->weights[layer.weightOffset + r * layer.stride + src - layer.srcFirst] += weight;
+					continue;
+				}
+				const TriangularBlock &block = cn->blocks[layer.block];
+				unsigned int blockRow = layer.first + r - block.first;
+				if (src < block.first) {
+					cn->weights[block.weightOffset + blockRow * block.stride + src] += weight;
+				} else {
+					cn->weights[block.triangleOffset + (src - block.first) * block.triangleStride + blockRow] += weight;
+				}
+			}
+		}
+	}
+	return cn;
+}
+
+void CompiledNet::prepareScratch(Scratch &scratch) const {
+	scratch.values.resize(totalNeurons);
+	for (size_t i = 0; i < biasNeurons.size(); i++) {
+		#ifdef FANNY_FIXED
+		scratch.values[biasNeurons[i]] = multiplier;
+		#else
+		scratch.values[biasNeurons[i]] = 1;
+		#endif
+	}
+	if (!blocks.empty()) scratch.sums.resize(triangularBlockNeurons);
+	scratch.netId = id;
+}
+
+void CompiledNet::prepareBatchScratch(Scratch &scratch) const {
+	scratch.batchValues.resize(valueStride * BATCH_SIZE);
+	for (unsigned int run = 0; run < BATCH_SIZE; run++) {
+		for (size_t i = 0; i < biasNeurons.size(); i++) {
+			#ifdef FANNY_FIXED
+			scratch.batchValues[run * valueStride + biasNeurons[i]] = multiplier;
+			#else
+			scratch.batchValues[run * valueStride + biasNeurons[i]] = 1;
+			#endif
+		}
+	}
+	if (!blocks.empty()) scratch.batchSums.resize(triangularBlockNeurons * BATCH_SIZE);
+	scratch.batchNetId = id;
+}
+
+void CompiledNet::getDenseRow(const Layer &layer, unsigned int row, fann_type *out) const {
+	if (layer.block != NO_BLOCK) {
+		// Layers in triangular blocks read every earlier neuron, so srcFirst is 0
+		const TriangularBlock &block = blocks[layer.block];
+		unsigned int blockRow = layer.first + row - block.first;
+		const fann_type *src = weights.data() + block.weightOffset + blockRow * block.stride;
+		std::copy(src, src + block.first, out);
+		for (unsigned int i = block.first; i < layer.first; i++) {
+			out[i] = weights[block.triangleOffset + (i - block.first) * block.triangleStride + blockRow];
+		}
+		return;
+	}
+	if (!layer.sparse) {
+		const fann_type *src = weights.data() + layer.weightOffset + row * layer.stride;
+		std::copy(src, src + layer.srcCount, out);
+		return;
+	}
+	std::fill(out, out + layer.srcCount, 0);
+	const uint32_t *rowStarts = &sparseRowStarts[layer.sparseRowFirst];
+	for (uint32_t k = rowStarts[row]; k < rowStarts[row + 1]; k++) {
+		out[sparseColumns[k] - layer.srcFirst] += sparseWeights[k];
+	}
+}
+
+// Applies steepness and activation functions to a layer's sums as fann_run() does
+void CompiledNet::activate(const Layer &layer, fann_type *values) const {
+	#ifdef FANNY_FIXED
+	for (unsigned int i = layer.first; i < layer.first + layer.count; i++) {
+		fann_type sum = values[i];
+		fann_type value = 0;
+		const Stepwise &s = stepwise[i];
+		switch (activationFunctions[i]) {
+			case FANN_SIGMOID:
+			case FANN_SIGMOID_STEPWISE:
+				value = (fann_type)fann_stepwise(s.v[0], s.v[1], s.v[2], s.v[3], s.v[4], s.v[5], s.r[0], s.r[1], s.r[2], s.r[3], s.r[4], s.r[5], 0, multiplier, sum);
+				break;
+			case FANN_SIGMOID_SYMMETRIC:
+			case FANN_SIGMOID_SYMMETRIC_STEPWISE:
+				value = (fann_type)fann_stepwise(s.v[0], s.v[1], s.v[2], s.v[3], s.v[4], s.v[5], s.r[0], s.r[1], s.r[2], s.r[3], s.r[4], s.r[5], -multiplier, multiplier, sum);
+				break;
+			case FANN_THRESHOLD:
+				value = (sum < 0) ? 0 : multiplier;
+				break;
+			case FANN_THRESHOLD_SYMMETRIC:
+				value = (sum < 0) ? -multiplier : multiplier;
+				break;
+			case FANN_LINEAR_PIECE:
+				value = (sum < 0) ? 0 : (sum > multiplier) ? multiplier : sum;
+				break;
+			case FANN_LINEAR_PIECE_SYMMETRIC:
+				value = (sum < -multiplier) ? -multiplier : (sum > multiplier) ? multiplier : sum;
+				break;
+			default:
+				value = sum;
+				break;
+		}
+		values[i] = value;
+	}
+	#else
+	simd::ActivateFn activateFn = simd::getKernels().activate;
+	for (size_t s = layer.segmentFirst; s < layer.segmentFirst + layer.segmentCount; s++) {
+		const ActivationSegment &segment = activationSegments[s];
+		activateFn(segment.activationFunction, fastActivations, &steepnesses[segment.first], values + segment.first, segment.count);
+	}
+	#endif
+}
+
+void CompiledNet::runTriangular(const Layer &layer, fann_type *values, fann_type *sums, const simd::Kernels &kernels, unsigned int shift) const {
+	const TriangularBlock &block = blocks[layer.block];
+	unsigned int row = layer.first - block.first;
+	std::copy(sums + row, sums + row + layer.count, values + layer.first);
+	activate(layer, values);
+	unsigned int laterFirst = row + layer.count;
+	if (laterFirst >= block.count) return;
+	// Skip the aligned part of each column that only reaches finished neurons
+	size_t alignElements = AlignedBuffer<fann_type>::ALIGNMENT / sizeof(fann_type);
+	size_t start = laterFirst / alignElements * alignElements;
+	for (unsigned int i = 0; i < layer.count; i++) {
+		const fann_type *column = weights.data() + block.triangleOffset + (row + i) * block.triangleStride;
+		kernels.axpy(column + start, values[layer.first + i], (unsigned int)(block.triangleStride - start), sums + start, shift);
+	}
+}
+
+const fann_type *CompiledNet::run(const fann_type *input, Scratch &scratch) const {
+	return runNeurons(input, scratch) + outputFirst;
+}
+
+const fann_type *CompiledNet::runNeurons(const fann_type *input, Scratch &scratch) const {
+	if (scratch.netId != id) prepareScratch(scratch);
+	fann_type *values = scratch.values.data();
+	std::copy(input, input + numInput, values);
+	const simd::Kernels &kernels = simd::getKernels();
+	#ifdef FANNY_FIXED
+	unsigned int shift = decimalPoint;
+	#else
+	unsigned int shift = 0;
+	#endif
+	for (size_t l = 0; l < layers.size(); l++) {
+		const Layer &layer = layers[l];
+		if (layer.sparse) {
+			kernels.spmv(&sparseRowStarts[layer.sparseRowFirst], sparseColumns.data(), sparseWeights.data(), layer.count, values, values + layer.first, shift);
+		} else if (layer.block == NO_BLOCK) {
+			kernels.gemv(weights.data() + layer.weightOffset, layer.stride, layer.count, values + layer.srcFirst, layer.srcCount, values + layer.first, shift);
+		} else {
+			const TriangularBlock &block = blocks[layer.block];
+			if (layer.first == block.first) {
+				kernels.gemv(weights.data() + block.weightOffset, block.stride, block.count, values, block.first, scratch.sums.data(), shift);
+			}
+			runTriangular(layer, values, scratch.sums.data(), kernels, shift);
+			continue;
+		}
+		activate(layer, values);
+	}
+	return values;
+}
+
+void CompiledNet::runBlock(const fann_type *const *inputs, unsigned int count, Scratch &scratch) const {
+	if (scratch.batchNetId != id) prepareBatchScratch(scratch);
+	fann_type *values = scratch.batchValues.data();
+	for (unsigned int run = 0; run < count; run++) {
+		std::copy(inputs[run], inputs[run] + numInput, values + run * valueStride);
+	}
+	const simd::Kernels &kernels = simd::getKernels();
+	#ifdef FANNY_FIXED
+	unsigned int shift = decimalPoint;
+	#else
+	unsigned int shift = 0;
+	#endif
+	for (size_t l = 0; l < layers.size(); l++) {
+		const Layer &layer = layers[l];
+		if (layer.sparse) {
+			// Sparse rows have little reuse to gain from batching, so run them one input at a time
+			for (unsigned int run = 0; run < count; run++) {
+				fann_type *runValues = values + run * valueStride;
+				kernels.spmv(&sparseRowStarts[layer.sparseRowFirst], sparseColumns.data(), sparseWeights.data(), layer.count, runValues, runValues + layer.first, shift);
+			}
+		} else if (layer.block == NO_BLOCK) {
+			kernels.gemm(weights.data() + layer.weightOffset, layer.stride, layer.count, values + layer.srcFirst, valueStride, layer.srcCount, count, values + layer.first, valueStride, shift);
+		} else {
+			// The block's matrix over earlier neurons is shared by the whole batch; the triangle is
+			// applied one run at a time, the same way run() does
+			const TriangularBlock &block = blocks[layer.block];
+			fann_type *sums = scratch.batchSums.data();
+			if (layer.first == block.first) {
+				kernels.gemm(weights.data() + block.weightOffset, block.stride, block.count, values, valueStride, block.first, count, sums, triangularBlockNeurons, shift);
+			}
+			for (unsigned int run = 0; run < count; run++) {
+				runTriangular(layer, values + run * valueStride, sums + run * triangularBlockNeurons, kernels, shift);
+			}
+			continue;
+		}
+		for (unsigned int run = 0; run < count; run++) {
+			activate(layer, values + run * valueStride);
+		}
+	}
+}
+
+void CompiledNet::runBatch(const fann_type *const *inputs, unsigned int numRuns, fann_type *outputs, Scratch &scratch) const {
+	for (unsigned int start = 0; start < numRuns; start += BATCH_SIZE) {
+		unsigned int count = std::min(BATCH_SIZE, numRuns - start);
+		runBlock(inputs + start, count, scratch);
+		const fann_type *values = scratch.batchValues.data() + outputFirst;
+		for (unsigned int run = 0; run < count; run++) {
+			std::copy(values + run * valueStride, values + run * valueStride + numOutput, outputs + (size_t)(start + run) * numOutput);
+		}
+	}
+}
+
+void CompiledNet::runBatch(const fann_type *inputs, unsigned int numRuns, fann_type *outputs, Scratch &scratch) const {
+	const fann_type *rows[BATCH_SIZE];
+	for (unsigned int start = 0; start < numRuns; start += BATCH_SIZE) {
+		unsigned int count = std::min(BATCH_SIZE, numRuns - start);
+		for (unsigned int run = 0; run < count; run++) rows[run] = inputs + (size_t)(start + run) * numInput;
+		runBatch(rows, count, outputs + (size_t)start * numOutput, scratch);
+	}
+}
+
+CompiledNet::TestResult CompiledNet::test(const fann_type *const *inputs, const fann_type *const *desiredOutputs, unsigned int numRuns, fann_type bitFailLimit, Scratch &scratch) const {
+	TestResult result;
+	result.mseValue = 0;
+	result.numMse = 0;
+	result.numBitFail = 0;
+	for (unsigned int start = 0; start < numRuns; start += BATCH_SIZE) {
+		unsigned int count = std::min(BATCH_SIZE, numRuns - start);
+		runBlock(inputs + start, count, scratch);
+		for (unsigned int run = 0; run < count; run++) {
+			const fann_type *outputs = scratch.batchValues.data() + run * valueStride + outputFirst;
+			const fann_type *desired = desiredOutputs[start + run];
+			for (unsigned int o = 0; o < numOutput; o++) {
+				// Mirrors fann_update_MSE()
+				fann_type diff = desired[o] - outputs[o];
+				switch (activationFunctions[outputFirst + o]) {
+					case FANN_LINEAR_PIECE_SYMMETRIC:
+					case FANN_THRESHOLD_SYMMETRIC:
+					case FANN_SIGMOID_SYMMETRIC:
+					case FANN_SIGMOID_SYMMETRIC_STEPWISE:
+					case FANN_ELLIOT_SYMMETRIC:
+					case FANN_GAUSSIAN_SYMMETRIC:
+					case FANN_SIN_SYMMETRIC:
+					case FANN_COS_SYMMETRIC:
+						diff /= (fann_type)2.0;
+						break;
+					default:
+						break;
+				}
+				#ifdef FANNY_FIXED
+				result.mseValue += (diff / (float)multiplier) * (diff / (float)multiplier);
+				#else
+				result.mseValue += (float)(diff * diff);
+				#endif
+				if (fann_abs(diff) >= bitFailLimit) result.numBitFail++;
+				result.numMse++;
+			}
+		}
+	}
+	return result;
+}
+
+}
@@ -0,0 +1,212 @@
+#ifndef FANNY_COMPILED_NET_H
+#define FANNY_COMPILED_NET_H
+
+#include "fann-includes.h"
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace fanny {
+
+namespace simd {
+struct Kernels;
+}
+
+// Zero-initialized heap buffer aligned for vector loads
+template<typename T>
+class AlignedBuffer {
+public:
+	static const size_t ALIGNMENT = 64;
+
+	AlignedBuffer() : raw(NULL), ptr(NULL), count(0) {}
+	~AlignedBuffer() { free(raw); }
+
+	void resize(size_t n) {
+		free(raw);
+		raw = calloc(n * sizeof(T) + ALIGNMENT, 1);
+		ptr = (T *)(((size_t)raw + ALIGNMENT - 1) & ~(ALIGNMENT - 1));
+		count = n;
+	}
+
+	T *data() { return ptr; }
+	const T *data() const { return ptr; }
+	size_t size() const { return count; }
+	T &operator[](size_t i) { return ptr[i]; }
+	const T &operator[](size_t i) const { return ptr[i]; }
+
+private:
+	AlignedBuffer(const AlignedBuffer &);
+	AlignedBuffer &operator=(const AlignedBuffer &);
+
+	void *raw;
+	T *ptr;
+	size_t count;
+};
+
+// A flattened, read-only copy of a FANN network's weights and activation settings, run with the
+// SIMD kernels instead of FANN's per-connection loop.  Each layer's weights are stored as a
+// row-major matrix over a contiguous range of source neurons, or, when most of that matrix would be
+// zero, as compressed sparse rows.  Runs of small layers that each read every earlier neuron, as
+// in cascade-trained networks, are grouped into triangular blocks (see TriangularBlock).  A
+// CompiledNet never changes after compile() returns, so one instance can be shared by any number
+// of threads as long as each thread runs it with its own Scratch.
+class CompiledNet {
+public:
+	// Per-thread working memory for running a CompiledNet
+	class Scratch {
+	public:
+		Scratch() : netId(0), batchNetId(0) {}
+	private:
+		friend class CompiledNet;
+		// Id of the CompiledNet the buffers were laid out for
+		unsigned long netId;
+		// Value of every neuron, indexed the same way as FANN's neuron array
+		AlignedBuffer<fann_type> values;
+		// Same, for BATCH_SIZE runs at once, one run every valueStride elements
+		unsigned long batchNetId;
+		AlignedBuffer<fann_type> batchValues;
+		// Sums of the neurons in a triangular block, for one run and for BATCH_SIZE runs
+		AlignedBuffer<fann_type> sums;
+		AlignedBuffer<fann_type> batchSums;
+	};
+
+	// Error totals from test(), accumulated the same way as fann_test()
+	struct TestResult {
+		float mseValue;
+		unsigned int numMse;
+		unsigned int numBitFail;
+	};
+
+	// Number of runs evaluated together by runBatch()
+	static const unsigned int BATCH_SIZE = 64;
+
+	// Builds a CompiledNet from a FANN network.  Returns an empty pointer if the network uses a
+	// layout or activation function the compiled engine doesn't handle; callers then use FANN.
+	// fastActivations selects the approximate activation kernels (ignored for fixed point).
+	static std::shared_ptr<CompiledNet> compile(FANN::neural_net *net, bool fastActivations = false);
+
+	// Runs the network on one set of inputs.  Returns a pointer to the outputs, which stays valid
+	// until scratch is used again.
+	const fann_type *run(const fann_type *input, Scratch &scratch) const;
+	// Same, but returns the value of every neuron, indexed the same way as FANN's neuron array
+	const fann_type *runNeurons(const fann_type *input, Scratch &scratch) const;
+
+	// Runs numRuns sets of inputs, BATCH_SIZE at a time, computing each layer as a matrix-matrix
+	// product so weights are reused across runs.  Outputs are written back-to-back and are
+	// identical to those from run().  inputs[i] points to the i-th set of inputs.
+	void runBatch(const fann_type *const *inputs, unsigned int numRuns, fann_type *outputs, Scratch &scratch) const;
+	// Same, for inputs stored back-to-back
+	void runBatch(const fann_type *inputs, unsigned int numRuns, fann_type *outputs, Scratch &scratch) const;
+
+	// Runs each set of inputs and totals the error against the desired outputs, as fann_test_data()
+	// does, but with batched evaluation
+	TestResult test(const fann_type *const *inputs, const fann_type *const *desiredOutputs, unsigned int numRuns, fann_type bitFailLimit, Scratch &scratch) const;
+
+	unsigned int getNumInput() const { return numInput; }
+	unsigned int getNumOutput() const { return numOutput; }
+
+private:
+	// Quantize and generate source from the layer layout
+	friend class QuantizedNet;
+	friend class SourceGenerator;
+
+	// Value of Layer::block for layers outside any triangular block
+	static const size_t NO_BLOCK = (size_t)-1;
+
+	// A set of neurons computed together from the same range of source neurons
+	struct Layer {
+		unsigned int first;
+		unsigned int count;
+		unsigned int srcFirst;
+		unsigned int srcCount;
+		size_t stride;
+		size_t weightOffset;
+		// Whether the layer is stored as compressed sparse rows rather than in weights.  Its rows
+		// start at sparseRowStarts[sparseRowFirst].
+		bool sparse;
+		size_t sparseRowFirst;
+		// Index in blocks of the triangular block holding the layer's weights, or NO_BLOCK
+		size_t block;
+		// Range of activationSegments covering this layer's neurons
+		size_t segmentFirst;
+		size_t segmentCount;
+	};
+
+	// Consecutive layers whose neurons each read every earlier neuron.  The block's rows are split
+	// at its first neuron.  Weights from earlier neurons form a row-major matrix, evaluated for the
+	// whole block at once when its first layer runs.  Weights between the block's own neurons form
+	// a lower triangle, stored by column, so that once a layer is computed each of its neurons is
+	// added to the sums of all later neurons with one vector operation.
+	struct TriangularBlock {
+		unsigned int first;
+		unsigned int count;
+		size_t stride;
+		size_t weightOffset;
+		// Column j holds the weights from neuron first + j to the block's neurons
+		size_t triangleStride;
+		size_t triangleOffset;
+	};
+
+	// A run of neurons in a layer sharing an activation function
+	struct ActivationSegment {
+		unsigned int first;
+		unsigned int count;
+		enum fann_activationfunc_enum activationFunction;
+	};
+
+	#ifdef FANNY_FIXED
+	// FANN's stepwise sigmoid breakpoints for one neuron, with values already divided by steepness
+	struct Stepwise {
+		fann_type v[6];
+		fann_type r[6];
+	};
+	#endif
+
+	CompiledNet();
+	void prepareScratch(Scratch &scratch) const;
+	void prepareBatchScratch(Scratch &scratch) const;
+	void activate(const Layer &layer, fann_type *values) const;
+	// Writes the weights of one of a layer's neurons over its whole source range, dense or not
+	void getDenseRow(const Layer &layer, unsigned int row, fann_type *out) const;
+	// Finishes a layer of a triangular block from the block's sums, which must include the block's
+	// matrix product and every earlier layer in the block, then adds the layer to later sums
+	void runTriangular(const Layer &layer, fann_type *values, fann_type *sums, const simd::Kernels &kernels, unsigned int shift) const;
+	// Runs up to BATCH_SIZE sets of inputs, leaving the results in scratch.batchValues
+	void runBlock(const fann_type *const *inputs, unsigned int count, Scratch &scratch) const;
+
+	unsigned long id;
+	unsigned int numInput;
+	unsigned int numOutput;
+	unsigned int totalNeurons;
+	// Distance between runs in Scratch::batchValues; totalNeurons rounded up for alignment
+	size_t valueStride;
+	unsigned int outputFirst;
+	std::vector<Layer> layers;
+	std::vector<TriangularBlock> blocks;
+	AlignedBuffer<fann_type> weights;
+	// Compressed sparse rows for sparse layers: the nonzero weights of each row and the neurons
+	// they read, in FANN's connection order, plus the start of each row followed by the end of the
+	// layer's last row
+	std::vector<uint32_t> sparseRowStarts;
+	std::vector<uint32_t> sparseColumns;
+	std::vector<fann_type> sparseWeights;
+	// Neurons whose value is always 1 (the multiplier, for fixed point)
+	std::vector<unsigned int> biasNeurons;
+	// Activation function and steepness of each neuron, indexed by neuron
+	std::vector<enum fann_activationfunc_enum> activationFunctions;
+	std::vector<fann_type> steepnesses;
+	std::vector<ActivationSegment> activationSegments;
+	bool fastActivations;
+
+	#ifdef FANNY_FIXED
+	unsigned int decimalPoint;
+	fann_type multiplier;
+	std::vector<Stepwise> stepwise;
+	#endif
+};
+
+}
+
+#endif
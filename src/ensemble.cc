@@ -0,0 +1,261 @@
+#include "ensemble.h"
+#include <nan.h>
+#include "fann-includes.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include "utils.h"
+#include "addon-data.h"
+
+namespace fanny {
+
+static bool v8StringToCombine(v8::Local<v8::Value> value, Ensemble::Combine &ret) {
+	if (!value->IsString()) return false;
+	std::string str(*v8::String::Utf8Value(value));
+	if (str == "mean") {
+		ret = Ensemble::COMBINE_MEAN;
+	} else if (str == "weighted") {
+		ret = Ensemble::COMBINE_WEIGHTED;
+	} else if (str == "all") {
+		ret = Ensemble::COMBINE_ALL;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+class EnsembleWorker : public Nan::AsyncWorker {
+
+public:
+	EnsembleWorker(Nan::Callback *callback, v8::Local<v8::Object> ensembleHolder, std::vector<fann_type> &_inputs,
+		unsigned int _numRuns, Ensemble::Combine _combine, unsigned int _numThreads) :
+		Nan::AsyncWorker(callback), inputs(_inputs), numRuns(_numRuns), combine(_combine), numThreads(_numThreads)
+	{
+		SaveToPersistent("ensembleHolder", ensembleHolder);
+		ensemble = Nan::ObjectWrap::Unwrap<Ensemble>(ensembleHolder);
+		for (size_t m = 0; m < ensemble->members.size(); m++) {
+			runners.push_back(new AsyncRunner(ensemble->members[m]));
+		}
+	}
+	~EnsembleWorker() {
+		for (size_t m = 0; m < runners.size(); m++) delete runners[m];
+	}
+
+	void Execute() {
+		unsigned int numMembers = (unsigned int)runners.size();
+		size_t memberSize = (size_t)numRuns * ensemble->numOutput;
+		std::vector<fann_type> memberOutputs(numMembers * memberSize);
+		std::vector<std::string> errors(numMembers);
+		// Threads take the next member not yet run until all have been
+		std::atomic<unsigned int> nextMember(0);
+		auto runMembers = [&]() {
+			for (unsigned int m = nextMember++; m < numMembers; m = nextMember++) {
+				runners[m]->runBatch(inputs.data(), numRuns, &memberOutputs[m * memberSize], errors[m]);
+			}
+		};
+		std::vector<std::thread> threads;
+		for (unsigned int t = 1; t < numThreads && t < numMembers; t++) threads.push_back(std::thread(runMembers));
+		runMembers();
+		for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+		for (unsigned int m = 0; m < numMembers; m++) {
+			if (!errors[m].empty()) return SetErrorMessage(errors[m].c_str());
+		}
+		outputs.resize((size_t)numRuns * ensemble->getRunOutputs(combine));
+		ensemble->combineOutputs(memberOutputs.data(), numRuns, combine, outputs.data());
+	}
+
+	void HandleOKCallback() {
+		Nan::HandleScope scope;
+		v8::Local<v8::Value> args[] = { Nan::Null(), fannDataToV8TypedArray(outputs.data(), outputs.size()) };
+		callback->Call(2, args);
+	}
+
+	Ensemble *ensemble;
+	std::vector<AsyncRunner *> runners;
+	std::vector<fann_type> inputs;
+	std::vector<fann_type> outputs;
+	unsigned int numRuns;
+	Ensemble::Combine combine;
+	unsigned int numThreads;
+};
+
+void Ensemble::Init(v8::Local<v8::Object> target) {
+	// Create new function template for this JS class constructor
+	v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+	// Set the class name
+	tpl->SetClassName(Nan::New("Ensemble").ToLocalChecked());
+	// Set the number of "slots" to allocate for fields on this class, not including prototype methods
+	tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+	// Add prototype methods
+	Nan::SetPrototypeMethod(tpl, "run", run);
+	Nan::SetPrototypeMethod(tpl, "runBatch", runBatch);
+	Nan::SetPrototypeMethod(tpl, "runBatchAsync", runBatchAsync);
+	Nan::SetPrototypeMethod(tpl, "getNumMembers", getNumMembers);
+	Nan::SetPrototypeMethod(tpl, "getNumInput", getNumInput);
+	Nan::SetPrototypeMethod(tpl, "getNumOutput", getNumOutput);
+
+	// Assign a property called 'Ensemble' to module.exports, pointing to our constructor
+	Nan::Set(target, Nan::New("Ensemble").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+Ensemble::~Ensemble() {
+	memberHandles.Reset();
+}
+
+unsigned int Ensemble::getRunOutputs(Combine combine) const {
+	return (combine == COMBINE_ALL) ? (unsigned int)members.size() * numOutput : numOutput;
+}
+
+void Ensemble::combineOutputs(const fann_type *memberOutputs, unsigned int numRuns, Combine combine, fann_type *outputs) const {
+	unsigned int numMembers = (unsigned int)members.size();
+	size_t memberSize = (size_t)numRuns * numOutput;
+	if (combine == COMBINE_ALL) {
+		for (unsigned int run = 0; run < numRuns; run++) {
+			for (unsigned int m = 0; m < numMembers; m++) {
+				const fann_type *src = memberOutputs + m * memberSize + (size_t)run * numOutput;
+				std::copy(src, src + numOutput, outputs + ((size_t)run * numMembers + m) * numOutput);
+			}
+		}
+		return;
+	}
+	for (size_t i = 0; i < memberSize; i++) {
+		double sum = 0;
+		for (unsigned int m = 0; m < numMembers; m++) {
+			double weight = (combine == COMBINE_WEIGHTED) ? weights[m] : 1.0 / numMembers;
+			sum += weight * memberOutputs[m * memberSize + i];
+		}
+		outputs[i] = (fann_type)sum;
+	}
+}
+
+NAN_METHOD(Ensemble::New) {
+	if (info.Length() < 1 || info.Length() > 2) return Nan::ThrowError("Takes an array of networks and optional weights");
+	if (!info[0]->IsArray()) return Nan::ThrowTypeError("First argument must be an array of networks");
+	v8::Local<v8::Array> memberArray = info[0].As<v8::Array>();
+	uint32_t numMembers = memberArray->Length();
+	if (!numMembers) return Nan::ThrowError("Ensemble must have at least one network");
+
+	Ensemble *ensemble = new Ensemble();
+	// Copied so changes to the caller's array don't release members
+	v8::Local<v8::Array> handles = Nan::New<v8::Array>(numMembers);
+	v8::Local<v8::FunctionTemplate> fannyTpl = Nan::New(AddonData::get()->fannyConstructorTpl);
+	for (uint32_t idx = 0; idx < numMembers; idx++) {
+		v8::Local<v8::Value> member = Nan::Get(memberArray, idx).ToLocalChecked();
+		if (!fannyTpl->HasInstance(member)) {
+			delete ensemble;
+			return Nan::ThrowTypeError("Ensemble members must be FANNY instances");
+		}
+		FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(member.As<v8::Object>());
+		if (idx == 0) {
+			ensemble->numInput = fanny->fann->get_num_input();
+			ensemble->numOutput = fanny->fann->get_num_output();
+		} else if (fanny->fann->get_num_input() != ensemble->numInput || fanny->fann->get_num_output() != ensemble->numOutput) {
+			delete ensemble;
+			return Nan::ThrowError("Ensemble members must have the same numbers of inputs and outputs");
+		}
+		ensemble->members.push_back(fanny);
+		Nan::Set(handles, idx, member);
+	}
+
+	ensemble->weights.assign(numMembers, 1.0 / numMembers);
+	if (info.Length() == 2 && !info[1]->IsUndefined()) {
+		if (!info[1]->IsArray() || info[1].As<v8::Array>()->Length() != numMembers) {
+			delete ensemble;
+			return Nan::ThrowTypeError("Weights must be an array with one number per network");
+		}
+		double total = 0;
+		for (uint32_t idx = 0; idx < numMembers; idx++) {
+			v8::Local<v8::Value> weight = Nan::Get(info[1].As<v8::Array>(), idx).ToLocalChecked();
+			if (!weight->IsNumber() || weight->NumberValue() < 0) {
+				delete ensemble;
+				return Nan::ThrowTypeError("Weights must be non-negative numbers");
+			}
+			ensemble->weights[idx] = weight->NumberValue();
+			total += ensemble->weights[idx];
+		}
+		if (total <= 0) {
+			delete ensemble;
+			return Nan::ThrowError("Weights must not all be zero");
+		}
+		for (uint32_t idx = 0; idx < numMembers; idx++) ensemble->weights[idx] /= total;
+	}
+
+	ensemble->memberHandles.Reset(handles);
+	ensemble->Wrap(info.This());
+	info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(Ensemble::run) {
+	Ensemble *ensemble = Nan::ObjectWrap::Unwrap<Ensemble>(info.Holder());
+	if (info.Length() != 2) return Nan::ThrowError("Takes two arguments");
+	if (!isV8NumberArray(info[0])) return Nan::ThrowError("First argument must be array");
+	Combine combine;
+	if (!v8StringToCombine(info[1], combine)) return Nan::ThrowError("Invalid combine mode");
+	FannDataView inputs(info[0]);
+	if (inputs.size() != ensemble->numInput) return Nan::ThrowError("Wrong number of inputs");
+	unsigned int numOutput = ensemble->numOutput;
+	std::vector<fann_type> memberOutputs(ensemble->members.size() * numOutput);
+	for (size_t m = 0; m < ensemble->members.size(); m++) {
+		if (!ensemble->members[m]->runBatchSync(inputs.data(), 1, &memberOutputs[m * numOutput])) return;
+	}
+	std::vector<fann_type> outputs(ensemble->getRunOutputs(combine));
+	ensemble->combineOutputs(memberOutputs.data(), 1, combine, outputs.data());
+	info.GetReturnValue().Set(fannDataToV8Array(outputs.data(), outputs.size()));
+}
+
+NAN_METHOD(Ensemble::runBatch) {
+	Ensemble *ensemble = Nan::ObjectWrap::Unwrap<Ensemble>(info.Holder());
+	if (info.Length() != 3) return Nan::ThrowError("Takes three arguments");
+	if (!isNumericTypedArray(info[0])) return Nan::ThrowError("First argument must be a typed array");
+	if (!info[1]->IsNumber()) return Nan::ThrowError("Second argument must be a number");
+	Combine combine;
+	if (!v8StringToCombine(info[2], combine)) return Nan::ThrowError("Invalid combine mode");
+	unsigned int numRuns = info[1]->Uint32Value();
+	FannDataView inputs(info[0]);
+	if (inputs.size() != (size_t)numRuns * ensemble->numInput) return Nan::ThrowError("Wrong number of inputs");
+	size_t memberSize = (size_t)numRuns * ensemble->numOutput;
+	std::vector<fann_type> memberOutputs(ensemble->members.size() * memberSize);
+	for (size_t m = 0; m < ensemble->members.size(); m++) {
+		if (!ensemble->members[m]->runBatchSync(inputs.data(), numRuns, &memberOutputs[m * memberSize])) return;
+	}
+	v8::Local<v8::Value> outputArray = fannDataToV8TypedArray(NULL, numRuns * ensemble->getRunOutputs(combine));
+	Nan::TypedArrayContents<fann_type> outputs(outputArray);
+	ensemble->combineOutputs(memberOutputs.data(), numRuns, combine, *outputs);
+	info.GetReturnValue().Set(outputArray);
+}
+
+NAN_METHOD(Ensemble::runBatchAsync) {
+	Ensemble *ensemble = Nan::ObjectWrap::Unwrap<Ensemble>(info.Holder());
+	if (info.Length() != 5) return Nan::ThrowError("Takes five arguments");
+	if (!isNumericTypedArray(info[0])) return Nan::ThrowError("First argument must be a typed array");
+	if (!info[1]->IsNumber()) return Nan::ThrowError("Second argument must be a number");
+	Combine combine;
+	if (!v8StringToCombine(info[2], combine)) return Nan::ThrowError("Invalid combine mode");
+	if (!info[3]->IsNumber() || info[3]->Uint32Value() < 1) return Nan::ThrowError("Number of threads must be a positive number");
+	if (!info[4]->IsFunction()) return Nan::ThrowError("Last argument must be callback");
+	unsigned int numRuns = info[1]->Uint32Value();
+	FannDataView inputView(info[0]);
+	if (inputView.size() != (size_t)numRuns * ensemble->numInput) return Nan::ThrowError("Wrong number of inputs");
+	// Converted once, then shared by every member's run
+	std::vector<fann_type> inputs(inputView.data(), inputView.data() + inputView.size());
+	Nan::Callback *callback = new Nan::Callback(info[4].As<v8::Function>());
+	Nan::AsyncQueueWorker(new EnsembleWorker(callback, info.Holder(), inputs, numRuns, combine, info[3]->Uint32Value()));
+}
+
+NAN_METHOD(Ensemble::getNumMembers) {
+	Ensemble *ensemble = Nan::ObjectWrap::Unwrap<Ensemble>(info.Holder());
+	info.GetReturnValue().Set((uint32_t)ensemble->members.size());
+}
+
+NAN_METHOD(Ensemble::getNumInput) {
+	Ensemble *ensemble = Nan::ObjectWrap::Unwrap<Ensemble>(info.Holder());
+	info.GetReturnValue().Set(ensemble->numInput);
+}
+
+NAN_METHOD(Ensemble::getNumOutput) {
+	Ensemble *ensemble = Nan::ObjectWrap::Unwrap<Ensemble>(info.Holder());
+	info.GetReturnValue().Set(ensemble->numOutput);
+}
+
+}
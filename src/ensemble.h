@@ -0,0 +1,76 @@
+#ifndef FANNY_ENSEMBLE_H
+#define FANNY_ENSEMBLE_H
+
+#include <nan.h>
+#include <vector>
+#include "fann-includes.h"
+#include "fanny.h"
+
+namespace fanny {
+
+// Several networks with the same numbers of inputs and outputs, run together on the same inputs.
+// Inputs are converted once for all members and the members' outputs are combined natively.
+class Ensemble : public Nan::ObjectWrap {
+
+public:
+	// Initialize this class and add itself to the exports
+	// This is NOT the Javascript class constructor method
+	static void Init(v8::Local<v8::Object> target);
+
+	// How the members' outputs are returned
+	enum Combine {
+		// Average of the members' outputs
+		COMBINE_MEAN,
+		// Average weighted by the member weights
+		COMBINE_WEIGHTED,
+		// Every member's outputs, one after another
+		COMBINE_ALL
+	};
+
+private:
+
+	// Javascript Constructor.  Takes an array of FANNY instances and, optionally, an array with a
+	// weight for each of them.
+	static NAN_METHOD(New);
+
+	// Runs every member on one set of inputs.  Takes the inputs and the combine mode ("mean",
+	// "weighted" or "all").  Returns an array of numOutput numbers, or numMembers * numOutput for "all".
+	static NAN_METHOD(run);
+
+	// Runs a batch of inputs stored back-to-back in a typed array.  Takes the typed array, the number
+	// of runs and the combine mode.  Returns a typed array of the combined outputs of each run; for
+	// "all", each run's outputs are every member's outputs one after another.
+	static NAN_METHOD(runBatch);
+
+	// Asynchronous version of "runBatch".  Also takes the maximum number of threads to run members
+	// on at once, and a callback.
+	static NAN_METHOD(runBatchAsync);
+
+	static NAN_METHOD(getNumMembers);
+	static NAN_METHOD(getNumInput);
+	static NAN_METHOD(getNumOutput);
+
+	// constructor & destructor
+	Ensemble() : numInput(0), numOutput(0) {}
+	~Ensemble();
+
+	// Number of outputs per run for the combine mode
+	unsigned int getRunOutputs(Combine combine) const;
+
+	friend class EnsembleWorker;
+
+	std::vector<FANNY *> members;
+	// Keeps the members' Javascript objects alive
+	Nan::Persistent<v8::Array> memberHandles;
+	// Weight of each member, scaled to add up to 1
+	std::vector<double> weights;
+	unsigned int numInput;
+	unsigned int numOutput;
+
+	// Combines member outputs stored by member, then run, into numRuns runs of outputs
+	void combineOutputs(const fann_type *memberOutputs, unsigned int numRuns, Combine combine, fann_type *outputs) const;
+};
+
+}
+
+#endif
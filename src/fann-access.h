@@ -0,0 +1,27 @@
+#ifndef FANNY_FANN_ACCESS_H
+#define FANNY_FANN_ACCESS_H
+
+#include "fann-includes.h"
+
+namespace fanny {
+
+// FANN::neural_net keeps its underlying struct fann in a protected member.  Code that needs to
+// read the network layout directly (neurons, connections, weights) uses this to get at it.
+inline struct fann *getFannStruct(FANN::neural_net *net) {
+	struct Access : public FANN::neural_net {
+		static struct fann *FANN::neural_net::*member() { return &Access::ann; }
+	};
+	return net->*Access::member();
+}
+
+// Same for FANN::training_data's struct fann_train_data
+inline struct fann_train_data *getTrainDataStruct(FANN::training_data *data) {
+	struct Access : public FANN::training_data {
+		static struct fann_train_data *FANN::training_data::*member() { return &Access::train_data; }
+	};
+	return data->*Access::member();
+}
+
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef FANNY_FANN_INTERNAL_H
+#define FANNY_FANN_INTERNAL_H
+
+#include "fann-includes.h"
+
+// Functions FANN's own training loops are built from.  They're declared in fann_internal.h, which
+// isn't installed with the library, but they're ordinary symbols in the static libraries we link.
+// These match the declarations in FANN 2.2's fann_internal.h.
+extern "C" {
+
+void fann_compute_MSE(struct fann *ann, fann_type *desired_output);
+// Adds one output's squared error to the network's MSE and bit fail count, and returns the error,
+// halved for symmetric activation functions
+fann_type fann_update_MSE(struct fann *ann, struct fann_neuron *neuron, fann_type neuron_diff);
+fann_type fann_activation_derived(unsigned int activation_function, fann_type steepness, fann_type value, fann_type sum);
+void fann_backpropagate_MSE(struct fann *ann);
+void fann_update_slopes_batch(struct fann *ann, struct fann_layer *layer_begin, struct fann_layer *layer_end);
+void fann_update_weights_quickprop(struct fann *ann, unsigned int num_data, unsigned int first_weight, unsigned int past_end);
+void fann_update_weights_batch(struct fann *ann, unsigned int num_data, unsigned int first_weight, unsigned int past_end);
+void fann_update_weights_irpropm(struct fann *ann, unsigned int first_weight, unsigned int past_end);
+void fann_update_weights_sarprop(struct fann *ann, unsigned int epoch, unsigned int first_weight, unsigned int past_end);
+void fann_clear_train_arrays(struct fann *ann);
+// Returns 0 once the network's MSE or bit fail count, depending on its stop function, is at or
+// below desired_error, otherwise -1
+int fann_desired_error_reached(struct fann *ann, float desired_error);
+
+}
+
+#endif
@@ -2,46 +2,78 @@
 #include <nan.h>
 #include "fann-includes.h"
 #include <iostream>
+#include <algorithm>
 #include "utils.h"
 #include "training-data.h"
+#include "simd-kernels.h"
+#include "fann-access.h"
+#include "source-generator.h"
+#include "addon-data.h"
+#include "shared-net.h"
+#include "output-reduction.h"
+#include "parallel-trainer.h"
+#include "mini-batch-trainer.h"
 
 namespace fanny {
 
 class RunWorker : public Nan::AsyncWorker {
 
 public:
-	RunWorker(Nan::Callback *callback, std::vector<fann_type> & _inputs, v8::Local<v8::Object> fannyHolder) : Nan::AsyncWorker(callback), inputs(_inputs) {
+	// inputs holds numRuns sets of inputs back-to-back.  Batch results are returned as a
+	// single typed array; single runs are returned as a regular array.
+	RunWorker(Nan::Callback *callback, std::vector<fann_type> & _inputs, unsigned int _numRuns, bool _isBatch, v8::Local<v8::Object> fannyHolder) :
+		Nan::AsyncWorker(callback), inputs(_inputs), numRuns(_numRuns), isBatch(_isBatch),
+		runner(Nan::ObjectWrap::Unwrap<FANNY>(fannyHolder))
+	{
 		SaveToPersistent("fannyHolder", fannyHolder);
-		fanny = Nan::ObjectWrap::Unwrap<FANNY>(fannyHolder);
+		FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(fannyHolder);
+		numOutputs = fanny->fann->get_num_output();
+		cache = fanny->predictionCache;
+		if (cache) cacheGeneration = cache->getGeneration();
+		stats = fanny->stats;
+		if (stats) queuedAt = LatencyHistogram::now();
 	}
-	~RunWorker() {}
 
 	void Execute() {
-		fann_type *fannOutputs = fanny->fann->run(&inputs[0]);
-		if (fanny->fann->get_errno()) {
-			SetErrorMessage(fanny->fann->get_errstr().c_str());
-			fanny->fann->reset_errno();
-			fanny->fann->reset_errstr();
-			return;
+		uint64_t start = 0;
+		if (stats) {
+			start = LatencyHistogram::now();
+			stats->runQueue.record(start - queuedAt);
 		}
-		unsigned int numOutputs = fanny->fann->get_num_output();
-		for (unsigned int idx = 0; idx < numOutputs; idx++) {
-			outputs.push_back(fannOutputs[idx]);
+		outputs.resize(numRuns * numOutputs);
+		std::string error;
+		bool ok;
+		if (cache) {
+			AsyncRunner &r = runner;
+			ok = cache->runBatch(inputs.data(), numRuns, outputs.data(), cacheGeneration, [&r, &error](fann_type *in, unsigned int n, fann_type *out) {
+				return r.runBatch(in, n, out, error);
+			});
+		} else {
+			ok = runner.runBatch(inputs.data(), numRuns, outputs.data(), error);
 		}
+		if (!ok) SetErrorMessage(error.c_str());
+		if (stats) stats->runExecute.recordSince(start);
 	}
 
 	void HandleOKCallback() {
 		Nan::HandleScope scope;
 		v8::Local<v8::Value> args[] = {
 			Nan::Null(),
-			fannDataToV8Array(&outputs[0], outputs.size())
+			isBatch ? fannDataToV8TypedArray(outputs.data(), outputs.size()) : fannDataToV8Array(&outputs[0], outputs.size())
 		};
 		callback->Call(2, args);
 	}
 
 	std::vector<fann_type> inputs;
 	std::vector<fann_type> outputs;
-	FANNY *fanny;
+	unsigned int numRuns;
+	unsigned int numOutputs;
+	bool isBatch;
+	AsyncRunner runner;
+	std::shared_ptr<PredictionCache> cache;
+	unsigned long cacheGeneration;
+	std::shared_ptr<FANNY::LatencyStats> stats;
+	uint64_t queuedAt;
 };
 
 class LoadFileWorker : public Nan::AsyncWorker {
@@ -54,6 +86,9 @@ public:
 		if (!ann) return SetErrorMessage("Error loading FANN file");
 		fann = new FANN::neural_net(ann);
 		fann_destroy(ann);
+		#ifndef FANNY_FIXED
+		small = SmallNet::create(fann);
+		#endif
 	}
 
 	void HandleOKCallback() {
@@ -64,18 +99,25 @@ public:
 			callback->Call(1, args);
 		} else {
 			v8::Local<v8::Value> externFann = Nan::New<v8::External>(fann);
-			v8::Local<v8::Function> ctor = Nan::New(FANNY::constructorFunction);
+			v8::Local<v8::Function> ctor = Nan::New(AddonData::get()->fannyConstructor);
 			v8::Local<v8::Value> ctorArgs[] = { externFann };
-			v8::Local<v8::Value> cbargs[] = {
-				Nan::Null(),
-				Nan::NewInstance(ctor, 1, ctorArgs).ToLocalChecked()
-			};
+			v8::Local<v8::Object> instance = Nan::NewInstance(ctor, 1, ctorArgs).ToLocalChecked();
+			#ifndef FANNY_FIXED
+			// The kernel was selected on the worker thread
+			FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(instance);
+			fanny->small = small;
+			fanny->smallAttempted = true;
+			#endif
+			v8::Local<v8::Value> cbargs[] = { Nan::Null(), instance };
 			callback->Call(2, cbargs);
 		}
 	}
 
 	std::string filename;
 	FANN::neural_net *fann;
+	#ifndef FANNY_FIXED
+	std::shared_ptr<SmallNet> small;
+	#endif
 };
 
 class SaveFileWorker : public Nan::AsyncWorker {
@@ -129,9 +171,22 @@ public:
 	float desiredError;
 	bool singleEpoch;
 	bool isTest;
+	// Threads to train on with ParallelTrainer, when the training algorithm supports it, and
+	// whether to train the incremental algorithm with Hogwild updates
+	unsigned int numThreads;
+	bool hogwild;
+	// Batch size when training with the MINIBATCH algorithm, otherwise 0
+	unsigned int miniBatchSize;
 
 	float retVal;
 	const ExecutionProgress *executionProgress;
+	// Compiled network used to test data when the SIMD engine is selected
+	std::shared_ptr<CompiledNet> compiled;
+	// Epoch latencies are recorded here while stats are enabled.  The progress callback records the
+	// epochs since the last report, made at lastReportTime after lastReportEpochs epochs.
+	std::shared_ptr<FANNY::LatencyStats> stats;
+	uint64_t lastReportTime;
+	unsigned int lastReportEpochs;
 
 	TrainWorker(
 		Nan::Callback *callback,
@@ -144,10 +199,12 @@ public:
 		unsigned int _iterationsBetweenReports,
 		float _desiredError,
 		bool _singleEpoch,
-		bool _isTest
+		bool _isTest,
+		unsigned int _numThreads,
+		bool _hogwild
 	) : Nan::AsyncProgressWorker(callback), trainFromFile(_trainFromFile), filename(_filename),
 	isCascade(_isCascade), maxIterations(_maxIterations), iterationsBetweenReports(_iterationsBetweenReports),
-	desiredError(_desiredError), singleEpoch(_singleEpoch), isTest(_isTest), retVal(-1) {
+	desiredError(_desiredError), singleEpoch(_singleEpoch), isTest(_isTest), numThreads(_numThreads), hogwild(_hogwild), retVal(-1) {
 		SaveToPersistent("fannyHolder", fannyHolder);
 		fanny = Nan::ObjectWrap::Unwrap<FANNY>(fannyHolder);
 		if (!maybeTrainingDataHolder.IsEmpty()) {
@@ -155,17 +212,67 @@ public:
 			SaveToPersistent("tdHolder", trainingDataHolder);
 			trainingData = Nan::ObjectWrap::Unwrap<TrainingData>(trainingDataHolder);
 		}
+		if (isTest && !trainFromFile) compiled = fanny->getCompiled();
+		if (!isTest && !isCascade) stats = fanny->stats;
+		miniBatchSize = fanny->miniBatch ? fanny->batchSize : 0;
 	}
 
+	// fann->test_data(), run with the compiled network.  Leaves the MSE and bit fail count in
+	// fann just as test_data() would.
+	float testCompiled(FANN::training_data &data) {
+		if (data.num_input_train_data() != compiled->getNumInput() || data.num_output_train_data() != compiled->getNumOutput()) {
+			return fanny->fann->test_data(data);
+		}
+		CompiledNet::Scratch scratch;
+		struct fann *ann = getFannStruct(fanny->fann);
+		CompiledNet::TestResult result = compiled->test(data.get_input(), data.get_output(), data.length_train_data(), ann->bit_fail_limit, scratch);
+		ann->MSE_value = result.mseValue;
+		ann->num_MSE = result.numMse;
+		ann->num_bit_fail = result.numBitFail;
+		return fanny->fann->get_MSE();
+	}
+
+	#ifndef FANNY_FIXED
+	// Trains with MiniBatchTrainer on trainingData or the file
+	void trainMiniBatch() {
+		MiniBatchTrainer trainer(fanny->fann, miniBatchSize);
+		if (!trainFromFile) {
+			trainer.trainOnData(*trainingData->trainingData, maxIterations, iterationsBetweenReports, desiredError);
+			return;
+		}
+		FANN::training_data fileData;
+		if (!fileData.read_train_from_file(filename)) {
+			SetErrorMessage("Error reading training data file");
+			return;
+		}
+		trainer.trainOnData(fileData, maxIterations, iterationsBetweenReports, desiredError);
+	}
+	#endif
+
 	void Execute(const ExecutionProgress &progress) {
 		executionProgress = &progress;
 		fanny->currentTrainWorker = this;
 		fanny->cancelTrainingFlag = false;
+		lastReportTime = stats ? LatencyHistogram::now() : 0;
+		lastReportEpochs = 0;
 		#ifndef FANNY_FIXED
-		if (isTest) {
+		if (isTest && compiled) {
+			retVal = testCompiled(*trainingData->trainingData);
+		} else if (isTest) {
 			retVal = fanny->fann->test_data(*trainingData->trainingData);
+		} else if (singleEpoch && miniBatchSize) {
+			MiniBatchTrainer trainer(fanny->fann, miniBatchSize);
+			retVal = trainer.trainEpoch(*trainingData->trainingData);
+			if (stats) stats->trainEpoch.recordSince(lastReportTime);
 		} else if (singleEpoch) {
 			retVal = fanny->fann->train_epoch(*trainingData->trainingData);
+			if (stats) stats->trainEpoch.recordSince(lastReportTime);
+		} else if (!isCascade && miniBatchSize) {
+			trainMiniBatch();
+		} else if (!trainFromFile && !isCascade && numThreads > 1 && ParallelTrainer::supports(fanny->fann, hogwild)) {
+			FANN::training_data &data = *trainingData->trainingData;
+			ParallelTrainer trainer(fanny->fann, std::min(numThreads, data.length_train_data()), hogwild);
+			trainer.trainOnData(data, maxIterations, iterationsBetweenReports, desiredError);
 		} else if (!trainFromFile && !isCascade) {
 			fanny->fann->train_on_data(*trainingData->trainingData, maxIterations, iterationsBetweenReports, desiredError);
 		} else if (trainFromFile && !isCascade) {
@@ -186,6 +293,12 @@ public:
 		fanny->currentTrainWorker = NULL;
 	}
 
+	void WorkComplete() {
+		// Training modifies the weights, so existing replicas are out of date
+		if (!isTest) fanny->netChanged();
+		Nan::AsyncProgressWorker::WorkComplete();
+	}
+
 	void HandleOKCallback() {
 		Nan::HandleScope scope;
 		if (fanny->cancelTrainingFlag) {
@@ -223,7 +336,7 @@ void FANNY::Init(v8::Local<v8::Object> target) {
 	// Set the number of "slots" to allocate for fields on this class, not including prototype methods
 	tpl->InstanceTemplate()->SetInternalFieldCount(1);
 	// Save a constructor reference
-	FANNY::constructorFunctionTpl.Reset(tpl);
+	AddonData::get()->fannyConstructorTpl.Reset(tpl);
 
 	// Add prototype methods
 
@@ -232,6 +345,9 @@ void FANNY::Init(v8::Local<v8::Object> target) {
 	Nan::SetPrototypeMethod(tpl, "randomizeWeights", randomizeWeights);
 
 	Nan::SetPrototypeMethod(tpl, "save", save);
+	Nan::SetPrototypeMethod(tpl, "getSharedSize", getSharedSize);
+	Nan::SetPrototypeMethod(tpl, "exportShared", exportShared);
+	Nan::SetPrototypeMethod(tpl, "isShared", isShared);
 	Nan::SetPrototypeMethod(tpl, "saveToFixed", saveToFixed);
 	Nan::SetPrototypeMethod(tpl, "setCallback", setCallback);
 	Nan::SetPrototypeMethod(tpl, "trainEpoch", trainEpoch);
@@ -240,6 +356,7 @@ void FANNY::Init(v8::Local<v8::Object> target) {
 	Nan::SetPrototypeMethod(tpl, "cascadetrainOnData", cascadetrainOnData);
 	Nan::SetPrototypeMethod(tpl, "cascadetrainOnFile", cascadetrainOnFile);
 	Nan::SetPrototypeMethod(tpl, "run", run);
+	Nan::SetPrototypeMethod(tpl, "runInto", runInto);
 	Nan::SetPrototypeMethod(tpl, "getTrainingAlgorithm", getTrainingAlgorithm);
 	Nan::SetPrototypeMethod(tpl, "setTrainingAlgorithm", setTrainingAlgorithm);
 	Nan::SetPrototypeMethod(tpl, "getTrainErrorFunction", getTrainErrorFunction);
@@ -259,6 +376,10 @@ void FANNY::Init(v8::Local<v8::Object> target) {
 	Nan::SetPrototypeMethod(tpl, "getTotalConnections", getTotalConnections);
 	Nan::SetPrototypeMethod(tpl, "getConnectionArray", getConnectionArray);
 	Nan::SetPrototypeMethod(tpl, "getNumLayers", getNumLayers);
+	#ifdef FANNY_FIXED
+	Nan::SetPrototypeMethod(tpl, "getDecimalPoint", getDecimalPoint);
+	Nan::SetPrototypeMethod(tpl, "getMultiplier", getMultiplier);
+	#endif
 	Nan::SetPrototypeMethod(tpl, "getBitFail", getBitFail);
 	Nan::SetPrototypeMethod(tpl, "getBitFailLimit", getBitFailLimit);
 	Nan::SetPrototypeMethod(tpl, "setBitFailLimit", setBitFailLimit);
@@ -272,6 +393,10 @@ void FANNY::Init(v8::Local<v8::Object> target) {
 	Nan::SetPrototypeMethod(tpl, "getRpropDeltaMin", getRpropDeltaMin);
 	Nan::SetPrototypeMethod(tpl, "getRpropDeltaMax", getRpropDeltaMax);
 	Nan::SetPrototypeMethod(tpl, "runAsync", runAsync);
+	Nan::SetPrototypeMethod(tpl, "runBatch", runBatch);
+	Nan::SetPrototypeMethod(tpl, "runBatchAsync", runBatchAsync);
+	Nan::SetPrototypeMethod(tpl, "runReduced", runReduced);
+	Nan::SetPrototypeMethod(tpl, "runBatchReduced", runBatchReduced);
 	Nan::SetPrototypeMethod(tpl, "initWeights", initWeights);
 	Nan::SetPrototypeMethod(tpl, "testData", testData);
 	Nan::SetPrototypeMethod(tpl, "getLayerArray", getLayerArray);
@@ -342,6 +467,27 @@ void FANNY::Init(v8::Local<v8::Object> target) {
 	Nan::SetPrototypeMethod(tpl, "setWeightArray", setWeightArray);
 	Nan::SetPrototypeMethod(tpl, "setWeight", setWeight);
 
+	Nan::SetPrototypeMethod(tpl, "getRunConcurrency", getRunConcurrency);
+	Nan::SetPrototypeMethod(tpl, "setRunConcurrency", setRunConcurrency);
+	Nan::SetPrototypeMethod(tpl, "getBatchSize", getBatchSize);
+	Nan::SetPrototypeMethod(tpl, "setBatchSize", setBatchSize);
+	Nan::SetPrototypeMethod(tpl, "getEngine", getEngine);
+	Nan::SetPrototypeMethod(tpl, "setEngine", setEngine);
+	Nan::SetPrototypeMethod(tpl, "getActivationMode", getActivationMode);
+	Nan::SetPrototypeMethod(tpl, "setActivationMode", setActivationMode);
+	Nan::SetPrototypeMethod(tpl, "quantize", quantize);
+	Nan::SetPrototypeMethod(tpl, "getSpecializedKernel", getSpecializedKernel);
+	Nan::SetPrototypeMethod(tpl, "generateSource", generateSource);
+	Nan::SetPrototypeMethod(tpl, "setPredictionCache", setPredictionCache);
+	Nan::SetPrototypeMethod(tpl, "getPredictionCacheSize", getPredictionCacheSize);
+	Nan::SetPrototypeMethod(tpl, "getPredictionCacheQuantum", getPredictionCacheQuantum);
+	Nan::SetPrototypeMethod(tpl, "getPredictionCacheStats", getPredictionCacheStats);
+	Nan::SetPrototypeMethod(tpl, "resetPredictionCacheStats", resetPredictionCacheStats);
+	Nan::SetPrototypeMethod(tpl, "getStatsEnabled", getStatsEnabled);
+	Nan::SetPrototypeMethod(tpl, "setStatsEnabled", setStatsEnabled);
+	Nan::SetPrototypeMethod(tpl, "getStats", getStats);
+	Nan::SetPrototypeMethod(tpl, "resetStats", resetStats);
+
 	Nan::SetPrototypeMethod(tpl, "getUserDataString", getUserDataString);
 	Nan::SetPrototypeMethod(tpl, "setUserDataString", setUserDataString);
 
@@ -353,24 +499,228 @@ void FANNY::Init(v8::Local<v8::Object> target) {
 	v8::Local<v8::Function> disableSeedRandFunction = Nan::GetFunction(disableSeedRandTpl).ToLocalChecked();
 	v8::Local<v8::FunctionTemplate> enableSeedRandTpl = Nan::New<v8::FunctionTemplate>(enableSeedRand);
 	v8::Local<v8::Function> enableSeedRandFunction = Nan::GetFunction(enableSeedRandTpl).ToLocalChecked();
+	v8::Local<v8::FunctionTemplate> getSimdLevelTpl = Nan::New<v8::FunctionTemplate>(getSimdLevel);
+	v8::Local<v8::Function> getSimdLevelFunction = Nan::GetFunction(getSimdLevelTpl).ToLocalChecked();
 
 	// Assign a property called 'FANNY' to module.exports, pointing to our constructor
 	v8::Local<v8::Function> ctorFunction = Nan::GetFunction(tpl).ToLocalChecked();
 	Nan::Set(ctorFunction, Nan::New("loadFile").ToLocalChecked(), loadFileFunction);
 	Nan::Set(ctorFunction, Nan::New("disableSeedRand").ToLocalChecked(), disableSeedRandFunction);
 	Nan::Set(ctorFunction, Nan::New("enableSeedRand").ToLocalChecked(), enableSeedRandFunction);
-	FANNY::constructorFunction.Reset(ctorFunction);
+	Nan::Set(ctorFunction, Nan::New("getSimdLevel").ToLocalChecked(), getSimdLevelFunction);
+	AddonData::get()->fannyConstructor.Reset(ctorFunction);
 	Nan::Set(target, Nan::New("FANNY").ToLocalChecked(), ctorFunction);
 }
 
 
-Nan::Persistent<v8::FunctionTemplate> FANNY::constructorFunctionTpl;
-Nan::Persistent<v8::Function> FANNY::constructorFunction;
-
-FANNY::FANNY(FANN::neural_net *_fann) : fann(_fann), currentTrainWorker(NULL) {}
+FANNY::FANNY(FANN::neural_net *_fann) : fann(_fann), currentTrainWorker(NULL), runConcurrency(1), netVersion(0),
+	engine(ENGINE_FANN), fastActivations(false), compileAttempted(false), miniBatch(false), batchSize(32)
+{
+	#ifndef FANNY_FIXED
+	smallAttempted = false;
+	#endif
+}
 
 FANNY::~FANNY() {
-	delete fann;
+	for (size_t i = 0; i < replicaPool.size(); i++) delete replicaPool[i];
+	if (sharedBuffer.IsEmpty()) {
+		delete fann;
+	} else {
+		SharedNet::destroy(fann);
+		sharedBuffer.Reset();
+	}
+}
+
+FANN::neural_net *FANNY::acquireReplica() {
+	if (runConcurrency <= 1) return fann;
+	if (replicaPool.empty()) {
+		if (!snapshot) snapshot = WeightSnapshot::create(fann);
+		return new WeightSnapshot::Executor(snapshot);
+	}
+	FANN::neural_net *replica = replicaPool.back();
+	replicaPool.pop_back();
+	return replica;
+}
+
+void FANNY::releaseReplica(FANN::neural_net *replica, unsigned int version) {
+	if (replica == fann) return;
+	WeightSnapshot::Executor *executor = static_cast<WeightSnapshot::Executor *>(replica);
+	// With runConcurrency back at 1, runs use fann and would never take it from the pool
+	if (version == netVersion && runConcurrency > 1 && replicaPool.size() < runConcurrency) {
+		replicaPool.push_back(executor);
+	} else {
+		delete executor;
+	}
+}
+
+bool FANNY::checkWritable() {
+	if (sharedBuffer.IsEmpty()) return true;
+	Nan::ThrowError("Weights of a shared network are read-only; clone it to change them");
+	return false;
+}
+
+void FANNY::netChanged() {
+	netVersion++;
+	for (size_t i = 0; i < replicaPool.size(); i++) delete replicaPool[i];
+	replicaPool.clear();
+	snapshot.reset();
+	engineChanged();
+	#ifndef FANNY_FIXED
+	// The quantized copy no longer matches the network, so runs go back to FANN
+	if (engine == ENGINE_INT8) engine = ENGINE_FANN;
+	quantized.reset();
+	small.reset();
+	smallAttempted = false;
+	#endif
+}
+
+void FANNY::engineChanged() {
+	compiled.reset();
+	compileAttempted = false;
+	if (predictionCache) predictionCache->clear();
+}
+
+const std::shared_ptr<CompiledNet> &FANNY::getCompiled() {
+	if (engine == ENGINE_SIMD && !compileAttempted) {
+		compiled = CompiledNet::compile(fann, fastActivations);
+		compileAttempted = true;
+	}
+	return compiled;
+}
+
+#ifndef FANNY_FIXED
+const std::shared_ptr<SmallNet> &FANNY::getSmallNet() {
+	static const std::shared_ptr<SmallNet> none;
+	if (engine != ENGINE_FANN) return none;
+	if (!smallAttempted) {
+		small = SmallNet::create(fann);
+		smallAttempted = true;
+	}
+	return small;
+}
+#endif
+
+const fann_type *FANNY::runOne(fann_type *input) {
+	uint64_t start = stats ? LatencyHistogram::now() : 0;
+	const fann_type *output;
+	if (!predictionCache) {
+		output = runOneUncached(input);
+	} else {
+		cachedOutput.resize(fann->get_num_output());
+		if (predictionCache->lookup(input, cachedOutput.data())) {
+			output = cachedOutput.data();
+		} else {
+			unsigned long generation = predictionCache->getGeneration();
+			output = runOneUncached(input);
+			if (!fann->get_errno()) predictionCache->insert(input, output, generation);
+		}
+	}
+	if (stats) stats->run.recordSince(start);
+	return output;
+}
+
+bool FANNY::runBatchSync(fann_type *inputs, unsigned int numRuns, fann_type *outputs) {
+	uint64_t start = stats ? LatencyHistogram::now() : 0;
+	bool ok;
+	if (!predictionCache) {
+		ok = runBatchUncached(inputs, numRuns, outputs);
+	} else {
+		ok = predictionCache->runBatch(inputs, numRuns, outputs, predictionCache->getGeneration(), [this](fann_type *in, unsigned int n, fann_type *out) {
+			return runBatchUncached(in, n, out);
+		});
+	}
+	if (stats) stats->run.recordSince(start);
+	return ok;
+}
+
+const fann_type *FANNY::runOneUncached(fann_type *input) {
+	const std::shared_ptr<CompiledNet> &cn = getCompiled();
+	if (cn) return cn->run(input, mainScratch);
+	#ifndef FANNY_FIXED
+	if (engine == ENGINE_INT8 && quantized) return quantized->run(input, quantizedScratch);
+	const std::shared_ptr<SmallNet> &sn = getSmallNet();
+	if (sn) {
+		// Outputs go where fann_run() leaves them
+		fann_type *output = getFannStruct(fann)->output;
+		sn->run(input, output);
+		return output;
+	}
+	#endif
+	return fann->run(input);
+}
+
+bool FANNY::runBatchUncached(fann_type *inputs, unsigned int numRuns, fann_type *outputs) {
+	const std::shared_ptr<CompiledNet> &cn = getCompiled();
+	if (cn) {
+		cn->runBatch(inputs, numRuns, outputs, mainScratch);
+		return true;
+	}
+	#ifndef FANNY_FIXED
+	if (engine == ENGINE_INT8 && quantized) {
+		quantized->runBatch(inputs, numRuns, outputs, quantizedScratch);
+		return true;
+	}
+	const std::shared_ptr<SmallNet> &sn = getSmallNet();
+	if (sn) {
+		sn->runBatch(inputs, numRuns, outputs);
+		return true;
+	}
+	#endif
+	unsigned int numInputs = fann->get_num_input();
+	unsigned int numOutputs = fann->get_num_output();
+	for (unsigned int run = 0; run < numRuns; run++) {
+		fann_type *runOutputs = fann->run(inputs + run * numInputs);
+		if (checkError()) return false;
+		std::copy(runOutputs, runOutputs + numOutputs, outputs + run * numOutputs);
+	}
+	return true;
+}
+
+AsyncRunner::AsyncRunner(FANNY *_fanny) : fanny(_fanny) {
+	numInputs = fanny->fann->get_num_input();
+	numOutputs = fanny->fann->get_num_output();
+	// Compiled networks are read-only, so they can be shared instead of taking a replica
+	compiled = fanny->getCompiled();
+	#ifndef FANNY_FIXED
+	if (fanny->engine == FANNY::ENGINE_INT8) quantized = fanny->quantized;
+	small = fanny->getSmallNet();
+	net = (compiled || quantized || small) ? NULL : fanny->acquireReplica();
+	#else
+	net = compiled ? NULL : fanny->acquireReplica();
+	#endif
+	netVersion = fanny->netVersion;
+}
+
+AsyncRunner::~AsyncRunner() {
+	if (net) fanny->releaseReplica(net, netVersion);
+}
+
+bool AsyncRunner::runBatch(fann_type *inputs, unsigned int numRuns, fann_type *outputs, std::string &error) {
+	if (compiled) {
+		compiled->runBatch(inputs, numRuns, outputs, scratch);
+		return true;
+	}
+	#ifndef FANNY_FIXED
+	if (quantized) {
+		quantized->runBatch(inputs, numRuns, outputs, quantizedScratch);
+		return true;
+	}
+	if (small) {
+		small->runBatch(inputs, numRuns, outputs);
+		return true;
+	}
+	#endif
+	for (unsigned int run = 0; run < numRuns; run++) {
+		fann_type *runOutputs = net->run(inputs + run * numInputs);
+		if (net->get_errno()) {
+			error = net->get_errstr();
+			net->reset_errno();
+			net->reset_errstr();
+			return false;
+		}
+		std::copy(runOutputs, runOutputs + numOutputs, outputs + run * numOutputs);
+	}
+	return true;
 }
 
 NAN_METHOD(FANNY::printConnections) {
@@ -385,6 +735,7 @@ NAN_METHOD(FANNY::printParameters) {
 
 NAN_METHOD(FANNY::randomizeWeights) {
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (!fanny->checkWritable()) return;
 	if (info.Length() != 2) return Nan::ThrowError("Must have 2 arguments: min_weight and max_weight");
 
 	if (!info[0]->IsNumber() || !info[1]->IsNumber()) {
@@ -394,6 +745,7 @@ NAN_METHOD(FANNY::randomizeWeights) {
 	fann_type max_weight = v8NumberToFannType(info[1]);
 
 	fanny->fann->randomize_weights(min_weight, max_weight);
+	fanny->netChanged();
 }
 
 NAN_METHOD(FANNY::loadFile) {
@@ -410,17 +762,55 @@ NAN_METHOD(FANNY::New) {
 	}
 
 	FANN::neural_net *fann;
-
-	if (Nan::New(FANNY::constructorFunctionTpl)->HasInstance(info[0])) {
+	unsigned int runConcurrency = 1;
+	FANNY::Engine engine = FANNY::ENGINE_FANN;
+	bool fastActivations = false;
+	#ifndef FANNY_FIXED
+	std::shared_ptr<QuantizedNet> quantized;
+	std::shared_ptr<SmallNet> small;
+	bool smallAttempted = false;
+	#endif
+	std::shared_ptr<WeightSnapshot> snapshot;
+	size_t cacheBytes = 0;
+	double cacheQuantum = 0;
+	bool statsEnabled = false;
+	bool miniBatch = false;
+	unsigned int batchSize = 32;
+
+	if (Nan::New(AddonData::get()->fannyConstructorTpl)->HasInstance(info[0])) {
 		// Copy constructor
 		FANNY *other = Nan::ObjectWrap::Unwrap<FANNY>(info[0].As<v8::Object>());
 		fann = new FANN::neural_net(*other->fann);
+		runConcurrency = other->runConcurrency;
+		engine = other->engine;
+		fastActivations = other->fastActivations;
+		#ifndef FANNY_FIXED
+		// The copy has the same weights, so it can share the read-only quantized network and kernel
+		quantized = other->quantized;
+		small = other->small;
+		smallAttempted = other->smallAttempted;
+		#endif
+		snapshot = other->snapshot;
+		// The copy gets an empty cache with the same settings
+		if (other->predictionCache) {
+			cacheBytes = other->predictionCache->getMaxBytes();
+			cacheQuantum = other->predictionCache->getQuantum();
+		}
+		statsEnabled = (bool)other->stats;
+		miniBatch = other->miniBatch;
+		batchSize = other->batchSize;
 	} else if (info[0]->IsString()) {
 		// Load-from-file constructor
 		fann = new FANN::neural_net(std::string(*v8::String::Utf8Value(info[0])));
 	} else if (info[0]->IsExternal()) {
 		// Internal from-instance constructor
 		fann = (FANN::neural_net *)info[0].As<v8::External>()->Value();
+	} else if (info[0]->IsUint8Array()) {
+		// Attach to a network exported to a SharedArrayBuffer
+		Nan::TypedArrayContents<uint8_t> contents(info[0]);
+		std::string error;
+		fann = SharedNet::attach(*contents, contents.length(), error);
+		if (!fann) return Nan::ThrowError(error.c_str());
 	} else if (info[0]->IsObject()) {
 		// Options constructor
 
@@ -476,9 +866,9 @@ NAN_METHOD(FANNY::New) {
 		// Construct the neural_net underlying class
 		if (!optType.compare("standard") || optType.empty()) {
 			fann = new FANN::neural_net(FANN::network_type_enum::LAYER, (unsigned int)optLayers.size(), (const unsigned int *)&optLayers[0]);
-		} else if(optType.compare("sparse")) {
+		} else if (!optType.compare("sparse")) {
 			fann = new FANN::neural_net(optConnectionRate, optLayers.size(), &optLayers[0]);
-		} else if (optType.compare("shortcut")) {
+		} else if (!optType.compare("shortcut")) {
 			fann = new FANN::neural_net(FANN::network_type_enum::SHORTCUT, optLayers.size(), &optLayers[0]);
 		} else {
 			return Nan::ThrowError("Invalid type option");
@@ -487,7 +877,31 @@ NAN_METHOD(FANNY::New) {
 		return Nan::ThrowTypeError("Invalid argument type");
 	}
 
+	#ifndef FANNY_FIXED
+	// Networks from LoadFileWorker have their kernel selected there
+	if (!smallAttempted && !info[0]->IsExternal()) {
+		small = SmallNet::create(fann);
+		smallAttempted = true;
+	}
+	#endif
+
 	FANNY *obj = new FANNY(fann);
+	obj->runConcurrency = runConcurrency;
+	obj->engine = engine;
+	obj->fastActivations = fastActivations;
+	#ifndef FANNY_FIXED
+	obj->quantized = quantized;
+	obj->small = small;
+	obj->smallAttempted = smallAttempted;
+	#endif
+	obj->snapshot = snapshot;
+	if (cacheBytes) {
+		obj->predictionCache = std::make_shared<PredictionCache>(cacheBytes, cacheQuantum, fann->get_num_input(), fann->get_num_output());
+	}
+	if (statsEnabled) obj->stats = std::make_shared<LatencyStats>();
+	obj->miniBatch = miniBatch;
+	obj->batchSize = batchSize;
+	if (info[0]->IsUint8Array()) obj->sharedBuffer.Reset(info[0].As<v8::Object>());
 	obj->Wrap(info.This());
 	info.GetReturnValue().Set(info.This());
 }
@@ -522,6 +936,25 @@ NAN_METHOD(FANNY::saveToFixed) {
 	Nan::AsyncQueueWorker(new SaveFileWorker(callback, info.Holder(), filename, true));
 }
 
+NAN_METHOD(FANNY::getSharedSize) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	info.GetReturnValue().Set(Nan::New<v8::Number>((double)SharedNet::getExportSize(fanny->fann)));
+}
+
+NAN_METHOD(FANNY::exportShared) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 1 || !info[0]->IsUint8Array()) return Nan::ThrowTypeError("Argument must be a Uint8Array");
+	Nan::TypedArrayContents<uint8_t> contents(info[0]);
+	if (contents.length() < SharedNet::getExportSize(fanny->fann)) return Nan::ThrowRangeError("Buffer is too small");
+	if ((size_t)*contents % 8 != 0) return Nan::ThrowError("Buffer must be aligned to 8 bytes");
+	SharedNet::exportTo(fanny->fann, *contents);
+}
+
+NAN_METHOD(FANNY::isShared) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	info.GetReturnValue().Set(Nan::New<v8::Boolean>(!fanny->sharedBuffer.IsEmpty()));
+}
+
 int FANNY::fannInternalCallback(
 	FANN::neural_net &fann,
 	FANN::training_data &train,
@@ -532,12 +965,20 @@ int FANNY::fannInternalCallback(
 	void *user_data
 ) {
 	FANNY *fanny = (FANNY *)user_data;
+	TrainWorker *worker = fanny->currentTrainWorker;
+	if (worker && worker->stats && epochs > worker->lastReportEpochs) {
+		uint64_t now = LatencyHistogram::now();
+		unsigned int numEpochs = epochs - worker->lastReportEpochs;
+		worker->stats->trainEpoch.record((now - worker->lastReportTime) / numEpochs, numEpochs);
+		worker->lastReportTime = now;
+		worker->lastReportEpochs = epochs;
+	}
 	fanny->currentTrainingProgress.epochs = epochs;
 	fanny->currentTrainingProgress.mse = fanny->fann->get_MSE();
 	fanny->currentTrainingProgress.bitFail = fanny->fann->get_bit_fail();
 	fanny->currentTrainingProgress.neurons = fanny->fann->get_total_neurons();
-	if (fanny->currentTrainWorker && fanny->currentTrainWorker->executionProgress) {
-		fanny->currentTrainWorker->executionProgress->Signal();
+	if (worker && worker->executionProgress) {
+		worker->executionProgress->Signal();
 	}
 	if (fanny->cancelTrainingFlag) {
 		return -1;
@@ -570,8 +1011,13 @@ void FANNY::_doTrainOrTest(
 ) {
 	#ifndef FANNY_FIXED
 	bool hasConfigParams = !singleEpoch && !isTest;
-	int numArgs = hasConfigParams ? 5 : 2;
+	// Training on data takes an optional number of threads, and optionally after it whether to use
+	// Hogwild training, before the callback
+	bool hasThreadsParam = hasConfigParams && !fromFile && !isCascade && (info.Length() == 6 || info.Length() == 7);
+	bool hasHogwildParam = hasThreadsParam && info.Length() == 7;
+	int numArgs = hasConfigParams ? (5 + hasThreadsParam + hasHogwildParam) : 2;
 	if (info.Length() != numArgs) return Nan::ThrowError("Invalid arguments");
+	if (!isTest && !Nan::ObjectWrap::Unwrap<FANNY>(info.Holder())->checkWritable()) return;
 	std::string filename;
 	Nan::MaybeLocal<v8::Object> maybeTrainingData;
 	if (fromFile) {
@@ -579,7 +1025,7 @@ void FANNY::_doTrainOrTest(
 		filename = std::string(*v8::String::Utf8Value(info[0]));
 	} else {
 		if (!info[0]->IsObject()) return Nan::ThrowTypeError("First argument must be TrainingData");
-		if (!Nan::New(TrainingData::constructorFunctionTpl)->HasInstance(info[0])) return Nan::ThrowTypeError("First argument must be TrainingData");
+		if (!Nan::New(AddonData::get()->trainingDataConstructorTpl)->HasInstance(info[0])) return Nan::ThrowTypeError("First argument must be TrainingData");
 		v8::Local<v8::Object> trainingDataHolder = info[0].As<v8::Object>();
 		maybeTrainingData = Nan::MaybeLocal<v8::Object>(trainingDataHolder);
 	}
@@ -594,6 +1040,12 @@ void FANNY::_doTrainOrTest(
 		iterationsBetweenReports = info[2]->Uint32Value();
 		desiredError = (float)info[3]->NumberValue();
 	}
+	unsigned int numThreads = 1;
+	if (hasThreadsParam) {
+		if (!info[4]->IsNumber() || info[4]->Uint32Value() < 1) return Nan::ThrowError("Number of threads must be a positive number");
+		numThreads = info[4]->Uint32Value();
+	}
+	bool hogwild = hasHogwildParam && info[5]->BooleanValue();
 	if (!info[numArgs - 1]->IsFunction()) return Nan::ThrowTypeError("Last argument must be callback");
 	Nan::Callback *callback = new Nan::Callback(info[numArgs - 1].As<v8::Function>());
 	Nan::AsyncQueueWorker(new TrainWorker(
@@ -607,7 +1059,9 @@ void FANNY::_doTrainOrTest(
 		iterationsBetweenReports,
 		desiredError,
 		singleEpoch,
-		isTest
+		isTest,
+		numThreads,
+		hogwild
 	));
 	#else
 	Nan::ThrowError("Not supported for fixed FANN");
@@ -641,28 +1095,169 @@ NAN_METHOD(FANNY::testData) {
 NAN_METHOD(FANNY::run) {
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
 	if (info.Length() != 1) return Nan::ThrowError("Takes one argument");
-	if (!info[0]->IsArray()) return Nan::ThrowError("Must be array");
-	std::vector<fann_type> inputs = v8ArrayToFannData(info[0]);
+	if (!isV8NumberArray(info[0])) return Nan::ThrowError("Must be array");
+	FannDataView inputs(info[0]);
 	if (inputs.size() != fanny->fann->get_num_input()) return Nan::ThrowError("Wrong number of inputs");
-	fann_type *outputs = fanny->fann->run(&inputs[0]);
+	const fann_type *outputs = fanny->runOne(inputs.data());
 	if (fanny->checkError()) return;
 	v8::Local<v8::Value> outputArray = fannDataToV8Array(outputs, fanny->fann->get_num_output());
 	info.GetReturnValue().Set(outputArray);
 }
 
+NAN_METHOD(FANNY::runInto) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 2) return Nan::ThrowError("Takes two arguments");
+	if (!isV8NumberArray(info[0])) return Nan::ThrowError("First argument must be array");
+	if (!isFannTypedArray(info[1])) return Nan::ThrowError("Second argument must be a typed array matching the FANN datatype");
+	FannDataView inputs(info[0]);
+	if (inputs.size() != fanny->fann->get_num_input()) return Nan::ThrowError("Wrong number of inputs");
+	unsigned int numOutputs = fanny->fann->get_num_output();
+	Nan::TypedArrayContents<fann_type> outputContents(info[1]);
+	if (outputContents.length() < numOutputs) return Nan::ThrowError("Output array is too small");
+	const fann_type *outputs = fanny->runOne(inputs.data());
+	if (fanny->checkError()) return;
+	std::copy(outputs, outputs + numOutputs, *outputContents);
+	info.GetReturnValue().Set(info[1]);
+}
+
 NAN_METHOD(FANNY::runAsync) {
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
 	if (info.Length() != 2) return Nan::ThrowError("Takes two arguments");
-	if (!info[0]->IsArray()) return Nan::ThrowError("First argument must be array");
+	if (!isV8NumberArray(info[0])) return Nan::ThrowError("First argument must be array");
 	if (!info[1]->IsFunction()) return Nan::ThrowError("Second argument must be callback");
 	std::vector<fann_type> inputs = v8ArrayToFannData(info[0]);
 	if (inputs.size() != fanny->fann->get_num_input()) return Nan::ThrowError("Wrong number of inputs");
 	Nan::Callback * callback = new Nan::Callback(info[1].As<v8::Function>());
-	Nan::AsyncQueueWorker(new RunWorker(callback, inputs, info.Holder()));
+	Nan::AsyncQueueWorker(new RunWorker(callback, inputs, 1, false, info.Holder()));
+}
+
+NAN_METHOD(FANNY::runBatch) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 2) return Nan::ThrowError("Takes two arguments");
+	if (!isNumericTypedArray(info[0])) return Nan::ThrowError("First argument must be a typed array");
+	if (!info[1]->IsNumber()) return Nan::ThrowError("Second argument must be a number");
+	unsigned int numRuns = info[1]->Uint32Value();
+	unsigned int numInputs = fanny->fann->get_num_input();
+	unsigned int numOutputs = fanny->fann->get_num_output();
+	FannDataView inputs(info[0]);
+	if (inputs.size() != (size_t)numRuns * numInputs) return Nan::ThrowError("Wrong number of inputs");
+	v8::Local<v8::Value> outputArray = fannDataToV8TypedArray(NULL, numRuns * numOutputs);
+	Nan::TypedArrayContents<fann_type> outputs(outputArray);
+	if (!fanny->runBatchSync(inputs.data(), numRuns, *outputs)) return;
+	info.GetReturnValue().Set(outputArray);
+}
+
+NAN_METHOD(FANNY::runBatchAsync) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 3) return Nan::ThrowError("Takes three arguments");
+	if (!isNumericTypedArray(info[0])) return Nan::ThrowError("First argument must be a typed array");
+	if (!info[1]->IsNumber()) return Nan::ThrowError("Second argument must be a number");
+	if (!info[2]->IsFunction()) return Nan::ThrowError("Third argument must be callback");
+	unsigned int numRuns = info[1]->Uint32Value();
+	FannDataView inputView(info[0]);
+	if (inputView.size() != (size_t)numRuns * fanny->fann->get_num_input()) return Nan::ThrowError("Wrong number of inputs");
+	// The worker keeps its own copy so the caller's buffer is free to change while the batch runs
+	std::vector<fann_type> inputs(inputView.data(), inputView.data() + inputView.size());
+	Nan::Callback * callback = new Nan::Callback(info[2].As<v8::Function>());
+	Nan::AsyncQueueWorker(new RunWorker(callback, inputs, numRuns, true, info.Holder()));
+}
+
+// Reads a reduction and its parameter from arguments to runReduced() or runBatchReduced().  Throws
+// and returns false if they're invalid.
+static bool getReductionArgs(v8::Local<v8::Value> kindArg, v8::Local<v8::Value> paramArg, unsigned int numOutput,
+	OutputReduction::Kind &kind, unsigned int &k, double &threshold
+) {
+	if (!kindArg->IsString() || !OutputReduction::parseKind(*v8::String::Utf8Value(kindArg), kind)) {
+		Nan::ThrowError("Invalid reduction");
+		return false;
+	}
+	k = 1;
+	threshold = 0;
+	if (kind == OutputReduction::TOP_K) {
+		if (!paramArg->IsNumber()) {
+			Nan::ThrowError("k must be a number");
+			return false;
+		}
+		k = paramArg->Uint32Value();
+		if (k < 1 || k > numOutput) {
+			Nan::ThrowError("k must be between 1 and the number of outputs");
+			return false;
+		}
+	} else if (kind == OutputReduction::THRESHOLD) {
+		if (!paramArg->IsNumber()) {
+			Nan::ThrowError("threshold must be a number");
+			return false;
+		}
+		threshold = paramArg->NumberValue();
+	}
+	return true;
+}
+
+NAN_METHOD(FANNY::runReduced) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 3) return Nan::ThrowError("Takes three arguments");
+	if (!isV8NumberArray(info[0])) return Nan::ThrowError("First argument must be array");
+	unsigned int numOutputs = fanny->fann->get_num_output();
+	OutputReduction::Kind kind;
+	unsigned int k;
+	double threshold;
+	if (!getReductionArgs(info[1], info[2], numOutputs, kind, k, threshold)) return;
+	FannDataView inputs(info[0]);
+	if (inputs.size() != fanny->fann->get_num_input()) return Nan::ThrowError("Wrong number of inputs");
+	const fann_type *outputs = fanny->runOne(inputs.data());
+	if (fanny->checkError()) return;
+	OutputReduction reduction(kind, numOutputs, k, threshold);
+	if (kind == OutputReduction::ARGMAX) {
+		uint32_t index;
+		reduction.reduce(outputs, &index);
+		info.GetReturnValue().Set(index);
+	} else if (kind == OutputReduction::TOP_K) {
+		std::vector<uint32_t> indices(k);
+		reduction.reduce(outputs, indices.data());
+		v8::Local<v8::Array> result = Nan::New<v8::Array>(k);
+		for (unsigned int i = 0; i < k; i++) Nan::Set(result, i, Nan::New(indices[i]));
+		info.GetReturnValue().Set(result);
+	} else {
+		v8::Local<v8::Value> result = newV8Uint32Array(reduction.getResultSize());
+		Nan::TypedArrayContents<uint32_t> contents(result);
+		reduction.reduce(outputs, *contents);
+		info.GetReturnValue().Set(result);
+	}
+}
+
+NAN_METHOD(FANNY::runBatchReduced) {
+	// Runs are made in chunks of this many, so the full outputs of a large batch are never held at once
+	static const unsigned int CHUNK_RUNS = 256;
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 4) return Nan::ThrowError("Takes four arguments");
+	if (!isNumericTypedArray(info[0])) return Nan::ThrowError("First argument must be a typed array");
+	if (!info[1]->IsNumber()) return Nan::ThrowError("Second argument must be a number");
+	unsigned int numRuns = info[1]->Uint32Value();
+	unsigned int numInputs = fanny->fann->get_num_input();
+	unsigned int numOutputs = fanny->fann->get_num_output();
+	OutputReduction::Kind kind;
+	unsigned int k;
+	double threshold;
+	if (!getReductionArgs(info[2], info[3], numOutputs, kind, k, threshold)) return;
+	FannDataView inputs(info[0]);
+	if (inputs.size() != (size_t)numRuns * numInputs) return Nan::ThrowError("Wrong number of inputs");
+	OutputReduction reduction(kind, numOutputs, k, threshold);
+	v8::Local<v8::Value> result = newV8Uint32Array(numRuns * reduction.getResultSize());
+	Nan::TypedArrayContents<uint32_t> contents(result);
+	std::vector<fann_type> outputs((size_t)std::min(numRuns, CHUNK_RUNS) * numOutputs);
+	for (unsigned int start = 0; start < numRuns; start += CHUNK_RUNS) {
+		unsigned int chunkRuns = std::min(numRuns - start, CHUNK_RUNS);
+		if (!fanny->runBatchSync(inputs.data() + (size_t)start * numInputs, chunkRuns, outputs.data())) return;
+		for (unsigned int run = 0; run < chunkRuns; run++) {
+			reduction.reduce(&outputs[(size_t)run * numOutputs], *contents + (size_t)(start + run) * reduction.getResultSize());
+		}
+	}
+	info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(FANNY::getTrainingAlgorithm) {
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (fanny->miniBatch) return info.GetReturnValue().Set(Nan::New("TRAIN_MINIBATCH").ToLocalChecked());
 	FANN::training_algorithm_enum value = fanny->fann->get_training_algorithm();
 
 	info.GetReturnValue().Set(trainingAlgorithmEnumToV8String(value));
@@ -674,7 +1269,13 @@ NAN_METHOD(FANNY::setTrainingAlgorithm) {
 	if (!info[0]->IsString()) return Nan::ThrowError("training_algorithm not a string");
 
 	FANN::training_algorithm_enum value;
-	if(v8StringToTrainingAlgorithmEnum(info[0], value)) fanny->fann->set_training_algorithm(value);
+	if (std::string(*v8::String::Utf8Value(info[0])) == "TRAIN_MINIBATCH") {
+		fanny->fann->set_training_algorithm(FANN::TRAIN_BATCH);
+		fanny->miniBatch = true;
+	} else if(v8StringToTrainingAlgorithmEnum(info[0], value)) {
+		fanny->fann->set_training_algorithm(value);
+		fanny->miniBatch = false;
+	}
 }
 
 NAN_METHOD(FANNY::getTrainErrorFunction) {
@@ -748,6 +1349,20 @@ NAN_METHOD(FANNY::getNumLayers) {
 	info.GetReturnValue().Set(num);
 }
 
+#ifdef FANNY_FIXED
+NAN_METHOD(FANNY::getDecimalPoint) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	unsigned int num = fanny->fann->get_decimal_point();
+	info.GetReturnValue().Set(num);
+}
+
+NAN_METHOD(FANNY::getMultiplier) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	unsigned int num = fanny->fann->get_multiplier();
+	info.GetReturnValue().Set(num);
+}
+#endif
+
 NAN_METHOD(FANNY::getBitFail) {
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
 	unsigned int num = fanny->fann->get_bit_fail();
@@ -823,6 +1438,7 @@ NAN_METHOD(FANNY::setActivationFunction) {
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
 	FANN::activation_function_enum activationFunction;
 	if(v8StringToActivationFunctionEnum(info[0], activationFunction)) fanny->fann->set_activation_function(activationFunction, layer, neuron);
+	fanny->netChanged();
 }
 
 NAN_METHOD(FANNY::setActivationFunctionLayer) {
@@ -835,6 +1451,7 @@ NAN_METHOD(FANNY::setActivationFunctionLayer) {
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
 	FANN::activation_function_enum activationFunction;
 	if(v8StringToActivationFunctionEnum(info[0], activationFunction)) fanny->fann->set_activation_function_layer(activationFunction, layer);
+	fanny->netChanged();
 }
 
 NAN_METHOD(FANNY::setActivationFunctionHidden) {
@@ -844,6 +1461,7 @@ NAN_METHOD(FANNY::setActivationFunctionHidden) {
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
 	FANN::activation_function_enum activationFunction;
 	if(v8StringToActivationFunctionEnum(info[0], activationFunction)) fanny->fann->set_activation_function_hidden(activationFunction);
+	fanny->netChanged();
 }
 
 NAN_METHOD(FANNY::setActivationFunctionOutput) {
@@ -853,6 +1471,7 @@ NAN_METHOD(FANNY::setActivationFunctionOutput) {
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
 	FANN::activation_function_enum activationFunction;
 	if(v8StringToActivationFunctionEnum(info[0], activationFunction)) fanny->fann->set_activation_function_output(activationFunction);
+	fanny->netChanged();
 }
 
 // by default -0.0001
@@ -1061,12 +1680,14 @@ NAN_METHOD(FANNY::setLearningMomentum) {
 
 NAN_METHOD(FANNY::initWeights) {
 	if (info.Length() != 1) return Nan::ThrowError("Takes an argument");
-	if (!Nan::New(TrainingData::constructorFunctionTpl)->HasInstance(info[0])) {
+	if (!Nan::New(AddonData::get()->trainingDataConstructorTpl)->HasInstance(info[0])) {
 		return Nan::ThrowError("Argument must be an instance of TrainingData");
 	}
 	TrainingData *fannyTrainingData = Nan::ObjectWrap::Unwrap<TrainingData>(info[0].As<v8::Object>());
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
-	return fanny->fann->init_weights(*fannyTrainingData->trainingData);
+	if (!fanny->checkWritable()) return;
+	fanny->fann->init_weights(*fannyTrainingData->trainingData);
+	fanny->netChanged();
 }
 
 NAN_METHOD(FANNY::getLayerArray) {
@@ -1098,16 +1719,18 @@ NAN_METHOD(FANNY::getBiasArray) {
 NAN_METHOD(FANNY::train) {
 	#ifndef FANNY_FIXED
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (!fanny->checkWritable()) return;
 	if (info.Length() != 2) return Nan::ThrowError("Must have 2 arguments: input, desired_output");
-	if (!info[0]->IsArray() || !info[1]->IsArray()) return Nan::ThrowError("Argument not an array");
+	if (!isV8NumberArray(info[0]) || !isV8NumberArray(info[1])) return Nan::ThrowError("Argument not an array");
 
-	std::vector<fann_type> input = v8ArrayToFannData(info[0]);
-	std::vector<fann_type> desired_output = v8ArrayToFannData(info[1]);
+	FannDataView input(info[0]);
+	FannDataView desired_output(info[1]);
 
 	if (input.size() != fanny->fann->get_num_input()) return Nan::ThrowError("Wrong number of inputs");
 	if (desired_output.size() != fanny->fann->get_num_output()) return Nan::ThrowError("Wrong number of desired ouputs");
 
-	fanny->fann->train(&input[0], &desired_output[0]);
+	fanny->fann->train(input.data(), desired_output.data());
+	fanny->netChanged();
 
 	#else
 	Nan::ThrowError("Not supported for fixed fann");
@@ -1117,15 +1740,15 @@ NAN_METHOD(FANNY::train) {
 NAN_METHOD(FANNY::test) {
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
 	if (info.Length() != 2) return Nan::ThrowError("Must have 2 arguments: input, desired_output");
-	if (!info[0]->IsArray() || !info[1]->IsArray()) return Nan::ThrowError("Argument not an array");
+	if (!isV8NumberArray(info[0]) || !isV8NumberArray(info[1])) return Nan::ThrowError("Argument not an array");
 
-	std::vector<fann_type> input = v8ArrayToFannData(info[0]);
-	std::vector<fann_type> desired_output = v8ArrayToFannData(info[1]);
+	FannDataView input(info[0]);
+	FannDataView desired_output(info[1]);
 
 	if (input.size() != fanny->fann->get_num_input()) return Nan::ThrowError("Wrong number of inputs");
 	if (desired_output.size() != fanny->fann->get_num_output()) return Nan::ThrowError("Wrong number of desired ouputs");
 
-	fann_type *outputs = 	fanny->fann->test(&input[0], &desired_output[0]);
+	fann_type *outputs = 	fanny->fann->test(input.data(), desired_output.data());
 	if (fanny->checkError()) return;
 	v8::Local<v8::Value> outputArray = fannDataToV8Array(outputs, fanny->fann->get_num_output());
 	info.GetReturnValue().Set(outputArray);
@@ -1135,7 +1758,7 @@ NAN_METHOD(FANNY::scaleTrain) {
 	#ifndef FANNY_FIXED
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
 	if (info.Length() != 1) return Nan::ThrowError("Must have an argument: tainingData");
-	if (!Nan::New(TrainingData::constructorFunctionTpl)->HasInstance(info[0])) {
+	if (!Nan::New(AddonData::get()->trainingDataConstructorTpl)->HasInstance(info[0])) {
 		return Nan::ThrowError("Argument must be an instance of TrainingData");
 	}
 	TrainingData *fannyTrainingData = Nan::ObjectWrap::Unwrap<TrainingData>(info[0].As<v8::Object>());
@@ -1150,7 +1773,7 @@ NAN_METHOD(FANNY::descaleTrain) {
 	#ifndef FANNY_FIXED
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
 	if (info.Length() != 1) return Nan::ThrowError("Must have an argument: tainingData");
-	if (!Nan::New(TrainingData::constructorFunctionTpl)->HasInstance(info[0])) {
+	if (!Nan::New(AddonData::get()->trainingDataConstructorTpl)->HasInstance(info[0])) {
 		return Nan::ThrowError("Argument must be an instance of TrainingData");
 	}
 	TrainingData *fannyTrainingData = Nan::ObjectWrap::Unwrap<TrainingData>(info[0].As<v8::Object>());
@@ -1177,7 +1800,7 @@ NAN_METHOD(FANNY::setInputScalingParams) {
 	#ifndef FANNY_FIXED
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
 	if (info.Length() != 3) return Nan::ThrowError("Must have 3 arguments: tainingData, new_input_min, and new_input_max");
-	if (!Nan::New(TrainingData::constructorFunctionTpl)->HasInstance(info[0])) {
+	if (!Nan::New(AddonData::get()->trainingDataConstructorTpl)->HasInstance(info[0])) {
 		return Nan::ThrowError("Argument must be an instance of TrainingData");
 	}
 
@@ -1202,7 +1825,7 @@ NAN_METHOD(FANNY::setOutputScalingParams) {
 	#ifndef FANNY_FIXED
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
 	if (info.Length() != 3) return Nan::ThrowError("Must have 3 arguments: tainingData new_output_min, and new_output_max");
-	if (!Nan::New(TrainingData::constructorFunctionTpl)->HasInstance(info[0])) {
+	if (!Nan::New(AddonData::get()->trainingDataConstructorTpl)->HasInstance(info[0])) {
 		return Nan::ThrowError("Argument must be an instance of TrainingData");
 	}
 
@@ -1226,7 +1849,7 @@ NAN_METHOD(FANNY::setScalingParams) {
 	#ifndef FANNY_FIXED
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
 	if (info.Length() != 5) return Nan::ThrowError("Must have 5 arguments: tainingData, new_input_min, new_input_max, new_output_min, and new_output_max");
-	if (!Nan::New(TrainingData::constructorFunctionTpl)->HasInstance(info[0])) {
+	if (!Nan::New(AddonData::get()->trainingDataConstructorTpl)->HasInstance(info[0])) {
 		return Nan::ThrowError("Argument must be an instance of TrainingData");
 	}
 
@@ -1712,6 +2335,7 @@ NAN_METHOD(FANNY::setActivationSteepness) {
 	unsigned int layer = info[1]->Uint32Value();
 	unsigned int neuron = info[2]->Uint32Value();
 	fanny->fann->set_activation_steepness(steepness, layer, neuron);
+	fanny->netChanged();
 }
 
 NAN_METHOD(FANNY::setActivationSteepnessLayer) {
@@ -1724,6 +2348,7 @@ NAN_METHOD(FANNY::setActivationSteepnessLayer) {
 	fann_type steepness = v8NumberToFannType(info[0]);
 	unsigned int layer = info[1]->Uint32Value();
 	fanny->fann->set_activation_steepness_layer(steepness, layer);
+	fanny->netChanged();
 }
 
 NAN_METHOD(FANNY::setActivationSteepnessHidden) {
@@ -1734,6 +2359,7 @@ NAN_METHOD(FANNY::setActivationSteepnessHidden) {
 	}
 	fann_type steepness = v8NumberToFannType(info[0]);
 	fanny->fann->set_activation_steepness_hidden(steepness);
+	fanny->netChanged();
 }
 
 NAN_METHOD(FANNY::setActivationSteepnessOutput) {
@@ -1744,10 +2370,12 @@ NAN_METHOD(FANNY::setActivationSteepnessOutput) {
 	}
 	fann_type steepness = v8NumberToFannType(info[0]);
 	fanny->fann->set_activation_steepness_output(steepness);
+	fanny->netChanged();
 }
 
 NAN_METHOD(FANNY::setWeightArray) {
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (!fanny->checkWritable()) return;
 	if (info.Length() != 2) return Nan::ThrowError("Must have two arguments");
 	if (!info[0]->IsArray()) return Nan::ThrowError("Connections must be an array");
 	if (!info[1]->IsNumber()) return Nan::ThrowError("size must be a number");
@@ -1755,10 +2383,12 @@ NAN_METHOD(FANNY::setWeightArray) {
 	std::vector<FANN::connection> connections = v8ArrayToConnection(info[0]);
 	unsigned int num = info[1]->Uint32Value();
 	fanny->fann->set_weight_array(&connections[0], num);
+	fanny->netChanged();
 }
 
 NAN_METHOD(FANNY::setWeight) {
 	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (!fanny->checkWritable()) return;
 	if (info.Length() != 3) return Nan::ThrowError("Must have 3 arguments");
 	if (!info[0]->IsNumber() || !info[1]->IsNumber() || !info[2]->IsNumber()) {
 		return Nan::ThrowError("All arguments must be numbers");
@@ -1767,6 +2397,252 @@ NAN_METHOD(FANNY::setWeight) {
 	unsigned int toNeuron = info[1]->Uint32Value();
 	fann_type weight = v8NumberToFannType(info[2]);
 	fanny->fann->set_weight(fromNeuron, toNeuron, weight);
+	fanny->netChanged();
+}
+
+NAN_METHOD(FANNY::getRunConcurrency) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	info.GetReturnValue().Set(fanny->runConcurrency);
+}
+
+NAN_METHOD(FANNY::getBatchSize) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	info.GetReturnValue().Set(fanny->batchSize);
+}
+
+NAN_METHOD(FANNY::setBatchSize) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 1) return Nan::ThrowError("Must have an arguments: batch_size");
+	if (!info[0]->IsNumber()) return Nan::ThrowError("batch_size not a number");
+	unsigned int value = info[0]->Uint32Value();
+	if (value < 1) return Nan::ThrowError("batch_size must be at least 1");
+	fanny->batchSize = value;
+}
+
+NAN_METHOD(FANNY::setRunConcurrency) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 1) return Nan::ThrowError("Must have an arguments: run_concurrency");
+	if (!info[0]->IsNumber()) return Nan::ThrowError("run_concurrency not a number");
+	unsigned int value = info[0]->Uint32Value();
+	if (value < 1) return Nan::ThrowError("run_concurrency must be at least 1");
+	fanny->runConcurrency = value;
+	// Runs go straight to fann at a concurrency of 1, so the pool and its snapshot of the weights
+	// would only hold on to memory
+	size_t keep = (value > 1) ? value : 0;
+	while (fanny->replicaPool.size() > keep) {
+		delete fanny->replicaPool.back();
+		fanny->replicaPool.pop_back();
+	}
+	if (value <= 1) fanny->snapshot.reset();
+}
+
+NAN_METHOD(FANNY::getEngine) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	const char *name = "fann";
+	if (fanny->engine == ENGINE_SIMD) name = "simd";
+	if (fanny->engine == ENGINE_INT8) name = "int8";
+	info.GetReturnValue().Set(Nan::New(name).ToLocalChecked());
+}
+
+NAN_METHOD(FANNY::setEngine) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 1) return Nan::ThrowError("Must have an arguments: engine");
+	if (!info[0]->IsString()) return Nan::ThrowError("engine not a string");
+	std::string value(*v8::String::Utf8Value(info[0]));
+	if (value == "fann") {
+		fanny->engine = ENGINE_FANN;
+	} else if (value == "simd") {
+		fanny->engine = ENGINE_SIMD;
+	} else {
+		return Nan::ThrowError("Invalid engine");
+	}
+	fanny->engineChanged();
+	#ifndef FANNY_FIXED
+	fanny->quantized.reset();
+	#endif
+}
+
+NAN_METHOD(FANNY::getActivationMode) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	info.GetReturnValue().Set(Nan::New(fanny->fastActivations ? "fast" : "exact").ToLocalChecked());
+}
+
+NAN_METHOD(FANNY::setActivationMode) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 1) return Nan::ThrowError("Must have an arguments: activation_mode");
+	if (!info[0]->IsString()) return Nan::ThrowError("activation_mode not a string");
+	std::string value(*v8::String::Utf8Value(info[0]));
+	if (value == "exact") {
+		fanny->fastActivations = false;
+	} else if (value == "fast") {
+		fanny->fastActivations = true;
+	} else {
+		return Nan::ThrowError("Invalid activation mode");
+	}
+	fanny->engineChanged();
+}
+
+NAN_METHOD(FANNY::quantize) {
+	#ifndef FANNY_FIXED
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 1) return Nan::ThrowError("Takes an argument");
+	if (!Nan::New(AddonData::get()->trainingDataConstructorTpl)->HasInstance(info[0])) {
+		return Nan::ThrowError("Argument must be an instance of TrainingData");
+	}
+	FANN::training_data *data = Nan::ObjectWrap::Unwrap<TrainingData>(info[0].As<v8::Object>())->trainingData;
+	if (data->num_input_train_data() != fanny->fann->get_num_input() || data->num_output_train_data() != fanny->fann->get_num_output()) {
+		return Nan::ThrowError("Training data does not match network");
+	}
+	// The quantized network keeps the activation mode in effect now
+	std::shared_ptr<CompiledNet> reference = CompiledNet::compile(fanny->fann, fanny->fastActivations);
+	if (!reference) return Nan::ThrowError("Network layout not supported for quantization");
+	std::shared_ptr<QuantizedNet> quantized = QuantizedNet::quantize(*reference, data->get_input(), data->length_train_data());
+	QuantizedNet::Report report = quantized->compare(*reference, data->get_input(), data->get_output(), data->length_train_data());
+	fanny->engine = ENGINE_INT8;
+	fanny->engineChanged();
+	fanny->quantized = quantized;
+
+	v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+	Nan::Set(obj, Nan::New("numSamples").ToLocalChecked(), Nan::New(report.numSamples));
+	Nan::Set(obj, Nan::New("floatWeightBytes").ToLocalChecked(), Nan::New((double)report.floatWeightBytes));
+	Nan::Set(obj, Nan::New("quantizedWeightBytes").ToLocalChecked(), Nan::New((double)report.quantizedWeightBytes));
+	Nan::Set(obj, Nan::New("maxError").ToLocalChecked(), Nan::New(report.maxError));
+	Nan::Set(obj, Nan::New("meanError").ToLocalChecked(), Nan::New(report.meanError));
+	Nan::Set(obj, Nan::New("floatMSE").ToLocalChecked(), Nan::New(report.floatMse));
+	Nan::Set(obj, Nan::New("quantizedMSE").ToLocalChecked(), Nan::New(report.quantizedMse));
+	Nan::Set(obj, Nan::New("argmaxAgreement").ToLocalChecked(), Nan::New(report.argmaxAgreement));
+	info.GetReturnValue().Set(obj);
+	#else
+	Nan::ThrowError("Not supported for fixed FANN");
+	#endif
+}
+
+NAN_METHOD(FANNY::getSpecializedKernel) {
+	#ifndef FANNY_FIXED
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	const std::shared_ptr<SmallNet> &small = fanny->getSmallNet();
+	if (small) return info.GetReturnValue().Set(Nan::New(small->getShape()).ToLocalChecked());
+	#endif
+	info.GetReturnValue().Set(Nan::Null());
+}
+
+NAN_METHOD(FANNY::setPredictionCache) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 2) return Nan::ThrowError("Must have 2 arguments: max_bytes and quantum");
+	if (!info[0]->IsNumber() || !info[1]->IsNumber()) return Nan::ThrowError("max_bytes and quantum must be numbers");
+	double maxBytes = info[0]->NumberValue();
+	double quantum = info[1]->NumberValue();
+	if (!(maxBytes >= 0) || !(quantum >= 0)) return Nan::ThrowError("max_bytes and quantum must not be negative");
+	if (maxBytes < 1) {
+		fanny->predictionCache.reset();
+	} else {
+		fanny->predictionCache = std::make_shared<PredictionCache>((size_t)maxBytes, quantum, fanny->fann->get_num_input(), fanny->fann->get_num_output());
+	}
+}
+
+NAN_METHOD(FANNY::getPredictionCacheSize) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	info.GetReturnValue().Set(Nan::New(fanny->predictionCache ? (double)fanny->predictionCache->getMaxBytes() : 0.0));
+}
+
+NAN_METHOD(FANNY::getPredictionCacheQuantum) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	info.GetReturnValue().Set(Nan::New(fanny->predictionCache ? fanny->predictionCache->getQuantum() : 0.0));
+}
+
+NAN_METHOD(FANNY::getPredictionCacheStats) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	PredictionCache::Stats stats = { 0, 0, 0, 0 };
+	size_t maxBytes = 0;
+	if (fanny->predictionCache) {
+		stats = fanny->predictionCache->getStats();
+		maxBytes = fanny->predictionCache->getMaxBytes();
+	}
+	v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+	Nan::Set(obj, Nan::New("hits").ToLocalChecked(), Nan::New((double)stats.hits));
+	Nan::Set(obj, Nan::New("misses").ToLocalChecked(), Nan::New((double)stats.misses));
+	Nan::Set(obj, Nan::New("entries").ToLocalChecked(), Nan::New((double)stats.entries));
+	Nan::Set(obj, Nan::New("bytes").ToLocalChecked(), Nan::New((double)stats.bytes));
+	Nan::Set(obj, Nan::New("maxBytes").ToLocalChecked(), Nan::New((double)maxBytes));
+	info.GetReturnValue().Set(obj);
+}
+
+NAN_METHOD(FANNY::resetPredictionCacheStats) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (fanny->predictionCache) fanny->predictionCache->resetStats();
+}
+
+NAN_METHOD(FANNY::getStatsEnabled) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	info.GetReturnValue().Set(Nan::New((bool)fanny->stats));
+}
+
+NAN_METHOD(FANNY::setStatsEnabled) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 1) return Nan::ThrowError("Must have an arguments: enabled");
+	if (!info[0]->IsBoolean()) return Nan::ThrowError("enabled not a boolean");
+	bool enabled = info[0]->BooleanValue();
+	if (enabled && !fanny->stats) fanny->stats = std::make_shared<LatencyStats>();
+	if (!enabled) fanny->stats.reset();
+}
+
+static v8::Local<v8::Object> latencyHistogramToV8Object(const LatencyHistogram &histogram) {
+	Nan::EscapableHandleScope scope;
+	v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+	Nan::Set(obj, Nan::New("count").ToLocalChecked(), Nan::New((double)histogram.getCount()));
+	Nan::Set(obj, Nan::New("mean").ToLocalChecked(), Nan::New(histogram.getMean() / 1e6));
+	Nan::Set(obj, Nan::New("p50").ToLocalChecked(), Nan::New(histogram.getPercentile(0.5) / 1e6));
+	Nan::Set(obj, Nan::New("p90").ToLocalChecked(), Nan::New(histogram.getPercentile(0.9) / 1e6));
+	Nan::Set(obj, Nan::New("p99").ToLocalChecked(), Nan::New(histogram.getPercentile(0.99) / 1e6));
+	Nan::Set(obj, Nan::New("max").ToLocalChecked(), Nan::New(histogram.getMax() / 1e6));
+	return scope.Escape(obj);
+}
+
+NAN_METHOD(FANNY::getStats) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (!fanny->stats) return info.GetReturnValue().Set(Nan::Null());
+	v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+	Nan::Set(obj, Nan::New("run").ToLocalChecked(), latencyHistogramToV8Object(fanny->stats->run));
+	Nan::Set(obj, Nan::New("runQueue").ToLocalChecked(), latencyHistogramToV8Object(fanny->stats->runQueue));
+	Nan::Set(obj, Nan::New("runExecute").ToLocalChecked(), latencyHistogramToV8Object(fanny->stats->runExecute));
+	Nan::Set(obj, Nan::New("trainEpoch").ToLocalChecked(), latencyHistogramToV8Object(fanny->stats->trainEpoch));
+	info.GetReturnValue().Set(obj);
+}
+
+NAN_METHOD(FANNY::resetStats) {
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (!fanny->stats) return;
+	fanny->stats->run.reset();
+	fanny->stats->runQueue.reset();
+	fanny->stats->runExecute.reset();
+	fanny->stats->trainEpoch.reset();
+}
+
+NAN_METHOD(FANNY::generateSource) {
+	#ifndef FANNY_FIXED
+	FANNY *fanny = Nan::ObjectWrap::Unwrap<FANNY>(info.Holder());
+	if (info.Length() != 1 || !info[0]->IsString()) return Nan::ThrowError("Argument must be string");
+	std::string name(*v8::String::Utf8Value(info[0]));
+	// The name is used as a C++ namespace and a module name
+	bool validName = !name.empty() && !(name[0] >= '0' && name[0] <= '9');
+	for (size_t i = 0; i < name.size(); i++) {
+		char c = name[i];
+		if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')) validName = false;
+	}
+	if (!validName) return Nan::ThrowError("Invalid name");
+	// Generated code always uses the exact activation functions
+	std::shared_ptr<CompiledNet> net = CompiledNet::compile(fanny->fann);
+	if (!net) return Nan::ThrowError("Network layout not supported for code generation");
+	std::string source = SourceGenerator::generate(*net, name);
+	if (source.empty()) return Nan::ThrowError("Activation function not supported for code generation");
+	info.GetReturnValue().Set(Nan::New(source).ToLocalChecked());
+	#else
+	Nan::ThrowError("Not supported for fixed FANN");
+	#endif
+}
+
+NAN_METHOD(FANNY::getSimdLevel) {
+	info.GetReturnValue().Set(Nan::New(simd::getLevelName(simd::getLevel())).ToLocalChecked());
 }
 
 NAN_METHOD(FANNY::getUserDataString) {
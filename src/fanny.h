@@ -2,7 +2,17 @@
 #define FANNY_H
 
 #include <nan.h>
+#include <vector>
+#include <memory>
+#include <string>
 #include "fann-includes.h"
+#include "compiled-net.h"
+#include "quantized-net.h"
+#include "small-net.h"
+#include "weight-snapshot.h"
+#include "prediction-cache.h"
+#include "output-reduction.h"
+#include "latency-histogram.h"
 
 namespace fanny {
 
@@ -21,10 +31,6 @@ public:
 	// User-defined training callback function
 	Nan::Persistent<v8::Function> trainingCallbackFn;
 
-	// Constructor
-	static Nan::Persistent<v8::FunctionTemplate> constructorFunctionTpl;
-	static Nan::Persistent<v8::Function> constructorFunction;
-
 	// Current training iteration data
 	class TrainingProgress {
 	public:
@@ -37,31 +43,166 @@ public:
 	TrainWorker *currentTrainWorker;
 	bool cancelTrainingFlag;
 
+	// Idle executors of snapshot that let several asynchronous runs execute at once.  FANN stores
+	// neuron values in the network itself, so each concurrent run needs its own neurons, but they
+	// all share the snapshot's weights.  Only accessed from the main thread: workers acquire a
+	// replica when created and release it when destroyed.
+	std::vector<WeightSnapshot::Executor *> replicaPool;
+	// Copy of fann's weights shared by the replicas.  Taken on first use after each change, and
+	// shared with clones made before the next change.
+	std::shared_ptr<WeightSnapshot> snapshot;
+	// Maximum number of replicas kept.  When 1, asynchronous runs use fann directly.
+	unsigned int runConcurrency;
+	// Incremented each time the network changes in a way that affects its outputs
+	unsigned int netVersion;
+
+	// Returns a network for an asynchronous run to use
+	FANN::neural_net *acquireReplica();
+	// Returns a network from acquireReplica() to the pool, or deletes it if it's out of date
+	void releaseReplica(FANN::neural_net *replica, unsigned int version);
+	// Must be called after changing weights or activation functions; discards the snapshot, idle
+	// replicas and the compiled and quantized networks
+	void netChanged();
+	// Must be called after changing the engine or its settings; discards the compiled network and
+	// cached outputs
+	void engineChanged();
+
+	// Engine used to run the network
+	enum Engine {
+		ENGINE_FANN,
+		ENGINE_SIMD,
+		// Selected by quantize()
+		ENGINE_INT8
+	};
+	Engine engine;
+	// Whether the SIMD engine uses its approximate activation functions
+	bool fastActivations;
+	// Compiled copy of fann used by the SIMD engine.  Built on first use after each change.
+	std::shared_ptr<CompiledNet> compiled;
+	// Set once compiling has been tried, so networks the compiled engine can't handle aren't
+	// recompiled on every run
+	bool compileAttempted;
+	// Working memory for synchronous runs of the compiled network
+	CompiledNet::Scratch mainScratch;
+	#ifndef FANNY_FIXED
+	// Int8 copy of fann used by the int8 engine.  Discarded when the network changes, after
+	// which runs use FANN until quantize() is called again.
+	std::shared_ptr<QuantizedNet> quantized;
+	QuantizedNet::Scratch quantizedScratch;
+	// Copy of fann run by a kernel specialized for its layer sizes, which the FANN engine uses
+	// instead of fann when the network matches one.  Selected when the network is created or
+	// loaded, and after each change, reselected on first use.
+	std::shared_ptr<SmallNet> small;
+	bool smallAttempted;
+	#endif
+
+	// Returns the compiled network if the SIMD engine is selected and can run this network,
+	// otherwise an empty pointer
+	const std::shared_ptr<CompiledNet> &getCompiled();
+	#ifndef FANNY_FIXED
+	// Returns the specialized kernel if the FANN engine is selected and one matches this network,
+	// otherwise an empty pointer
+	const std::shared_ptr<SmallNet> &getSmallNet();
+	#endif
+	// Outputs of recent runs, if enabled with setPredictionCache().  Shared with queued
+	// asynchronous runs, which add their outputs unless it's been cleared since they were queued.
+	std::shared_ptr<PredictionCache> predictionCache;
+	// Holds outputs runOne() returns from the cache
+	std::vector<fann_type> cachedOutput;
+
+	// Set when the MINIBATCH training algorithm is selected.  FANN has no such algorithm, so fann is
+	// set to TRAIN_BATCH, whose weight update MiniBatchTrainer applies after each batch.
+	bool miniBatch;
+	// Number of datapairs in each batch of the MINIBATCH algorithm
+	unsigned int batchSize;
+
+	// Latencies recorded while stats are enabled with setStatsEnabled()
+	class LatencyStats {
+	public:
+		// Synchronous runs, per call
+		LatencyHistogram run;
+		// Asynchronous runs: time from being queued until starting, and time spent running
+		LatencyHistogram runQueue;
+		LatencyHistogram runExecute;
+		// Training epochs.  Epochs between progress reports are recorded as their average.
+		LatencyHistogram trainEpoch;
+	};
+	// Null while stats are disabled, so recording costs nothing.  Shared with queued asynchronous
+	// runs and training.
+	std::shared_ptr<LatencyStats> stats;
+
+	// Runs one set of inputs synchronously with the selected engine
+	const fann_type *runOne(fann_type *input);
+	// Same, for numRuns sets of inputs and outputs stored back-to-back.  Throws and returns false
+	// if FANN fails.
+	bool runBatchSync(fann_type *inputs, unsigned int numRuns, fann_type *outputs);
+	// Same as the above two, bypassing the prediction cache
+	const fann_type *runOneUncached(fann_type *input);
+	bool runBatchUncached(fann_type *inputs, unsigned int numRuns, fann_type *outputs);
+
+	// Set when fann was attached to a SharedArrayBuffer exported by another network.  Its weights
+	// are read from the buffer in place, so they can't change, and this keeps the buffer alive.
+	Nan::Persistent<v8::Object> sharedBuffer;
+	// Throws and returns false if the network's weights are attached read-only
+	bool checkWritable();
+
 private:
 
 	// Javascript Constructor.  Takes single "options" object parameter.  Options can include:
 	// - type (string) - One of "standard", "sparse", "shortcut"
 	// - layers (array of numbers)
 	// - connectionRate (number) - For sparse networks
+	// Also takes a Uint8Array over a SharedArrayBuffer from exportShared() to attach to.
 	static NAN_METHOD(New);
 
 	static NAN_METHOD(loadFile);
 
 	static NAN_METHOD(save);
+
+	// Returns the number of bytes exportShared() writes
+	static NAN_METHOD(getSharedSize);
+	// Writes the network's layout and weights into a Uint8Array over a SharedArrayBuffer, which
+	// other threads can attach networks to with the constructor
+	static NAN_METHOD(exportShared);
+	// Returns whether the network's weights are attached read-only from a SharedArrayBuffer
+	static NAN_METHOD(isShared);
 	static NAN_METHOD(saveToFixed);
 
 	// FANN "run" method.  Parameter is array of numbers.  Returns array of numbers.
 	// Also takes a callback.
 	static NAN_METHOD(runAsync);
 
-	// Synchronous version of "run".
+	// Synchronous version of "run".  Inputs may also be given as a typed array.
 	static NAN_METHOD(run);
+
+	// Like "run", but writes outputs into the typed array given as the second parameter
+	// instead of allocating a new array.  Returns the output typed array.
+	static NAN_METHOD(runInto);
+
+	// Runs a batch of inputs stored back-to-back in a typed array.  Parameters are the typed array
+	// and the number of runs in it.  Returns a typed array of all outputs, back-to-back.
+	static NAN_METHOD(runBatch);
+
+	// Asynchronous version of "runBatch".  Also takes a callback.
+	static NAN_METHOD(runBatchAsync);
+
+	// Like "run", but returns the outputs reduced natively (see OutputReduction).  Parameters are the
+	// inputs, the reduction ("argmax", "topk" or "threshold") and k or the threshold.  Returns the
+	// index for argmax, an array of indices for topk, and a Uint32Array bitmask for threshold.
+	static NAN_METHOD(runReduced);
+	// Same, for a batch as taken by "runBatch".  Returns a Uint32Array of each run's results
+	// back-to-back.
+	static NAN_METHOD(runBatchReduced);
 	static NAN_METHOD(getNumInput);
 	static NAN_METHOD(getNumOutput);
 	static NAN_METHOD(getTotalNeurons);
 	static NAN_METHOD(getTotalConnections);
 	static NAN_METHOD(getConnectionArray);
 	static NAN_METHOD(getNumLayers);
+	#ifdef FANNY_FIXED
+	static NAN_METHOD(getDecimalPoint);
+	static NAN_METHOD(getMultiplier);
+	#endif
 	static NAN_METHOD(getBitFail);
 	static NAN_METHOD(getBitFailLimit);
 	static NAN_METHOD(setBitFailLimit);
@@ -176,6 +317,42 @@ private:
 	static NAN_METHOD(setWeightArray);
 	static NAN_METHOD(setWeight);
 
+	static NAN_METHOD(getRunConcurrency);
+	static NAN_METHOD(setRunConcurrency);
+	static NAN_METHOD(getBatchSize);
+	static NAN_METHOD(setBatchSize);
+
+	// Engine is "fann" or "simd"
+	static NAN_METHOD(getEngine);
+	static NAN_METHOD(setEngine);
+	// Returns the instruction set used by the SIMD engine on this CPU
+	static NAN_METHOD(getSimdLevel);
+	// Activation mode is "exact" or "fast"
+	static NAN_METHOD(getActivationMode);
+	static NAN_METHOD(setActivationMode);
+	// Quantizes the network to int8, calibrated with the TrainingData given, and selects the int8
+	// engine.  Returns an object comparing the quantized network's accuracy with the original.
+	static NAN_METHOD(quantize);
+	// Returns the layer sizes of the specialized kernel the FANN engine runs, or null if none
+	static NAN_METHOD(getSpecializedKernel);
+	// Returns C++ source for a standalone copy of the network (see SourceGenerator), with
+	// everything in the namespace named by the argument
+	static NAN_METHOD(generateSource);
+	// Takes the cache's memory budget in bytes, 0 to disable it, and the quantum inputs are
+	// rounded to a multiple of before lookup, 0 to match them exactly
+	static NAN_METHOD(setPredictionCache);
+	static NAN_METHOD(getPredictionCacheSize);
+	static NAN_METHOD(getPredictionCacheQuantum);
+	// Returns an object with the cache's hits, misses, entries, bytes and maxBytes
+	static NAN_METHOD(getPredictionCacheStats);
+	static NAN_METHOD(resetPredictionCacheStats);
+	static NAN_METHOD(getStatsEnabled);
+	static NAN_METHOD(setStatsEnabled);
+	// Returns an object with the count, mean, p50, p90, p99 and max in milliseconds of each of
+	// run, runQueue, runExecute and trainEpoch, or null if stats are disabled
+	static NAN_METHOD(getStats);
+	static NAN_METHOD(resetStats);
+
 	static NAN_METHOD(getUserDataString);
 	static NAN_METHOD(setUserDataString);
 
@@ -204,6 +381,39 @@ private:
 
 };
 
+// The engine and network an asynchronous run of a FANNY uses, chosen on the main thread when the
+// run is queued.  Read-only engines are shared; otherwise it takes a replica, which it releases when
+// it's destroyed, also on the main thread.  runBatch() may be called from one thread at a time.
+class AsyncRunner {
+public:
+	explicit AsyncRunner(FANNY *fanny);
+	~AsyncRunner();
+
+	// Runs numRuns sets of inputs stored back-to-back.  Returns false and sets error if FANN fails.
+	bool runBatch(fann_type *inputs, unsigned int numRuns, fann_type *outputs, std::string &error);
+
+private:
+	AsyncRunner(const AsyncRunner &);
+	AsyncRunner &operator=(const AsyncRunner &);
+
+	FANNY *fanny;
+	unsigned int numInputs;
+	unsigned int numOutputs;
+	// Compiled network this runner runs on, if the SIMD engine is in use
+	std::shared_ptr<CompiledNet> compiled;
+	CompiledNet::Scratch scratch;
+	#ifndef FANNY_FIXED
+	// Quantized network this runner runs on, if the int8 engine is in use
+	std::shared_ptr<QuantizedNet> quantized;
+	QuantizedNet::Scratch quantizedScratch;
+	// Specialized kernel this runner runs, if the FANN engine has one for this network
+	std::shared_ptr<SmallNet> small;
+	#endif
+	// Otherwise, the network this runner runs on; either fanny->fann or a replica of it
+	FANN::neural_net *net;
+	unsigned int netVersion;
+};
+
 }
 
 #endif
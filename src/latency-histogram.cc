@@ -0,0 +1,68 @@
+#include "latency-histogram.h"
+#include <chrono>
+#include <cmath>
+
+namespace fanny {
+
+LatencyHistogram::LatencyHistogram() {
+	reset();
+}
+
+uint64_t LatencyHistogram::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+unsigned int LatencyHistogram::bucketOf(uint64_t value) {
+	if (value < 2 * SUB_BUCKETS) return (unsigned int)value;
+	// Index of the highest set bit, at least SUB_BUCKET_BITS + 1 here
+	unsigned int exponent = 63 - __builtin_clzll(value);
+	unsigned int shift = exponent - SUB_BUCKET_BITS;
+	return shift * SUB_BUCKETS + (unsigned int)(value >> shift);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(unsigned int bucket) {
+	if (bucket < 2 * SUB_BUCKETS) return bucket;
+	unsigned int shift = bucket / SUB_BUCKETS - 1;
+	uint64_t subBucket = bucket % SUB_BUCKETS + SUB_BUCKETS;
+	return ((subBucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds, uint64_t n) {
+	buckets[bucketOf(nanoseconds)].fetch_add(n, std::memory_order_relaxed);
+	count.fetch_add(n, std::memory_order_relaxed);
+	sum.fetch_add(nanoseconds * n, std::memory_order_relaxed);
+	uint64_t prevMax = max.load(std::memory_order_relaxed);
+	while (nanoseconds > prevMax && !max.compare_exchange_weak(prevMax, nanoseconds, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::reset() {
+	for (unsigned int i = 0; i < NUM_BUCKETS; i++) buckets[i].store(0, std::memory_order_relaxed);
+	count.store(0, std::memory_order_relaxed);
+	sum.store(0, std::memory_order_relaxed);
+	max.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::getMean() const {
+	uint64_t n = getCount();
+	return n ? (double)sum.load(std::memory_order_relaxed) / n : 0;
+}
+
+uint64_t LatencyHistogram::getPercentile(double fraction) const {
+	uint64_t n = getCount();
+	if (!n) return 0;
+	uint64_t target = (uint64_t)std::ceil(fraction * n);
+	if (target < 1) target = 1;
+	uint64_t seen = 0;
+	for (unsigned int i = 0; i < NUM_BUCKETS; i++) {
+		seen += buckets[i].load(std::memory_order_relaxed);
+		if (seen >= target) {
+			// The bucket's bound can be past the largest value actually recorded
+			uint64_t bound = bucketUpperBound(i);
+			uint64_t maxValue = getMax();
+			return (bound < maxValue) ? bound : maxValue;
+		}
+	}
+	return getMax();
+}
+
+}
@@ -0,0 +1,53 @@
+#ifndef FANNY_LATENCY_HISTOGRAM_H
+#define FANNY_LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace fanny {
+
+// Histogram of durations in nanoseconds with buckets of roughly equal relative width, like an HDR
+// histogram: values are exact below 32ns, and above that each power of two is split into 16
+// buckets, so percentiles are within about 6% of the recorded values.  Recording is lock-free and
+// can happen from several threads at once.
+class LatencyHistogram {
+public:
+	LatencyHistogram();
+
+	// Current time in nanoseconds from a monotonic clock
+	static uint64_t now();
+
+	// Records count occurrences of a duration
+	void record(uint64_t nanoseconds, uint64_t count = 1);
+	// Records the time elapsed since start, a value from now()
+	void recordSince(uint64_t start) { record(now() - start); }
+	void reset();
+
+	uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+	uint64_t getMax() const { return max.load(std::memory_order_relaxed); }
+	double getMean() const;
+	// Returns the duration the given fraction of values are at or below, as the upper bound of
+	// its bucket, or 0 if nothing has been recorded
+	uint64_t getPercentile(double fraction) const;
+
+private:
+	LatencyHistogram(const LatencyHistogram &);
+	LatencyHistogram &operator=(const LatencyHistogram &);
+
+	static const unsigned int SUB_BUCKET_BITS = 4;
+	static const unsigned int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	// Enough buckets for any 64-bit value
+	static const unsigned int NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+	static unsigned int bucketOf(uint64_t value);
+	static uint64_t bucketUpperBound(unsigned int bucket);
+
+	std::atomic<uint64_t> buckets[NUM_BUCKETS];
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> sum;
+	std::atomic<uint64_t> max;
+};
+
+}
+
+#endif
@@ -0,0 +1,198 @@
+#include "mini-batch-trainer.h"
+#include "fann-access.h"
+#include "fann-internal.h"
+#include "simd-kernels.h"
+#include "train-loop.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifndef FANNY_FIXED
+
+namespace fanny {
+
+// Datapairs backpropagated together while a row of weights or slopes stays in cache
+static const unsigned int BLOCK_SIZE = 16;
+
+// A neuron's sum as fann_run() stores it: with steepness applied and limited
+static inline fann_type limitSum(fann_type sum, fann_type steepness) {
+	sum = steepness * sum;
+	fann_type maxSum = 150 / steepness;
+	if (sum > maxSum) return maxSum;
+	if (sum < -maxSum) return -maxSum;
+	return sum;
+}
+
+MiniBatchTrainer::MiniBatchTrainer(FANN::neural_net *_net, unsigned int _batchSize) :
+	net(_net), ann(getFannStruct(_net)), batchSize(std::max(_batchSize, 1u))
+{
+	totalNeurons = ann->total_neurons;
+	if (ann->network_type != FANN_NETTYPE_LAYER || ann->connection_rate < 1) return;
+	struct fann_neuron *firstNeuron = ann->first_layer->first_neuron;
+	for (struct fann_layer *layer = ann->first_layer + 1; layer != ann->last_layer; layer++) {
+		struct fann_layer *src = layer - 1;
+		Layer l;
+		l.first = (unsigned int)(layer->first_neuron - firstNeuron);
+		// The last neuron of every layer is its bias neuron
+		l.count = (unsigned int)(layer->last_neuron - layer->first_neuron) - 1;
+		l.srcFirst = (unsigned int)(src->first_neuron - firstNeuron);
+		l.srcCount = (unsigned int)(src->last_neuron - src->first_neuron);
+		l.weightOffset = layer->first_neuron->first_con;
+		for (unsigned int i = 0; i < l.count; i++) {
+			struct fann_neuron *neuron = layer->first_neuron + i;
+			if (neuron->first_con != l.weightOffset + (size_t)i * l.srcCount || neuron->last_con - neuron->first_con != l.srcCount) {
+				layers.clear();
+				return;
+			}
+		}
+		layers.push_back(l);
+	}
+	activationFunctions.resize(totalNeurons);
+	steepnesses.resize(totalNeurons);
+	for (unsigned int n = 0; n < totalNeurons; n++) {
+		activationFunctions[n] = firstNeuron[n].activation_function;
+		steepnesses[n] = firstNeuron[n].activation_steepness;
+	}
+	sums.resize((size_t)batchSize * totalNeurons);
+	values.resize((size_t)batchSize * totalNeurons);
+	errors.resize((size_t)batchSize * totalNeurons);
+	for (unsigned int s = 0; s < batchSize; s++) {
+		for (size_t l = 0; l < layers.size(); l++) {
+			values[(size_t)s * totalNeurons + layers[l].srcFirst + layers[l].srcCount - 1] = 1;
+		}
+	}
+}
+
+void MiniBatchTrainer::addSlopesBatched(fann_type *const *inputs, fann_type *const *outputs, unsigned int count) {
+	const simd::Kernels &kernels = simd::getKernels();
+	const size_t stride = totalNeurons;
+	const fann_type *weights = ann->weights;
+	fann_type *slopes = ann->train_slopes;
+	for (unsigned int s = 0; s < count; s++) {
+		std::copy(inputs[s], inputs[s] + ann->num_input, &values[s * stride]);
+	}
+
+	// Forward, as fann_run()
+	for (size_t l = 0; l < layers.size(); l++) {
+		const Layer &layer = layers[l];
+		kernels.gemm(weights + layer.weightOffset, layer.srcCount, layer.count, &values[layer.srcFirst], stride, layer.srcCount, count, &sums[layer.first], stride, 0);
+		for (unsigned int s = 0; s < count; s++) {
+			fann_type *runValues = &values[s * stride];
+			std::copy(&sums[s * stride + layer.first], &sums[s * stride + layer.first + layer.count], runValues + layer.first);
+			unsigned int end = layer.first + layer.count;
+			for (unsigned int n = layer.first; n < end; ) {
+				unsigned int segmentEnd = n + 1;
+				while (segmentEnd < end && activationFunctions[segmentEnd] == activationFunctions[n]) segmentEnd++;
+				kernels.activate(activationFunctions[n], false, &steepnesses[n], runValues + n, segmentEnd - n);
+				n = segmentEnd;
+			}
+		}
+	}
+
+	// Output errors, as fann_compute_MSE()
+	const Layer &outputLayer = layers.back();
+	struct fann_neuron *firstNeuron = ann->first_layer->first_neuron;
+	for (unsigned int s = 0; s < count; s++) {
+		for (unsigned int o = 0; o < outputLayer.count; o++) {
+			size_t n = outputLayer.first + o;
+			size_t i = s * stride + n;
+			fann_type neuronDiff = fann_update_MSE(ann, firstNeuron + n, outputs[s][o] - values[i]);
+			if (ann->train_error_function) {
+				if (neuronDiff < -.9999999) {
+					neuronDiff = -17.0;
+				} else if (neuronDiff > .9999999) {
+					neuronDiff = 17.0;
+				} else {
+					neuronDiff = (fann_type)log((1.0 + neuronDiff) / (1.0 - neuronDiff));
+				}
+			}
+			errors[i] = fann_activation_derived(activationFunctions[n], steepnesses[n], values[i], limitSum(sums[i], steepnesses[n])) * neuronDiff;
+			ann->num_MSE++;
+		}
+	}
+
+	// Backward, as fann_backpropagate_MSE(), a block of datapairs per row of weights
+	for (size_t l = layers.size() - 1; l > 0; l--) {
+		const Layer &layer = layers[l];
+		const Layer &src = layers[l - 1];
+		for (unsigned int blockStart = 0; blockStart < count; blockStart += BLOCK_SIZE) {
+			unsigned int blockEnd = std::min(count, blockStart + BLOCK_SIZE);
+			for (unsigned int s = blockStart; s < blockEnd; s++) {
+				std::fill(&errors[s * stride + layer.srcFirst], &errors[s * stride + layer.srcFirst + layer.srcCount], (fann_type)0);
+			}
+			for (unsigned int r = 0; r < layer.count; r++) {
+				const fann_type *row = weights + layer.weightOffset + (size_t)r * layer.srcCount;
+				for (unsigned int s = blockStart; s < blockEnd; s++) {
+					kernels.axpy(row, errors[s * stride + layer.first + r], layer.srcCount, &errors[s * stride + layer.srcFirst], 0);
+				}
+			}
+		}
+		for (unsigned int s = 0; s < count; s++) {
+			for (unsigned int n = src.first; n < src.first + src.count; n++) {
+				size_t i = s * stride + n;
+				errors[i] *= fann_activation_derived(activationFunctions[n], steepnesses[n], values[i], limitSum(sums[i], steepnesses[n]));
+			}
+		}
+	}
+
+	// Slopes, as fann_update_slopes_batch()
+	for (size_t l = 0; l < layers.size(); l++) {
+		const Layer &layer = layers[l];
+		for (unsigned int blockStart = 0; blockStart < count; blockStart += BLOCK_SIZE) {
+			unsigned int blockEnd = std::min(count, blockStart + BLOCK_SIZE);
+			for (unsigned int r = 0; r < layer.count; r++) {
+				fann_type *row = slopes + layer.weightOffset + (size_t)r * layer.srcCount;
+				for (unsigned int s = blockStart; s < blockEnd; s++) {
+					kernels.axpy(&values[s * stride + layer.srcFirst], errors[s * stride + layer.first + r], layer.srcCount, row, 0);
+				}
+			}
+		}
+	}
+}
+
+void MiniBatchTrainer::addSlopesPerDatapair(fann_type *const *inputs, fann_type *const *outputs, unsigned int count) {
+	for (unsigned int i = 0; i < count; i++) {
+		fann_run(ann, inputs[i]);
+		fann_compute_MSE(ann, outputs[i]);
+		fann_backpropagate_MSE(ann);
+		fann_update_slopes_batch(ann, ann->first_layer + 1, ann->last_layer - 1);
+	}
+}
+
+float MiniBatchTrainer::trainEpoch(FANN::training_data &data) {
+	struct fann_train_data *trainData = getTrainDataStruct(&data);
+	if (!trainData || trainData->num_input != ann->num_input || trainData->num_output != ann->num_output) {
+		// Lets FANN report the error
+		return net->train_epoch(data);
+	}
+	if (!ann->train_slopes) {
+		fann_clear_train_arrays(ann);
+		if (!ann->train_slopes) return 0;
+	}
+	memset(ann->train_slopes, 0, ann->total_connections * sizeof(fann_type));
+	fann_reset_MSE(ann);
+	for (unsigned int start = 0; start < trainData->num_data; start += batchSize) {
+		unsigned int count = std::min(batchSize, trainData->num_data - start);
+		if (layers.empty()) {
+			addSlopesPerDatapair(trainData->input + start, trainData->output + start, count);
+		} else {
+			addSlopesBatched(trainData->input + start, trainData->output + start, count);
+		}
+		// Moves the weights by the learning rate times the mean slope, and clears the slopes
+		fann_update_weights_batch(ann, count, 0, ann->total_connections);
+	}
+	return fann_get_MSE(ann);
+}
+
+void MiniBatchTrainer::trainOnData(FANN::training_data &data, unsigned int maxEpochs, unsigned int epochsBetweenReports, float desiredError) {
+	struct fann_train_data *trainData = getTrainDataStruct(&data);
+	if (!trainData || trainData->num_input != ann->num_input || trainData->num_output != ann->num_output) {
+		net->train_on_data(data, maxEpochs, epochsBetweenReports, desiredError);
+		return;
+	}
+	trainOnDataLoop(ann, trainData, maxEpochs, epochsBetweenReports, desiredError, [this, &data]() { return trainEpoch(data); });
+}
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef FANNY_MINI_BATCH_TRAINER_H
+#define FANNY_MINI_BATCH_TRAINER_H
+
+#include "fann-includes.h"
+#include <vector>
+
+#ifndef FANNY_FIXED
+
+namespace fanny {
+
+// Trains a network with mini-batch gradient descent: the training data is taken batchSize datapairs
+// at a time, and after each batch the weights are moved by the learning rate times the batch's mean
+// gradient, using FANN's TRAIN_BATCH update.  Datapairs are taken in order, so shuffle the data
+// between epochs for stochastic batches.
+//
+// For fully connected standard networks, each batch is run forwards and backwards one layer at a
+// time for all of its datapairs, with the SIMD kernels, so each layer's weights are loaded once per
+// batch rather than once per datapair.  Errors and derivatives are computed as FANN computes them.
+// Other networks are run and backpropagated one datapair at a time with FANN's own functions.
+class MiniBatchTrainer {
+public:
+	// The network must not be changed by anything else while the trainer exists
+	MiniBatchTrainer(FANN::neural_net *net, unsigned int batchSize);
+
+	// Same as net->train_epoch(data), with the weights updated after each batch
+	float trainEpoch(FANN::training_data &data);
+	// Same as net->train_on_data(), including calls to the network's progress callback
+	void trainOnData(FANN::training_data &data, unsigned int maxEpochs, unsigned int epochsBetweenReports, float desiredError);
+
+private:
+	MiniBatchTrainer(const MiniBatchTrainer &);
+	MiniBatchTrainer &operator=(const MiniBatchTrainer &);
+
+	// Adds the slopes of count datapairs to the network's train_slopes and their errors to its MSE
+	void addSlopesBatched(fann_type *const *inputs, fann_type *const *outputs, unsigned int count);
+	void addSlopesPerDatapair(fann_type *const *inputs, fann_type *const *outputs, unsigned int count);
+
+	// A layer of neurons computed from the whole of the previous layer, including its bias neuron.
+	// Neurons are indexed the same way as FANN's neuron array.
+	struct Layer {
+		unsigned int first;
+		unsigned int count;
+		unsigned int srcFirst;
+		unsigned int srcCount;
+		// Offset of the layer's weights in the network's weights, one row of srcCount per neuron
+		size_t weightOffset;
+	};
+
+	FANN::neural_net *net;
+	struct fann *ann;
+	unsigned int batchSize;
+	// Empty when the network isn't a fully connected standard network
+	std::vector<Layer> layers;
+	unsigned int totalNeurons;
+	std::vector<enum fann_activationfunc_enum> activationFunctions;
+	std::vector<fann_type> steepnesses;
+	// Sum before steepness, value and error of every neuron for each datapair in a batch, one
+	// datapair every totalNeurons elements
+	std::vector<fann_type> sums;
+	std::vector<fann_type> values;
+	std::vector<fann_type> errors;
+};
+
+}
+
+#endif
+
+#endif
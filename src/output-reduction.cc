@@ -0,0 +1,54 @@
+#include "output-reduction.h"
+
+namespace fanny {
+
+bool OutputReduction::parseKind(const std::string &name, Kind &kind) {
+	if (name == "argmax") {
+		kind = ARGMAX;
+	} else if (name == "topk") {
+		kind = TOP_K;
+	} else if (name == "threshold") {
+		kind = THRESHOLD;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+OutputReduction::OutputReduction(Kind _kind, unsigned int _numOutput, unsigned int _k, double _threshold) :
+	kind(_kind), numOutput(_numOutput), k(_k), threshold(_threshold)
+{
+	if (kind == ARGMAX) resultSize = 1;
+	else if (kind == TOP_K) resultSize = k;
+	else resultSize = (numOutput + 31) / 32;
+}
+
+void OutputReduction::reduce(const fann_type *outputs, uint32_t *result) const {
+	if (kind == ARGMAX) {
+		uint32_t best = 0;
+		for (unsigned int i = 1; i < numOutput; i++) {
+			if (outputs[i] > outputs[best]) best = i;
+		}
+		result[0] = best;
+	} else if (kind == TOP_K) {
+		// Inserts each output into the sorted top k so far, which beats sorting every output for
+		// the small k this is used with.  Ties keep the lower index first.
+		unsigned int count = 0;
+		for (unsigned int i = 0; i < numOutput; i++) {
+			if (count == k && !(outputs[i] > outputs[result[k - 1]])) continue;
+			unsigned int pos = (count < k) ? count++ : k - 1;
+			while (pos > 0 && outputs[i] > outputs[result[pos - 1]]) {
+				result[pos] = result[pos - 1];
+				pos--;
+			}
+			result[pos] = i;
+		}
+	} else {
+		for (unsigned int word = 0; word < resultSize; word++) result[word] = 0;
+		for (unsigned int i = 0; i < numOutput; i++) {
+			if ((double)outputs[i] >= threshold) result[i / 32] |= (uint32_t)1 << (i % 32);
+		}
+	}
+}
+
+}
@@ -0,0 +1,44 @@
+#ifndef FANNY_OUTPUT_REDUCTION_H
+#define FANNY_OUTPUT_REDUCTION_H
+
+#include "fann-includes.h"
+#include <cstdint>
+#include <string>
+
+namespace fanny {
+
+// Reduces a run's outputs to a few 32-bit values, so callers that only need the winning outputs
+// don't have to copy every output into Javascript
+class OutputReduction {
+public:
+	enum Kind {
+		// Index of the largest output
+		ARGMAX,
+		// Indices of the k largest outputs, largest first
+		TOP_K,
+		// Bitmask of the outputs at or above a threshold; bit i % 32 of word i / 32 is output i
+		THRESHOLD
+	};
+
+	// Sets kind from "argmax", "topk" or "threshold" and returns true, or returns false
+	static bool parseKind(const std::string &name, Kind &kind);
+
+	// k is used by TOP_K and threshold by THRESHOLD.  k must be between 1 and numOutput.
+	OutputReduction(Kind kind, unsigned int numOutput, unsigned int k, double threshold);
+
+	// Number of values reduce() writes per run
+	unsigned int getResultSize() const { return resultSize; }
+	// Reduces one run's numOutput outputs
+	void reduce(const fann_type *outputs, uint32_t *result) const;
+
+private:
+	Kind kind;
+	unsigned int numOutput;
+	unsigned int k;
+	double threshold;
+	unsigned int resultSize;
+};
+
+}
+
+#endif
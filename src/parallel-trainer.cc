@@ -0,0 +1,193 @@
+#include "parallel-trainer.h"
+#include "fann-access.h"
+#include "fann-internal.h"
+#include "train-loop.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef FANNY_FIXED
+
+namespace fanny {
+
+bool ParallelTrainer::supports(FANN::neural_net *net, bool hogwild) {
+	if (hogwild) return getFannStruct(net)->training_algorithm == FANN_TRAIN_INCREMENTAL;
+	switch (getFannStruct(net)->training_algorithm) {
+		case FANN_TRAIN_BATCH:
+		case FANN_TRAIN_RPROP:
+		case FANN_TRAIN_QUICKPROP:
+		case FANN_TRAIN_SARPROP:
+			return true;
+		default:
+			return false;
+	}
+}
+
+ParallelTrainer::ParallelTrainer(FANN::neural_net *_net, unsigned int numThreads, bool _hogwild) :
+	net(_net), ann(getFannStruct(_net)), hogwild(_hogwild), random(rand()),
+	epochNumber(0), currentData(NULL), workersRunning(0), stopping(false)
+{
+	for (unsigned int i = 1; i < numThreads; i++) {
+		struct fann *replica = fann_copy(ann);
+		if (!replica) break;
+		if (hogwild) {
+			replicaWeights.push_back(replica->weights);
+			replica->weights = ann->weights;
+			replicas.push_back(replica);
+			continue;
+		}
+		// Allocated here rather than by the first fann_update_slopes_batch(), which has no way to
+		// report running out of memory
+		if (!replica->train_slopes) {
+			replica->train_slopes = (fann_type *)calloc(replica->total_connections_allocated, sizeof(fann_type));
+			if (!replica->train_slopes) {
+				fann_destroy(replica);
+				break;
+			}
+		}
+		replicas.push_back(replica);
+	}
+	for (unsigned int i = 0; i < replicas.size(); i++) {
+		threads.push_back(std::thread(&ParallelTrainer::workerMain, this, i + 1));
+	}
+}
+
+ParallelTrainer::~ParallelTrainer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	startCondition.notify_all();
+	for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+	for (size_t i = 0; i < replicas.size(); i++) {
+		if (hogwild) replicas[i]->weights = replicaWeights[i];
+		fann_destroy(replicas[i]);
+	}
+}
+
+unsigned int ParallelTrainer::shardStart(unsigned int shard, unsigned int numData) const {
+	return (unsigned int)((unsigned long long)numData * shard / (replicas.size() + 1));
+}
+
+void ParallelTrainer::trainShard(struct fann *ann, struct fann_train_data *data, unsigned int first, unsigned int last) {
+	if (hogwild) {
+		// fann_train_epoch_incremental() over this slice of the shuffled samples
+		for (unsigned int i = first; i < last; i++) fann_train(ann, data->input[order[i]], data->output[order[i]]);
+		return;
+	}
+	for (unsigned int i = first; i < last; i++) {
+		fann_run(ann, data->input[i]);
+		fann_compute_MSE(ann, data->output[i]);
+		fann_backpropagate_MSE(ann);
+		fann_update_slopes_batch(ann, ann->first_layer + 1, ann->last_layer - 1);
+	}
+}
+
+void ParallelTrainer::workerMain(unsigned int shard) {
+	unsigned long lastEpoch = 0;
+	struct fann *replica = replicas[shard - 1];
+	for (;;) {
+		struct fann_train_data *data;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!stopping && epochNumber == lastEpoch) startCondition.wait(lock);
+			if (stopping) return;
+			lastEpoch = epochNumber;
+			data = currentData;
+		}
+		trainShard(replica, data, shardStart(shard, data->num_data), shardStart(shard + 1, data->num_data));
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--workersRunning == 0) doneCondition.notify_one();
+	}
+}
+
+void ParallelTrainer::runShards(struct fann_train_data *data) {
+	if (!replicas.empty()) {
+		std::lock_guard<std::mutex> lock(mutex);
+		currentData = data;
+		workersRunning = (unsigned int)replicas.size();
+		epochNumber++;
+	}
+	startCondition.notify_all();
+	trainShard(ann, data, 0, shardStart(1, data->num_data));
+	if (!replicas.empty()) {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (workersRunning) doneCondition.wait(lock);
+	}
+	for (size_t i = 0; i < replicas.size(); i++) {
+		ann->MSE_value += replicas[i]->MSE_value;
+		ann->num_MSE += replicas[i]->num_MSE;
+		ann->num_bit_fail += replicas[i]->num_bit_fail;
+	}
+}
+
+float ParallelTrainer::trainEpoch(FANN::training_data &data) {
+	struct fann_train_data *trainData = getTrainDataStruct(&data);
+	if (!trainData || trainData->num_input != ann->num_input || trainData->num_output != ann->num_output) {
+		// Lets FANN report the error
+		return net->train_epoch(data);
+	}
+
+	if (hogwild) {
+		fann_reset_MSE(ann);
+		for (size_t i = 0; i < replicas.size(); i++) fann_reset_MSE(replicas[i]);
+		order.resize(trainData->num_data);
+		for (unsigned int i = 0; i < trainData->num_data; i++) order[i] = i;
+		std::shuffle(order.begin(), order.end(), random);
+		runShards(trainData);
+		return fann_get_MSE(ann);
+	}
+
+	// The same setup as FANN's epoch functions, except that slopes are cleared here since the
+	// replicas' are added to them afterwards
+	if (!ann->train_slopes || (ann->training_algorithm != FANN_TRAIN_BATCH && !ann->prev_train_slopes)) {
+		fann_clear_train_arrays(ann);
+		if (!ann->train_slopes) return 0;
+	}
+	memset(ann->train_slopes, 0, ann->total_connections * sizeof(fann_type));
+	fann_reset_MSE(ann);
+	for (size_t i = 0; i < replicas.size(); i++) {
+		memcpy(replicas[i]->weights, ann->weights, ann->total_connections * sizeof(fann_type));
+		memset(replicas[i]->train_slopes, 0, ann->total_connections * sizeof(fann_type));
+		fann_reset_MSE(replicas[i]);
+	}
+
+	runShards(trainData);
+	fann_type *slopes = ann->train_slopes;
+	for (size_t i = 0; i < replicas.size(); i++) {
+		const fann_type *replicaSlopes = replicas[i]->train_slopes;
+		for (unsigned int c = 0; c < ann->total_connections; c++) slopes[c] += replicaSlopes[c];
+	}
+
+	switch (ann->training_algorithm) {
+		case FANN_TRAIN_RPROP:
+			fann_update_weights_irpropm(ann, 0, ann->total_connections);
+			break;
+		case FANN_TRAIN_QUICKPROP:
+			fann_update_weights_quickprop(ann, trainData->num_data, 0, ann->total_connections);
+			break;
+		case FANN_TRAIN_SARPROP:
+			fann_update_weights_sarprop(ann, ann->sarprop_epoch, 0, ann->total_connections);
+			++(ann->sarprop_epoch);
+			break;
+		case FANN_TRAIN_BATCH:
+			fann_update_weights_batch(ann, trainData->num_data, 0, ann->total_connections);
+			break;
+		default:
+			break;
+	}
+	return fann_get_MSE(ann);
+}
+
+void ParallelTrainer::trainOnData(FANN::training_data &data, unsigned int maxEpochs, unsigned int epochsBetweenReports, float desiredError) {
+	struct fann_train_data *trainData = getTrainDataStruct(&data);
+	if (!trainData || trainData->num_input != ann->num_input || trainData->num_output != ann->num_output) {
+		net->train_on_data(data, maxEpochs, epochsBetweenReports, desiredError);
+		return;
+	}
+	trainOnDataLoop(ann, trainData, maxEpochs, epochsBetweenReports, desiredError, [this, &data]() { return trainEpoch(data); });
+}
+
+}
+
+#endif
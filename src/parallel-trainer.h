@@ -0,0 +1,83 @@
+#ifndef FANNY_PARALLEL_TRAINER_H
+#define FANNY_PARALLEL_TRAINER_H
+
+#include "fann-includes.h"
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifndef FANNY_FIXED
+
+namespace fanny {
+
+// Trains a network with one of FANN's batch algorithms (RPROP, QUICKPROP, SARPROP and BATCH) on
+// several threads.  Each epoch the training data is split into one contiguous shard per thread.
+// Each thread runs and backpropagates its shard on its own replica of the network, summing slopes
+// just as FANN does for the whole data set.  The replicas' slopes are then added together in thread
+// order and the algorithm's weight update is applied once to the network itself.
+//
+// Results match single-threaded training except for the order slopes and errors are summed in, so
+// they can differ in the last bits.  For a given number of threads they are deterministic.
+//
+// In Hogwild mode it instead trains the INCREMENTAL algorithm.  Each epoch the data is shuffled and
+// each thread trains one slice of it, sample by sample, on a replica that shares the network's
+// weight array.  Threads update the weights without any locking, so they can overwrite each other's
+// updates and results vary between runs.  This pays off when each sample only changes a small part
+// of the weights, as with sparse networks or sparse inputs.
+class ParallelTrainer {
+public:
+	// Returns whether the network's training algorithm can be trained in parallel, in Hogwild mode
+	// or not
+	static bool supports(FANN::neural_net *net, bool hogwild);
+
+	// The network must not be changed by anything else while the trainer exists.  numThreads
+	// includes the calling thread.
+	ParallelTrainer(FANN::neural_net *net, unsigned int numThreads, bool hogwild);
+	~ParallelTrainer();
+
+	// Same as net->train_epoch(data)
+	float trainEpoch(FANN::training_data &data);
+	// Same as net->train_on_data(), including calls to the network's progress callback
+	void trainOnData(FANN::training_data &data, unsigned int maxEpochs, unsigned int epochsBetweenReports, float desiredError);
+
+private:
+	ParallelTrainer(const ParallelTrainer &);
+	ParallelTrainer &operator=(const ParallelTrainer &);
+
+	// Runs and backpropagates one shard, adding its slopes and errors to those in ann, or in Hogwild
+	// mode training it on the shared weights
+	void trainShard(struct fann *ann, struct fann_train_data *data, unsigned int first, unsigned int last);
+	unsigned int shardStart(unsigned int shard, unsigned int numData) const;
+	// Runs one epoch of every shard, including the first on the calling thread
+	void runShards(struct fann_train_data *data);
+	void workerMain(unsigned int shard);
+
+	FANN::neural_net *net;
+	struct fann *ann;
+	bool hogwild;
+	// Replica used by each shard after the first, which is trained on ann itself
+	std::vector<struct fann *> replicas;
+	// In Hogwild mode, each replica's own weight array, put back before it's destroyed
+	std::vector<fann_type *> replicaWeights;
+	// In Hogwild mode, the order this epoch's samples are trained in
+	std::vector<unsigned int> order;
+	std::mt19937 random;
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable startCondition;
+	std::condition_variable doneCondition;
+	// Incremented to start the workers on an epoch of currentData
+	unsigned long epochNumber;
+	struct fann_train_data *currentData;
+	unsigned int workersRunning;
+	bool stopping;
+};
+
+}
+
+#endif
+
+#endif
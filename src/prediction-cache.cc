@@ -0,0 +1,113 @@
+#include "prediction-cache.h"
+#include <cmath>
+#include <cstring>
+
+namespace fanny {
+
+// Approximate bookkeeping cost of an entry beyond its inputs and outputs: the list node, the two
+// vectors' heap blocks, the hash table node and its share of the bucket array
+static const size_t ENTRY_OVERHEAD = 128;
+
+PredictionCache::PredictionCache(size_t _maxBytes, double _quantum, unsigned int _numInput, unsigned int _numOutput) :
+	maxBytes(_maxBytes), quantum(_quantum), numInput(_numInput), numOutput(_numOutput), generation(0), hits(0), misses(0)
+{
+	entryBytes = ENTRY_OVERHEAD + (numInput + numOutput) * sizeof(fann_type);
+	maxEntries = maxBytes / entryBytes;
+}
+
+fann_type PredictionCache::keyValue(fann_type value) const {
+	if (quantum > 0) value = (fann_type)(std::floor(value / quantum + 0.5) * quantum);
+	// -0 and 0 have different bits but are the same input
+	if (value == 0) value = 0;
+	return value;
+}
+
+uint64_t PredictionCache::hashKey(const fann_type *input) const {
+	uint64_t hash = 0x9e3779b97f4a7c15ULL ^ numInput;
+	for (unsigned int i = 0; i < numInput; i++) {
+		fann_type value = keyValue(input[i]);
+		// Mixes in each value's bits with the 64-bit finalizer from MurmurHash3
+		uint64_t bits = 0;
+		memcpy(&bits, &value, sizeof(value));
+		hash ^= bits + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdULL;
+		hash ^= hash >> 33;
+	}
+	return hash;
+}
+
+bool PredictionCache::keyMatches(const std::vector<fann_type> &key, const fann_type *input) const {
+	for (unsigned int i = 0; i < numInput; i++) {
+		if (key[i] != keyValue(input[i])) return false;
+	}
+	return true;
+}
+
+bool PredictionCache::lookup(const fann_type *input, fann_type *output) {
+	uint64_t hash = hashKey(input);
+	std::lock_guard<std::mutex> lock(mutex);
+	std::unordered_map<uint64_t, EntryList::iterator>::iterator it = index.find(hash);
+	if (it == index.end() || !keyMatches(it->second->key, input)) {
+		misses++;
+		return false;
+	}
+	hits++;
+	entries.splice(entries.begin(), entries, it->second);
+	std::copy(it->second->output.begin(), it->second->output.end(), output);
+	return true;
+}
+
+void PredictionCache::insert(const fann_type *input, const fann_type *output, unsigned long fromGeneration) {
+	if (!maxEntries) return;
+	uint64_t hash = hashKey(input);
+	std::lock_guard<std::mutex> lock(mutex);
+	if (fromGeneration != generation) return;
+	// Reuses the entry being replaced or evicted, along with its vectors' memory, when there is one
+	std::unordered_map<uint64_t, EntryList::iterator>::iterator it = index.find(hash);
+	if (it != index.end()) {
+		entries.splice(entries.begin(), entries, it->second);
+	} else if (entries.size() >= maxEntries) {
+		index.erase(entries.back().hash);
+		entries.splice(entries.begin(), entries, --entries.end());
+		index[hash] = entries.begin();
+	} else {
+		entries.push_front(Entry());
+		index[hash] = entries.begin();
+	}
+	Entry &entry = entries.front();
+	entry.hash = hash;
+	entry.key.resize(numInput);
+	for (unsigned int i = 0; i < numInput; i++) entry.key[i] = keyValue(input[i]);
+	entry.output.assign(output, output + numOutput);
+}
+
+void PredictionCache::clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	index.clear();
+	generation++;
+}
+
+unsigned long PredictionCache::getGeneration() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return generation;
+}
+
+PredictionCache::Stats PredictionCache::getStats() {
+	std::lock_guard<std::mutex> lock(mutex);
+	Stats stats;
+	stats.hits = hits;
+	stats.misses = misses;
+	stats.entries = entries.size();
+	stats.bytes = entries.size() * entryBytes;
+	return stats;
+}
+
+void PredictionCache::resetStats() {
+	std::lock_guard<std::mutex> lock(mutex);
+	hits = 0;
+	misses = 0;
+}
+
+}
@@ -0,0 +1,105 @@
+#ifndef FANNY_PREDICTION_CACHE_H
+#define FANNY_PREDICTION_CACHE_H
+
+#include "fann-includes.h"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace fanny {
+
+// Least recently used cache of a network's outputs, keyed by its inputs.  Inputs can be rounded to
+// a multiple of a quantum first, so nearly equal inputs share an entry.  The number of entries is
+// bounded so the cache stays within a memory budget.  Safe to use from several threads at once.
+class PredictionCache {
+public:
+	// quantum of 0 keys entries by the exact inputs
+	PredictionCache(size_t maxBytes, double quantum, unsigned int numInput, unsigned int numOutput);
+
+	// Copies the cached outputs for input to output and returns true, or returns false on a miss
+	bool lookup(const fann_type *input, fann_type *output);
+	// Caches output for input, unless the cache has been cleared since generation was read
+	void insert(const fann_type *input, const fann_type *output, unsigned long generation);
+	// Runs numRuns sets of inputs stored back-to-back, copying cached outputs and passing the rest,
+	// gathered back-to-back, to runMisses(inputs, numRuns, outputs), which returns false on failure.
+	// Outputs it computes are added to the cache if it hasn't been cleared since generation.
+	template<typename RunFn>
+	bool runBatch(const fann_type *inputs, unsigned int numRuns, fann_type *outputs, unsigned long generation, RunFn runMisses);
+	// Discards every entry, for when the network's outputs change
+	void clear();
+	// Incremented by each clear(); read before computing outputs to pass to insert()
+	unsigned long getGeneration();
+
+	size_t getMaxBytes() const { return maxBytes; }
+	double getQuantum() const { return quantum; }
+
+	struct Stats {
+		uint64_t hits;
+		uint64_t misses;
+		size_t entries;
+		size_t bytes;
+	};
+	Stats getStats();
+	void resetStats();
+
+private:
+	PredictionCache(const PredictionCache &);
+	PredictionCache &operator=(const PredictionCache &);
+
+	struct Entry {
+		uint64_t hash;
+		std::vector<fann_type> key;
+		std::vector<fann_type> output;
+	};
+	typedef std::list<Entry> EntryList;
+
+	// An input value as it's cached: rounded to the quantum, with -0 as 0
+	fann_type keyValue(fann_type value) const;
+	// Hashes the cached form of input without building it
+	uint64_t hashKey(const fann_type *input) const;
+	bool keyMatches(const std::vector<fann_type> &key, const fann_type *input) const;
+
+	size_t maxBytes;
+	double quantum;
+	unsigned int numInput;
+	unsigned int numOutput;
+	size_t maxEntries;
+	size_t entryBytes;
+
+	std::mutex mutex;
+	// Most recently used first
+	EntryList entries;
+	// Entries by hash.  Entries whose hashes collide replace each other.
+	std::unordered_map<uint64_t, EntryList::iterator> index;
+	unsigned long generation;
+	uint64_t hits;
+	uint64_t misses;
+};
+
+template<typename RunFn>
+bool PredictionCache::runBatch(const fann_type *inputs, unsigned int numRuns, fann_type *outputs, unsigned long fromGeneration, RunFn runMisses) {
+	std::vector<unsigned int> missed;
+	for (unsigned int run = 0; run < numRuns; run++) {
+		if (!lookup(inputs + (size_t)run * numInput, outputs + (size_t)run * numOutput)) missed.push_back(run);
+	}
+	if (missed.empty()) return true;
+	std::vector<fann_type> missInputs(missed.size() * numInput);
+	for (size_t i = 0; i < missed.size(); i++) {
+		std::copy(inputs + (size_t)missed[i] * numInput, inputs + (size_t)(missed[i] + 1) * numInput, &missInputs[i * numInput]);
+	}
+	std::vector<fann_type> missOutputs(missed.size() * numOutput);
+	if (!runMisses(missInputs.data(), (unsigned int)missed.size(), missOutputs.data())) return false;
+	for (size_t i = 0; i < missed.size(); i++) {
+		std::copy(&missOutputs[i * numOutput], &missOutputs[(i + 1) * numOutput], outputs + (size_t)missed[i] * numOutput);
+		insert(&missInputs[i * numInput], &missOutputs[i * numOutput], fromGeneration);
+	}
+	return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,194 @@
+#include "quantized-net.h"
+#include "simd-kernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#ifndef FANNY_FIXED
+
+namespace fanny {
+
+static std::atomic<unsigned long> nextQuantizedNetId(1);
+
+QuantizedNet::QuantizedNet() : id(nextQuantizedNetId++) {}
+
+// Rounds a scaled value to the nearest int8, saturating at +/-127 so the kernels can't overflow
+static inline int8_t toInt8(fann_type value) {
+	if (value > 127) return 127;
+	if (value < -127) return -127;
+	return (int8_t)(value < 0 ? value - (fann_type)0.5 : value + (fann_type)0.5);
+}
+
+std::shared_ptr<QuantizedNet> QuantizedNet::quantize(const CompiledNet &net, const fann_type *const *inputs, unsigned int numInputs) {
+	std::shared_ptr<QuantizedNet> qn(new QuantizedNet());
+	qn->numInput = net.numInput;
+	qn->numOutput = net.numOutput;
+	qn->totalNeurons = net.totalNeurons;
+	qn->outputFirst = net.outputFirst;
+	qn->biasNeurons = net.biasNeurons;
+	qn->steepnesses = net.steepnesses;
+	qn->activationSegments = net.activationSegments;
+	qn->fastActivations = net.fastActivations;
+	qn->maxStride = 0;
+	qn->maxLayerCount = 0;
+
+	std::vector<bool> isBias(net.totalNeurons, false);
+	for (size_t i = 0; i < net.biasNeurons.size(); i++) isBias[net.biasNeurons[i]] = true;
+
+	// Largest magnitude of each layer's source values over the calibration inputs
+	std::vector<fann_type> ranges(net.layers.size(), 0);
+	CompiledNet::Scratch scratch;
+	for (unsigned int run = 0; run < numInputs; run++) {
+		const fann_type *values = net.runNeurons(inputs[run], scratch);
+		for (size_t l = 0; l < net.layers.size(); l++) {
+			const CompiledNet::Layer &layer = net.layers[l];
+			for (unsigned int i = layer.srcFirst; i < layer.srcFirst + layer.srcCount; i++) {
+				if (!isBias[i]) ranges[l] = std::max(ranges[l], (fann_type)std::fabs(values[i]));
+			}
+		}
+	}
+
+	size_t totalWeights = 0;
+	for (size_t l = 0; l < net.layers.size(); l++) {
+		const CompiledNet::Layer &src = net.layers[l];
+		Layer layer;
+		layer.first = src.first;
+		layer.count = src.count;
+		layer.srcFirst = src.srcFirst;
+		layer.srcCount = src.srcCount;
+		// Rows are packed back-to-back; the kernels handle the ends that don't fill a vector
+		layer.stride = src.srcCount;
+		layer.weightOffset = totalWeights;
+		layer.inputScale = (ranges[l] > 0) ? 127 / ranges[l] : 1;
+		layer.segmentFirst = src.segmentFirst;
+		layer.segmentCount = src.segmentCount;
+		totalWeights += layer.stride * layer.count;
+		qn->maxStride = std::max(qn->maxStride, layer.stride);
+		qn->maxLayerCount = std::max(qn->maxLayerCount, layer.count);
+		qn->layers.push_back(layer);
+	}
+
+	qn->weights.resize(totalWeights);
+	qn->outputScales.assign(net.totalNeurons, 0);
+	qn->biasSums.assign(net.totalNeurons, 0);
+	std::vector<fann_type> row;
+	for (size_t l = 0; l < qn->layers.size(); l++) {
+		const Layer &layer = qn->layers[l];
+		row.resize(layer.srcCount);
+		const fann_type *src = row.data();
+		for (unsigned int r = 0; r < layer.count; r++) {
+			net.getDenseRow(net.layers[l], r, row.data());
+			int8_t *dst = qn->weights.data() + layer.weightOffset + r * layer.stride;
+			fann_type maxWeight = 0;
+			fann_type biasSum = 0;
+			for (unsigned int i = 0; i < layer.srcCount; i++) {
+				if (isBias[layer.srcFirst + i]) biasSum += src[i];
+				else maxWeight = std::max(maxWeight, (fann_type)std::fabs(src[i]));
+			}
+			fann_type weightScale = (maxWeight > 0) ? 127 / maxWeight : 1;
+			// Bias columns stay zero
+			for (unsigned int i = 0; i < layer.srcCount; i++) {
+				if (!isBias[layer.srcFirst + i]) dst[i] = toInt8(src[i] * weightScale);
+			}
+			qn->outputScales[layer.first + r] = 1 / (weightScale * layer.inputScale);
+			qn->biasSums[layer.first + r] = biasSum;
+		}
+	}
+	return qn;
+}
+
+void QuantizedNet::prepareScratch(Scratch &scratch) const {
+	scratch.values.resize(totalNeurons);
+	for (size_t i = 0; i < biasNeurons.size(); i++) scratch.values[biasNeurons[i]] = 1;
+	scratch.quantizedValues.resize(maxStride);
+	scratch.sums.resize(maxLayerCount);
+	scratch.netId = id;
+}
+
+size_t QuantizedNet::getWeightBytes() const {
+	return weights.size() * sizeof(int8_t) + (outputScales.size() + biasSums.size()) * sizeof(fann_type);
+}
+
+const fann_type *QuantizedNet::run(const fann_type *input, Scratch &scratch) const {
+	if (scratch.netId != id) prepareScratch(scratch);
+	fann_type *values = scratch.values.data();
+	int8_t *quantizedValues = scratch.quantizedValues.data();
+	int32_t *sums = scratch.sums.data();
+	std::copy(input, input + numInput, values);
+	const simd::Kernels &kernels = simd::getKernels();
+	for (size_t l = 0; l < layers.size(); l++) {
+		const Layer &layer = layers[l];
+		const fann_type *src = values + layer.srcFirst;
+		for (unsigned int i = 0; i < layer.srcCount; i++) quantizedValues[i] = toInt8(src[i] * layer.inputScale);
+		kernels.gemvInt8(weights.data() + layer.weightOffset, layer.stride, layer.count, quantizedValues, layer.srcCount, sums);
+		for (unsigned int r = 0; r < layer.count; r++) {
+			unsigned int neuron = layer.first + r;
+			values[neuron] = (fann_type)sums[r] * outputScales[neuron] + biasSums[neuron];
+		}
+		for (size_t s = layer.segmentFirst; s < layer.segmentFirst + layer.segmentCount; s++) {
+			const CompiledNet::ActivationSegment &segment = activationSegments[s];
+			kernels.activate(segment.activationFunction, fastActivations, &steepnesses[segment.first], values + segment.first, segment.count);
+		}
+	}
+	return values + outputFirst;
+}
+
+void QuantizedNet::runBatch(const fann_type *inputs, unsigned int numRuns, fann_type *outputs, Scratch &scratch) const {
+	for (unsigned int i = 0; i < numRuns; i++) {
+		const fann_type *result = run(inputs + (size_t)i * numInput, scratch);
+		std::copy(result, result + numOutput, outputs + (size_t)i * numOutput);
+	}
+}
+
+QuantizedNet::Report QuantizedNet::compare(const CompiledNet &reference, const fann_type *const *inputs, const fann_type *const *desiredOutputs, unsigned int count) const {
+	Report report;
+	report.numSamples = count;
+	report.floatWeightBytes = 0;
+	for (size_t l = 0; l < reference.layers.size(); l++) {
+		const CompiledNet::Layer &layer = reference.layers[l];
+		if (layer.sparse) {
+			size_t nonzero = reference.sparseRowStarts[layer.sparseRowFirst + layer.count] - reference.sparseRowStarts[layer.sparseRowFirst];
+			report.floatWeightBytes += nonzero * (sizeof(fann_type) + sizeof(uint32_t));
+		} else {
+			report.floatWeightBytes += (size_t)layer.count * layer.srcCount * sizeof(fann_type);
+		}
+	}
+	report.quantizedWeightBytes = getWeightBytes();
+	report.maxError = 0;
+	report.meanError = 0;
+	report.floatMse = 0;
+	report.quantizedMse = 0;
+	report.argmaxAgreement = 0;
+	if (count == 0 || numOutput == 0) return report;
+
+	CompiledNet::Scratch referenceScratch;
+	Scratch scratch;
+	unsigned int agreements = 0;
+	for (unsigned int sample = 0; sample < count; sample++) {
+		const fann_type *expected = reference.run(inputs[sample], referenceScratch);
+		const fann_type *actual = run(inputs[sample], scratch);
+		const fann_type *desired = desiredOutputs[sample];
+		unsigned int expectedMax = 0;
+		unsigned int actualMax = 0;
+		for (unsigned int o = 0; o < numOutput; o++) {
+			double error = std::fabs((double)actual[o] - (double)expected[o]);
+			report.maxError = std::max(report.maxError, error);
+			report.meanError += error;
+			report.floatMse += ((double)desired[o] - expected[o]) * ((double)desired[o] - expected[o]);
+			report.quantizedMse += ((double)desired[o] - actual[o]) * ((double)desired[o] - actual[o]);
+			if (expected[o] > expected[expectedMax]) expectedMax = o;
+			if (actual[o] > actual[actualMax]) actualMax = o;
+		}
+		if (expectedMax == actualMax) agreements++;
+	}
+	double numValues = (double)count * numOutput;
+	report.meanError /= numValues;
+	report.floatMse /= numValues;
+	report.quantizedMse /= numValues;
+	report.argmaxAgreement = (double)agreements / count;
+	return report;
+}
+
+}
+
+#endif
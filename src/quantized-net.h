@@ -0,0 +1,106 @@
+#ifndef FANNY_QUANTIZED_NET_H
+#define FANNY_QUANTIZED_NET_H
+
+#include "fann-includes.h"
+#include "compiled-net.h"
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#ifndef FANNY_FIXED
+
+namespace fanny {
+
+// An int8 copy of a CompiledNet.  Each neuron's weights are scaled to [-127, 127] by their largest
+// magnitude, and each layer's source values by the largest magnitude seen while running a set of
+// calibration inputs through the float network.  Sums are accumulated in int32 and scaled back to
+// floating point before activation.  Bias weights are kept in floating point, since the bias value
+// is known exactly.  Like CompiledNet, a QuantizedNet never changes after it is built.
+class QuantizedNet {
+public:
+	// Per-thread working memory for running a QuantizedNet
+	class Scratch {
+	public:
+		Scratch() : netId(0) {}
+	private:
+		friend class QuantizedNet;
+		unsigned long netId;
+		AlignedBuffer<fann_type> values;
+		AlignedBuffer<int8_t> quantizedValues;
+		AlignedBuffer<int32_t> sums;
+	};
+
+	// Accuracy of a QuantizedNet against the network it was built from
+	struct Report {
+		unsigned int numSamples;
+		size_t floatWeightBytes;
+		size_t quantizedWeightBytes;
+		// Absolute difference between quantized and float outputs
+		double maxError;
+		double meanError;
+		// Mean squared error of each network against the desired outputs
+		double floatMse;
+		double quantizedMse;
+		// Fraction of samples where both networks' largest output is the same neuron
+		double argmaxAgreement;
+	};
+
+	// Quantizes a compiled network, calibrating source value ranges with numInputs sets of inputs
+	static std::shared_ptr<QuantizedNet> quantize(const CompiledNet &net, const fann_type *const *inputs, unsigned int numInputs);
+
+	// Runs the network on one set of inputs.  Returns a pointer to the outputs, which stays valid
+	// until scratch is used again.  Inputs outside the calibrated range are clamped to it.
+	const fann_type *run(const fann_type *input, Scratch &scratch) const;
+
+	// Runs numRuns sets of inputs stored back-to-back, writing outputs back-to-back
+	void runBatch(const fann_type *inputs, unsigned int numRuns, fann_type *outputs, Scratch &scratch) const;
+
+	// Compares this network's outputs with those of reference, which it should have been built from
+	Report compare(const CompiledNet &reference, const fann_type *const *inputs, const fann_type *const *desiredOutputs, unsigned int count) const;
+
+	unsigned int getNumInput() const { return numInput; }
+	unsigned int getNumOutput() const { return numOutput; }
+
+private:
+	struct Layer {
+		unsigned int first;
+		unsigned int count;
+		unsigned int srcFirst;
+		unsigned int srcCount;
+		// Distance in bytes between the starts of rows
+		size_t stride;
+		size_t weightOffset;
+		// Multiplier converting source values to int8
+		fann_type inputScale;
+		size_t segmentFirst;
+		size_t segmentCount;
+	};
+
+	QuantizedNet();
+	void prepareScratch(Scratch &scratch) const;
+	size_t getWeightBytes() const;
+
+	unsigned long id;
+	unsigned int numInput;
+	unsigned int numOutput;
+	unsigned int totalNeurons;
+	unsigned int outputFirst;
+	size_t maxStride;
+	unsigned int maxLayerCount;
+	std::vector<Layer> layers;
+	AlignedBuffer<int8_t> weights;
+	// Per neuron, indexed by neuron: multiplier converting its int32 sum back to floating point,
+	// and the sum of its bias weights
+	std::vector<fann_type> outputScales;
+	std::vector<fann_type> biasSums;
+	std::vector<unsigned int> biasNeurons;
+	std::vector<fann_type> steepnesses;
+	std::vector<CompiledNet::ActivationSegment> activationSegments;
+	bool fastActivations;
+};
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,243 @@
+#include "shared-net.h"
+#include "fann-access.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace fanny {
+
+static const uint32_t SHARED_NET_MAGIC = 0x53594e46; // "FNYS"
+static const uint32_t SHARED_NET_VERSION = 1;
+// Weights start on a cache line
+static const size_t SHARED_NET_WEIGHT_ALIGNMENT = 64;
+
+#if defined(FANNY_FLOAT)
+static const uint32_t SHARED_NET_DATATYPE = 1;
+#elif defined(FANNY_DOUBLE)
+static const uint32_t SHARED_NET_DATATYPE = 2;
+#else
+static const uint32_t SHARED_NET_DATATYPE = 3;
+#endif
+
+// Start of an exported buffer.  Offsets are from the start of the buffer.
+struct SharedNetHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t datatype;
+	uint32_t networkType;
+	float connectionRate;
+	uint32_t numLayers;
+	uint32_t totalNeurons;
+	uint32_t totalConnections;
+	// Fixed point settings; zero in other builds
+	uint32_t decimalPoint;
+	uint32_t multiplier;
+	uint64_t layersOffset;
+	uint64_t neuronsOffset;
+	uint64_t connectionsOffset;
+	uint64_t weightsOffset;
+	uint64_t size;
+	fann_type sigmoidResults[6];
+	fann_type sigmoidValues[6];
+	fann_type sigmoidSymmetricResults[6];
+	fann_type sigmoidSymmetricValues[6];
+};
+
+struct SharedNetNeuron {
+	uint32_t firstCon;
+	uint32_t lastCon;
+	uint32_t activationFunction;
+	fann_type steepness;
+};
+
+static size_t alignUp(size_t offset, size_t alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Fills in the counts and offsets of the header for the network
+static void layoutHeader(struct fann *ann, SharedNetHeader &header) {
+	memset(&header, 0, sizeof(header));
+	header.magic = SHARED_NET_MAGIC;
+	header.version = SHARED_NET_VERSION;
+	header.datatype = SHARED_NET_DATATYPE;
+	header.networkType = (uint32_t)ann->network_type;
+	header.connectionRate = ann->connection_rate;
+	header.numLayers = (uint32_t)(ann->last_layer - ann->first_layer);
+	header.totalNeurons = ann->total_neurons;
+	header.totalConnections = ann->total_connections;
+	size_t offset = sizeof(SharedNetHeader);
+	header.layersOffset = offset;
+	offset = alignUp(offset + header.numLayers * sizeof(uint32_t), 8);
+	header.neuronsOffset = offset;
+	offset = alignUp(offset + header.totalNeurons * sizeof(SharedNetNeuron), 8);
+	// Fully connected networks' connections follow from their layer sizes
+	header.connectionsOffset = offset;
+	if (ann->connection_rate < 1) offset += header.totalConnections * sizeof(uint32_t);
+	header.weightsOffset = alignUp(offset, SHARED_NET_WEIGHT_ALIGNMENT);
+	header.size = header.weightsOffset + header.totalConnections * sizeof(fann_type);
+}
+
+size_t SharedNet::getExportSize(FANN::neural_net *net) {
+	SharedNetHeader header;
+	layoutHeader(getFannStruct(net), header);
+	return header.size;
+}
+
+void SharedNet::exportTo(FANN::neural_net *net, uint8_t *buffer) {
+	struct fann *ann = getFannStruct(net);
+	struct fann_neuron *firstNeuron = ann->first_layer->first_neuron;
+	SharedNetHeader header;
+	layoutHeader(ann, header);
+	#ifdef FANNY_FIXED
+	header.decimalPoint = ann->decimal_point;
+	header.multiplier = ann->multiplier;
+	memcpy(header.sigmoidResults, ann->sigmoid_results, sizeof(header.sigmoidResults));
+	memcpy(header.sigmoidValues, ann->sigmoid_values, sizeof(header.sigmoidValues));
+	memcpy(header.sigmoidSymmetricResults, ann->sigmoid_symmetric_results, sizeof(header.sigmoidSymmetricResults));
+	memcpy(header.sigmoidSymmetricValues, ann->sigmoid_symmetric_values, sizeof(header.sigmoidSymmetricValues));
+	#endif
+	memset(buffer, 0, header.size);
+	memcpy(buffer, &header, sizeof(header));
+
+	uint32_t *layers = (uint32_t *)(buffer + header.layersOffset);
+	for (uint32_t l = 0; l < header.numLayers; l++) {
+		layers[l] = (uint32_t)(ann->first_layer[l].last_neuron - ann->first_layer[l].first_neuron);
+	}
+	SharedNetNeuron *neurons = (SharedNetNeuron *)(buffer + header.neuronsOffset);
+	for (uint32_t i = 0; i < header.totalNeurons; i++) {
+		neurons[i].firstCon = firstNeuron[i].first_con;
+		neurons[i].lastCon = firstNeuron[i].last_con;
+		neurons[i].activationFunction = (uint32_t)firstNeuron[i].activation_function;
+		neurons[i].steepness = firstNeuron[i].activation_steepness;
+	}
+	if (ann->connection_rate < 1) {
+		uint32_t *connections = (uint32_t *)(buffer + header.connectionsOffset);
+		for (uint32_t c = 0; c < header.totalConnections; c++) {
+			connections[c] = (uint32_t)(ann->connections[c] - firstNeuron);
+		}
+	}
+	memcpy(buffer + header.weightsOffset, ann->weights, header.totalConnections * sizeof(fann_type));
+}
+
+FANN::neural_net *SharedNet::attach(uint8_t *buffer, size_t length, std::string &error) {
+	if (length < sizeof(SharedNetHeader)) {
+		error = "Buffer does not contain an exported network";
+		return NULL;
+	}
+	SharedNetHeader header;
+	memcpy(&header, buffer, sizeof(header));
+	if (header.magic != SHARED_NET_MAGIC || header.version != SHARED_NET_VERSION || header.size > length) {
+		error = "Buffer does not contain an exported network";
+		return NULL;
+	}
+	if (header.datatype != SHARED_NET_DATATYPE) {
+		error = "Exported network has a different datatype";
+		return NULL;
+	}
+	if (header.numLayers < 2 || (size_t)buffer % 8 != 0) {
+		error = "Invalid exported network";
+		return NULL;
+	}
+	// The rest of the layout is checked against the network made from the layer sizes below
+	if (header.layersOffset % sizeof(uint32_t) != 0 || header.layersOffset > length ||
+		header.numLayers > (length - header.layersOffset) / sizeof(uint32_t)
+	) {
+		error = "Invalid exported network";
+		return NULL;
+	}
+
+	// Create a network of the same layout.  FANN counts bias neurons in layer sizes but doesn't
+	// take them in the sizes given to it.
+	const uint32_t *layerSizes = (const uint32_t *)(buffer + header.layersOffset);
+	std::vector<unsigned int> sizes;
+	uint64_t totalNeurons = 0;
+	for (uint32_t l = 0; l < header.numLayers; l++) {
+		bool hasBias = (header.networkType == FANN_NETTYPE_LAYER || l == 0);
+		if (layerSizes[l] < (hasBias ? 2u : 1u)) {
+			error = "Invalid exported network";
+			return NULL;
+		}
+		sizes.push_back(layerSizes[l] - (hasBias ? 1 : 0));
+		totalNeurons += layerSizes[l];
+	}
+	// Keeps a corrupt buffer from making FANN allocate a network far larger than the buffer
+	if (totalNeurons != header.totalNeurons || totalNeurons > length / sizeof(SharedNetNeuron)) {
+		error = "Invalid exported network";
+		return NULL;
+	}
+	FANN::neural_net *net;
+	if (header.networkType == FANN_NETTYPE_SHORTCUT) {
+		net = new FANN::neural_net(FANN::network_type_enum::SHORTCUT, header.numLayers, &sizes[0]);
+	} else if (header.connectionRate < 1) {
+		net = new FANN::neural_net(header.connectionRate, header.numLayers, &sizes[0]);
+	} else {
+		net = new FANN::neural_net(FANN::network_type_enum::LAYER, header.numLayers, &sizes[0]);
+	}
+
+	// The connections FANN made must line up with the exported weights.  Sparse networks pick
+	// their connections at random, so only their counts per neuron are expected to match.
+	// Laying out the new network also gives the offsets and size the buffer must have, so nothing
+	// past here is read outside of it.
+	struct fann *ann = getFannStruct(net);
+	bool matches = ann && ann->total_neurons == header.totalNeurons && ann->total_connections == header.totalConnections;
+	if (matches) {
+		SharedNetHeader expected;
+		layoutHeader(ann, expected);
+		if (expected.numLayers != header.numLayers || expected.layersOffset != header.layersOffset ||
+			expected.neuronsOffset != header.neuronsOffset || expected.connectionsOffset != header.connectionsOffset ||
+			expected.weightsOffset != header.weightsOffset || expected.size != header.size
+		) {
+			delete net;
+			error = "Invalid exported network";
+			return NULL;
+		}
+	}
+	const SharedNetNeuron *neurons = (const SharedNetNeuron *)(buffer + header.neuronsOffset);
+	struct fann_neuron *firstNeuron = matches ? ann->first_layer->first_neuron : NULL;
+	for (uint32_t i = 0; matches && i < header.totalNeurons; i++) {
+		if (firstNeuron[i].first_con != neurons[i].firstCon || firstNeuron[i].last_con != neurons[i].lastCon) {
+			matches = false;
+		}
+	}
+	if (!matches) {
+		delete net;
+		error = "Network layout of exported network is not supported";
+		return NULL;
+	}
+	for (uint32_t i = 0; i < header.totalNeurons; i++) {
+		firstNeuron[i].activation_function = (enum fann_activationfunc_enum)neurons[i].activationFunction;
+		firstNeuron[i].activation_steepness = neurons[i].steepness;
+	}
+	if (header.connectionRate < 1) {
+		const uint32_t *connections = (const uint32_t *)(buffer + header.connectionsOffset);
+		for (uint32_t c = 0; c < header.totalConnections; c++) {
+			if (connections[c] >= header.totalNeurons) {
+				delete net;
+				error = "Invalid exported network";
+				return NULL;
+			}
+			ann->connections[c] = firstNeuron + connections[c];
+		}
+	}
+	#ifdef FANNY_FIXED
+	ann->decimal_point = header.decimalPoint;
+	ann->multiplier = header.multiplier;
+	memcpy(ann->sigmoid_results, header.sigmoidResults, sizeof(header.sigmoidResults));
+	memcpy(ann->sigmoid_values, header.sigmoidValues, sizeof(header.sigmoidValues));
+	memcpy(ann->sigmoid_symmetric_results, header.sigmoidSymmetricResults, sizeof(header.sigmoidSymmetricResults));
+	memcpy(ann->sigmoid_symmetric_values, header.sigmoidSymmetricValues, sizeof(header.sigmoidSymmetricValues));
+	#endif
+
+	free(ann->weights);
+	ann->weights = (fann_type *)(buffer + header.weightsOffset);
+	return net;
+}
+
+void SharedNet::destroy(FANN::neural_net *net) {
+	// Keeps ~neural_net() from freeing the buffer's weights
+	struct fann *ann = getFannStruct(net);
+	if (ann) ann->weights = NULL;
+	delete net;
+}
+
+}
@@ -0,0 +1,32 @@
+#ifndef FANNY_SHARED_NET_H
+#define FANNY_SHARED_NET_H
+
+#include "fann-includes.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace fanny {
+
+// Exports a network into a flat buffer, such as a SharedArrayBuffer, and attaches networks to
+// buffers exported that way.  An attached network is an ordinary FANN network whose weights are
+// read in place from the buffer, so any number of worker threads can run one model while it's kept
+// in memory only once.  The buffer must stay alive and unchanged while networks are attached to it,
+// and attached networks must not change their weights.
+class SharedNet {
+public:
+	// Number of bytes exportTo() writes for the network
+	static size_t getExportSize(FANN::neural_net *net);
+	// Writes the network's layout and weights to buffer, which must hold getExportSize() bytes and
+	// be aligned to 8 bytes
+	static void exportTo(FANN::neural_net *net, uint8_t *buffer);
+	// Creates a network using the weights in buffer.  Returns NULL and sets error if the buffer
+	// wasn't written by exportTo() in a build with the same datatype.
+	static FANN::neural_net *attach(uint8_t *buffer, size_t length, std::string &error);
+	// Deletes a network returned by attach(), leaving the buffer alone
+	static void destroy(FANN::neural_net *net);
+};
+
+}
+
+#endif
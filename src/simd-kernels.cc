@@ -0,0 +1,928 @@
+#include "simd-kernels.h"
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <cmath>
+
+// fann_activation_switch() uses this helper from FANN's internal header
+#ifndef fann_abs
+#define fann_abs(value) (((value) > 0) ? (value) : -(value))
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FANNY_SIMD_X86
+#include <immintrin.h>
+#define FANNY_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace fanny {
+namespace simd {
+
+// Scalar kernels.  These are also used for the tail ends of the vectorized kernels.
+
+#ifdef FANNY_FIXED
+
+// Multiplies two fixed point values the way FANN's fann_mult() does, with 32-bit wraparound
+static inline fann_type fixedMult(fann_type a, fann_type b, unsigned int decimalPoint) {
+	return ((fann_type)((uint32_t)a * (uint32_t)b)) >> decimalPoint;
+}
+
+// Adds a product to a sum, wrapping around like FANN's int arithmetic
+static inline fann_type mulAddScalar(fann_type w, fann_type x, fann_type sum, unsigned int decimalPoint) {
+	return (fann_type)((uint32_t)sum + (uint32_t)fixedMult(w, x, decimalPoint));
+}
+
+static inline fann_type dotScalar(const fann_type *w, const fann_type *x, unsigned int start, unsigned int n, unsigned int decimalPoint) {
+	uint32_t sum = 0;
+	for (unsigned int i = start; i < n; i++) sum += (uint32_t)fixedMult(w[i], x[i], decimalPoint);
+	return (fann_type)sum;
+}
+
+static inline fann_type sparseDotScalar(const uint32_t *columns, const fann_type *weights, const fann_type *x, uint32_t start, uint32_t end, unsigned int decimalPoint) {
+	uint32_t sum = 0;
+	for (uint32_t k = start; k < end; k++) sum += (uint32_t)fixedMult(weights[k], x[columns[k]], decimalPoint);
+	return (fann_type)sum;
+}
+
+#else
+
+static inline fann_type mulAddScalar(fann_type w, fann_type x, fann_type sum, unsigned int decimalPoint) {
+	return sum + w * x;
+}
+
+static inline fann_type dotScalar(const fann_type *w, const fann_type *x, unsigned int start, unsigned int n, unsigned int decimalPoint) {
+	fann_type sum = 0;
+	for (unsigned int i = start; i < n; i++) sum += w[i] * x[i];
+	return sum;
+}
+
+static inline fann_type sparseDotScalar(const uint32_t *columns, const fann_type *weights, const fann_type *x, uint32_t start, uint32_t end, unsigned int decimalPoint) {
+	fann_type sum = 0;
+	for (uint32_t k = start; k < end; k++) sum += weights[k] * x[columns[k]];
+	return sum;
+}
+
+#endif
+
+static void gemvScalar(const fann_type *w, size_t stride, unsigned int rows, const fann_type *x, unsigned int n, fann_type *y, unsigned int decimalPoint) {
+	for (unsigned int r = 0; r < rows; r++) {
+		y[r] = dotScalar(w + r * stride, x, 0, n, decimalPoint);
+	}
+}
+
+// Number of weight rows multiplied against the whole batch at a time, sized so those rows stay in
+// L2 cache.  Always a multiple of 4.
+static unsigned int gemmRowBlock(size_t stride) {
+	const size_t cacheBytes = 128 * 1024;
+	size_t rows = cacheBytes / (stride * sizeof(fann_type) + 1);
+	if (rows < 4) rows = 4;
+	if (rows > 1024) rows = 1024;
+	return (unsigned int)(rows - rows % 4);
+}
+
+static void gemmScalar(const fann_type *w, size_t wStride, unsigned int rows, const fann_type *x, size_t xStride, unsigned int n, unsigned int count, fann_type *y, size_t yStride, unsigned int decimalPoint) {
+	unsigned int rowBlock = gemmRowBlock(wStride);
+	for (unsigned int rb = 0; rb < rows; rb += rowBlock) {
+		unsigned int blockRows = (rows - rb < rowBlock) ? rows - rb : rowBlock;
+		for (unsigned int s = 0; s < count; s++) {
+			gemvScalar(w + rb * wStride, wStride, blockRows, x + s * xStride, n, y + s * yStride + rb, decimalPoint);
+		}
+	}
+}
+
+static void spmvScalar(const uint32_t *rowStarts, const uint32_t *columns, const fann_type *weights, unsigned int rows, const fann_type *x, fann_type *y, unsigned int decimalPoint) {
+	for (unsigned int r = 0; r < rows; r++) {
+		y[r] = sparseDotScalar(columns, weights, x, rowStarts[r], rowStarts[r + 1], decimalPoint);
+	}
+}
+
+static void axpyScalar(const fann_type *w, fann_type a, unsigned int n, fann_type *y, unsigned int decimalPoint) {
+	for (unsigned int i = 0; i < n; i++) y[i] = mulAddScalar(w[i], a, y[i], decimalPoint);
+}
+
+// Sum of w[i] * x[i] for i in [first, n), for the ends of rows too short for a vector
+static inline int32_t dotInt8Scalar(const int8_t *w, const int8_t *x, unsigned int first, unsigned int n) {
+	int32_t sum = 0;
+	for (unsigned int i = first; i < n; i++) sum += (int32_t)w[i] * x[i];
+	return sum;
+}
+
+static void gemvInt8Scalar(const int8_t *w, size_t stride, unsigned int rows, const int8_t *x, unsigned int n, int32_t *y) {
+	for (unsigned int r = 0; r < rows; r++) y[r] = dotInt8Scalar(w + r * stride, x, 0, n);
+}
+
+#ifndef FANNY_FIXED
+
+// Applies an activation function to sums that already have steepness applied and are clamped
+static void applyActivationScalar(enum fann_activationfunc_enum fn, fann_type *values, unsigned int count) {
+	for (unsigned int i = 0; i < count; i++) {
+		fann_type sum = values[i];
+		fann_type value = 0;
+		fann_activation_switch(fn, sum, value);
+		values[i] = value;
+	}
+}
+
+static void activateScalar(enum fann_activationfunc_enum fn, bool fast, const fann_type *steepness, fann_type *values, unsigned int count) {
+	for (unsigned int i = 0; i < count; i++) {
+		fann_type sum = steepness[i] * values[i];
+		fann_type maxSum = 150 / steepness[i];
+		if (sum > maxSum) {
+			sum = maxSum;
+		} else if (sum < -maxSum) {
+			sum = -maxSum;
+		}
+		values[i] = sum;
+	}
+	applyActivationScalar(fn, values, count);
+}
+
+#endif
+
+#if defined FANNY_SIMD_X86 && !defined FANNY_FIXED
+
+// Whether the vector kernels evaluate an activation function themselves.  The functions built on
+// exp(), sin() and cos() are only vectorized in fast mode; in exact mode they use the C library.
+static bool isVectorActivation(enum fann_activationfunc_enum fn, bool fast) {
+	switch (fn) {
+		case FANN_LINEAR:
+		case FANN_LINEAR_PIECE:
+		case FANN_LINEAR_PIECE_SYMMETRIC:
+		case FANN_THRESHOLD:
+		case FANN_THRESHOLD_SYMMETRIC:
+		case FANN_ELLIOT:
+		case FANN_ELLIOT_SYMMETRIC:
+			return true;
+		case FANN_SIGMOID:
+		case FANN_SIGMOID_SYMMETRIC:
+		case FANN_SIGMOID_STEPWISE:
+		case FANN_SIGMOID_SYMMETRIC_STEPWISE:
+		case FANN_GAUSSIAN:
+		case FANN_GAUSSIAN_SYMMETRIC:
+		case FANN_SIN:
+		case FANN_COS:
+		case FANN_SIN_SYMMETRIC:
+		case FANN_COS_SYMMETRIC:
+			return fast;
+		default:
+			return false;
+	}
+}
+
+#endif
+
+#ifdef FANNY_SIMD_X86
+
+// Each instruction set gets a small set of vector helpers for fann_type, so the kernel bodies below
+// are shared between the addons.  MulAdd's last argument is the fixed point decimal point, which
+// float and double ignore.  Fixed point only needs the helpers used by the matrix kernels.
+
+#if defined FANNY_DOUBLE
+
+typedef __m128d Sse2Vec;
+static const unsigned int sse2Width = 2;
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Zero() { return _mm_setzero_pd(); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Load(const double *p) { return _mm_loadu_pd(p); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2MulAdd(Sse2Vec a, Sse2Vec b, Sse2Vec c, unsigned int) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+FANNY_TARGET("sse2") static inline double sse2Sum(Sse2Vec v) {
+	return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+typedef __m128d Sse2Mask;
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Set1(double a) { return _mm_set1_pd(a); }
+FANNY_TARGET("sse2") static inline void sse2Store(double *p, Sse2Vec v) { _mm_storeu_pd(p, v); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Add(Sse2Vec a, Sse2Vec b) { return _mm_add_pd(a, b); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Sub(Sse2Vec a, Sse2Vec b) { return _mm_sub_pd(a, b); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Mul(Sse2Vec a, Sse2Vec b) { return _mm_mul_pd(a, b); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Div(Sse2Vec a, Sse2Vec b) { return _mm_div_pd(a, b); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Abs(Sse2Vec a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+FANNY_TARGET("sse2") static inline Sse2Mask sse2Less(Sse2Vec a, Sse2Vec b) { return _mm_cmplt_pd(a, b); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Select(Sse2Mask m, Sse2Vec a, Sse2Vec b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+// 2^n for integer-valued n in [-1022, 1023], built directly from the exponent bits
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Pow2(Sse2Vec n) {
+	__m128i bits = _mm_castpd_si128(_mm_add_pd(n, _mm_set1_pd(6755399441055744.0 + 1023)));
+	return _mm_castsi128_pd(_mm_slli_epi64(bits, 52));
+}
+
+typedef __m256d Avx2Vec;
+static const unsigned int avx2Width = 4;
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Zero() { return _mm256_setzero_pd(); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Load(const double *p) { return _mm256_loadu_pd(p); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Gather(const double *x, const uint32_t *indices) {
+	return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, _mm_loadu_si128((const __m128i *)indices), _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+}
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2MulAdd(Avx2Vec a, Avx2Vec b, Avx2Vec c, unsigned int) { return _mm256_fmadd_pd(a, b, c); }
+FANNY_TARGET("avx2,fma") static inline double avx2Sum(Avx2Vec v) {
+	__m128d lo = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+	return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+typedef __m256d Avx2Mask;
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Set1(double a) { return _mm256_set1_pd(a); }
+FANNY_TARGET("avx2,fma") static inline void avx2Store(double *p, Avx2Vec v) { _mm256_storeu_pd(p, v); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Add(Avx2Vec a, Avx2Vec b) { return _mm256_add_pd(a, b); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Sub(Avx2Vec a, Avx2Vec b) { return _mm256_sub_pd(a, b); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Mul(Avx2Vec a, Avx2Vec b) { return _mm256_mul_pd(a, b); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Div(Avx2Vec a, Avx2Vec b) { return _mm256_div_pd(a, b); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Abs(Avx2Vec a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+FANNY_TARGET("avx2,fma") static inline Avx2Mask avx2Less(Avx2Vec a, Avx2Vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Select(Avx2Mask m, Avx2Vec a, Avx2Vec b) { return _mm256_blendv_pd(b, a, m); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Pow2(Avx2Vec n) {
+	__m256i bits = _mm256_castpd_si256(_mm256_add_pd(n, _mm256_set1_pd(6755399441055744.0 + 1023)));
+	return _mm256_castsi256_pd(_mm256_slli_epi64(bits, 52));
+}
+
+typedef __m512d Avx512Vec;
+static const unsigned int avx512Width = 8;
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Zero() { return _mm512_setzero_pd(); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Load(const double *p) { return _mm512_loadu_pd(p); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Gather(const double *x, const uint32_t *indices) {
+	return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), (__mmask8)0xff, _mm256_loadu_si256((const __m256i *)indices), x, 8);
+}
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512MulAdd(Avx512Vec a, Avx512Vec b, Avx512Vec c, unsigned int) { return _mm512_fmadd_pd(a, b, c); }
+FANNY_TARGET("avx512f,avx2,fma") static inline double avx512Sum(Avx512Vec v) {
+	double halves[8];
+	_mm512_storeu_pd(halves, v);
+	return avx2Sum(_mm256_add_pd(_mm256_loadu_pd(halves), _mm256_loadu_pd(halves + 4)));
+}
+typedef __mmask8 Avx512Mask;
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Set1(double a) { return _mm512_set1_pd(a); }
+FANNY_TARGET("avx512f,avx2,fma") static inline void avx512Store(double *p, Avx512Vec v) { _mm512_storeu_pd(p, v); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Add(Avx512Vec a, Avx512Vec b) { return _mm512_add_pd(a, b); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Sub(Avx512Vec a, Avx512Vec b) { return _mm512_sub_pd(a, b); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Mul(Avx512Vec a, Avx512Vec b) { return _mm512_mul_pd(a, b); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Div(Avx512Vec a, Avx512Vec b) { return _mm512_div_pd(a, b); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Abs(Avx512Vec a) { return _mm512_abs_pd(a); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Mask avx512Less(Avx512Vec a, Avx512Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Select(Avx512Mask m, Avx512Vec a, Avx512Vec b) { return _mm512_mask_blend_pd(m, b, a); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Pow2(Avx512Vec n) {
+	__m512i bits = _mm512_castpd_si512(_mm512_add_pd(n, _mm512_set1_pd(6755399441055744.0 + 1023)));
+	return _mm512_castsi512_pd(_mm512_maskz_slli_epi64((__mmask8)0xff, bits, 52));
+}
+
+// Rounding to an integer is done by adding and subtracting this, which is exact for |x| < 2^51
+static const double roundMagic = 6755399441055744.0;
+// Range the fast exp() approximation is evaluated over; results outside it are 0 or too large
+// to matter for any activation function
+static const double expMin = -708;
+static const double expMax = 708;
+
+#elif defined FANNY_FIXED
+
+// Products are computed in 32-bit lanes and shifted before summing, exactly as FANN's fann_mult()
+// does, so results match FANN bit for bit.  Pairing 16-bit products with pmaddwd would be faster,
+// but sums before the shift round differently.
+
+// SSE2 has no 32-bit multiply; take the low halves of the even and odd 64-bit products instead
+FANNY_TARGET("sse2") static inline __m128i sse2MulLo32(__m128i a, __m128i b) {
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+typedef __m128i Sse2Vec;
+static const unsigned int sse2Width = 4;
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Zero() { return _mm_setzero_si128(); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Load(const int *p) { return _mm_loadu_si128((const __m128i *)p); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2MulAdd(Sse2Vec a, Sse2Vec b, Sse2Vec c, unsigned int decimalPoint) {
+	return _mm_add_epi32(c, _mm_sra_epi32(sse2MulLo32(a, b), _mm_cvtsi32_si128((int)decimalPoint)));
+}
+FANNY_TARGET("sse2") static inline int sse2Sum(Sse2Vec v) {
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(v);
+}
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Set1(int a) { return _mm_set1_epi32(a); }
+FANNY_TARGET("sse2") static inline void sse2Store(int *p, Sse2Vec v) { _mm_storeu_si128((__m128i *)p, v); }
+
+typedef __m256i Avx2Vec;
+static const unsigned int avx2Width = 8;
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Zero() { return _mm256_setzero_si256(); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Load(const int *p) { return _mm256_loadu_si256((const __m256i *)p); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Gather(const int *x, const uint32_t *indices) {
+	return _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), x, _mm256_loadu_si256((const __m256i *)indices), _mm256_set1_epi32(-1), 4);
+}
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2MulAdd(Avx2Vec a, Avx2Vec b, Avx2Vec c, unsigned int decimalPoint) {
+	return _mm256_add_epi32(c, _mm256_sra_epi32(_mm256_mullo_epi32(a, b), _mm_cvtsi32_si128((int)decimalPoint)));
+}
+FANNY_TARGET("avx2,fma") static inline int avx2Sum(Avx2Vec v) {
+	return sse2Sum(_mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Set1(int a) { return _mm256_set1_epi32(a); }
+FANNY_TARGET("avx2,fma") static inline void avx2Store(int *p, Avx2Vec v) { _mm256_storeu_si256((__m256i *)p, v); }
+
+typedef __m512i Avx512Vec;
+static const unsigned int avx512Width = 16;
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Zero() { return _mm512_setzero_si512(); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Load(const int *p) { return _mm512_loadu_si512((const void *)p); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Gather(const int *x, const uint32_t *indices) {
+	return _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), (__mmask16)0xffff, _mm512_loadu_si512((const void *)indices), x, 4);
+}
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512MulAdd(Avx512Vec a, Avx512Vec b, Avx512Vec c, unsigned int decimalPoint) {
+	return _mm512_add_epi32(c, _mm512_maskz_sra_epi32((__mmask16)0xffff, _mm512_mullo_epi32(a, b), _mm_cvtsi32_si128((int)decimalPoint)));
+}
+FANNY_TARGET("avx512f,avx2,fma") static inline int avx512Sum(Avx512Vec v) {
+	int halves[16];
+	_mm512_storeu_si512((void *)halves, v);
+	return avx2Sum(_mm256_add_epi32(_mm256_loadu_si256((const __m256i *)halves), _mm256_loadu_si256((const __m256i *)(halves + 8))));
+}
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Set1(int a) { return _mm512_set1_epi32(a); }
+FANNY_TARGET("avx512f,avx2,fma") static inline void avx512Store(int *p, Avx512Vec v) { _mm512_storeu_si512((void *)p, v); }
+
+#else
+
+typedef __m128 Sse2Vec;
+static const unsigned int sse2Width = 4;
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Zero() { return _mm_setzero_ps(); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Load(const float *p) { return _mm_loadu_ps(p); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2MulAdd(Sse2Vec a, Sse2Vec b, Sse2Vec c, unsigned int) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+FANNY_TARGET("sse2") static inline float sse2Sum(Sse2Vec v) {
+	v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+typedef __m128 Sse2Mask;
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Set1(float a) { return _mm_set1_ps(a); }
+FANNY_TARGET("sse2") static inline void sse2Store(float *p, Sse2Vec v) { _mm_storeu_ps(p, v); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Add(Sse2Vec a, Sse2Vec b) { return _mm_add_ps(a, b); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Sub(Sse2Vec a, Sse2Vec b) { return _mm_sub_ps(a, b); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Mul(Sse2Vec a, Sse2Vec b) { return _mm_mul_ps(a, b); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Div(Sse2Vec a, Sse2Vec b) { return _mm_div_ps(a, b); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Abs(Sse2Vec a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+FANNY_TARGET("sse2") static inline Sse2Mask sse2Less(Sse2Vec a, Sse2Vec b) { return _mm_cmplt_ps(a, b); }
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Select(Sse2Mask m, Sse2Vec a, Sse2Vec b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+// 2^n for integer-valued n in [-126, 127], built directly from the exponent bits
+FANNY_TARGET("sse2") static inline Sse2Vec sse2Pow2(Sse2Vec n) {
+	__m128i bits = _mm_castps_si128(_mm_add_ps(n, _mm_set1_ps(12582912.0f + 127)));
+	return _mm_castsi128_ps(_mm_slli_epi32(bits, 23));
+}
+
+typedef __m256 Avx2Vec;
+static const unsigned int avx2Width = 8;
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Zero() { return _mm256_setzero_ps(); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Load(const float *p) { return _mm256_loadu_ps(p); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Gather(const float *x, const uint32_t *indices) {
+	return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), x, _mm256_loadu_si256((const __m256i *)indices), _mm256_castsi256_ps(_mm256_set1_epi32(-1)), 4);
+}
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2MulAdd(Avx2Vec a, Avx2Vec b, Avx2Vec c, unsigned int) { return _mm256_fmadd_ps(a, b, c); }
+FANNY_TARGET("avx2,fma") static inline float avx2Sum(Avx2Vec v) {
+	__m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+	return _mm_cvtss_f32(_mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1)));
+}
+typedef __m256 Avx2Mask;
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Set1(float a) { return _mm256_set1_ps(a); }
+FANNY_TARGET("avx2,fma") static inline void avx2Store(float *p, Avx2Vec v) { _mm256_storeu_ps(p, v); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Add(Avx2Vec a, Avx2Vec b) { return _mm256_add_ps(a, b); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Sub(Avx2Vec a, Avx2Vec b) { return _mm256_sub_ps(a, b); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Mul(Avx2Vec a, Avx2Vec b) { return _mm256_mul_ps(a, b); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Div(Avx2Vec a, Avx2Vec b) { return _mm256_div_ps(a, b); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Abs(Avx2Vec a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+FANNY_TARGET("avx2,fma") static inline Avx2Mask avx2Less(Avx2Vec a, Avx2Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Select(Avx2Mask m, Avx2Vec a, Avx2Vec b) { return _mm256_blendv_ps(b, a, m); }
+FANNY_TARGET("avx2,fma") static inline Avx2Vec avx2Pow2(Avx2Vec n) {
+	__m256i bits = _mm256_castps_si256(_mm256_add_ps(n, _mm256_set1_ps(12582912.0f + 127)));
+	return _mm256_castsi256_ps(_mm256_slli_epi32(bits, 23));
+}
+
+typedef __m512 Avx512Vec;
+static const unsigned int avx512Width = 16;
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Zero() { return _mm512_setzero_ps(); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Load(const float *p) { return _mm512_loadu_ps(p); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Gather(const float *x, const uint32_t *indices) {
+	return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), (__mmask16)0xffff, _mm512_loadu_si512((const void *)indices), x, 4);
+}
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512MulAdd(Avx512Vec a, Avx512Vec b, Avx512Vec c, unsigned int) { return _mm512_fmadd_ps(a, b, c); }
+FANNY_TARGET("avx512f,avx2,fma") static inline float avx512Sum(Avx512Vec v) {
+	float halves[16];
+	_mm512_storeu_ps(halves, v);
+	return avx2Sum(_mm256_add_ps(_mm256_loadu_ps(halves), _mm256_loadu_ps(halves + 8)));
+}
+typedef __mmask16 Avx512Mask;
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Set1(float a) { return _mm512_set1_ps(a); }
+FANNY_TARGET("avx512f,avx2,fma") static inline void avx512Store(float *p, Avx512Vec v) { _mm512_storeu_ps(p, v); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Add(Avx512Vec a, Avx512Vec b) { return _mm512_add_ps(a, b); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Sub(Avx512Vec a, Avx512Vec b) { return _mm512_sub_ps(a, b); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Mul(Avx512Vec a, Avx512Vec b) { return _mm512_mul_ps(a, b); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Div(Avx512Vec a, Avx512Vec b) { return _mm512_div_ps(a, b); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Abs(Avx512Vec a) { return _mm512_abs_ps(a); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Mask avx512Less(Avx512Vec a, Avx512Vec b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Select(Avx512Mask m, Avx512Vec a, Avx512Vec b) { return _mm512_mask_blend_ps(m, b, a); }
+FANNY_TARGET("avx512f,avx2,fma") static inline Avx512Vec avx512Pow2(Avx512Vec n) {
+	__m512i bits = _mm512_castps_si512(_mm512_add_ps(n, _mm512_set1_ps(12582912.0f + 127)));
+	return _mm512_castsi512_ps(_mm512_maskz_slli_epi32((__mmask16)0xffff, bits, 23));
+}
+
+static const float roundMagic = 12582912.0f;
+static const float expMin = -87.3f;
+static const float expMax = 88.3f;
+
+#endif
+
+// Matrix-vector kernels.  Four rows are processed together so each load of x is reused four
+// times; the remaining rows are done one at a time.  Elements past the last full vector are
+// summed with scalar code.
+#define FANNY_DEFINE_GEMV(NAME, TARGET, VEC, ISA) \
+FANNY_TARGET(TARGET) static void NAME(const fann_type *w, size_t stride, unsigned int rows, const fann_type *x, unsigned int n, fann_type *y, unsigned int decimalPoint) { \
+	const unsigned int width = ISA##Width; \
+	unsigned int vecEnd = n - n % width; \
+	unsigned int r = 0; \
+	for (; r + 4 <= rows; r += 4) { \
+		const fann_type *w0 = w + r * stride; \
+		const fann_type *w1 = w0 + stride; \
+		const fann_type *w2 = w1 + stride; \
+		const fann_type *w3 = w2 + stride; \
+		VEC acc0 = ISA##Zero(), acc1 = ISA##Zero(), acc2 = ISA##Zero(), acc3 = ISA##Zero(); \
+		for (unsigned int i = 0; i < vecEnd; i += width) { \
+			VEC xv = ISA##Load(x + i); \
+			acc0 = ISA##MulAdd(ISA##Load(w0 + i), xv, acc0, decimalPoint); \
+			acc1 = ISA##MulAdd(ISA##Load(w1 + i), xv, acc1, decimalPoint); \
+			acc2 = ISA##MulAdd(ISA##Load(w2 + i), xv, acc2, decimalPoint); \
+			acc3 = ISA##MulAdd(ISA##Load(w3 + i), xv, acc3, decimalPoint); \
+		} \
+		y[r] = ISA##Sum(acc0) + dotScalar(w0, x, vecEnd, n, decimalPoint); \
+		y[r + 1] = ISA##Sum(acc1) + dotScalar(w1, x, vecEnd, n, decimalPoint); \
+		y[r + 2] = ISA##Sum(acc2) + dotScalar(w2, x, vecEnd, n, decimalPoint); \
+		y[r + 3] = ISA##Sum(acc3) + dotScalar(w3, x, vecEnd, n, decimalPoint); \
+	} \
+	for (; r < rows; r++) { \
+		const fann_type *w0 = w + r * stride; \
+		VEC acc0 = ISA##Zero(); \
+		for (unsigned int i = 0; i < vecEnd; i += width) { \
+			acc0 = ISA##MulAdd(ISA##Load(w0 + i), ISA##Load(x + i), acc0, decimalPoint); \
+		} \
+		y[r] = ISA##Sum(acc0) + dotScalar(w0, x, vecEnd, n, decimalPoint); \
+	} \
+}
+
+FANNY_DEFINE_GEMV(gemvSse2, "sse2", Sse2Vec, sse2)
+FANNY_DEFINE_GEMV(gemvAvx2, "avx2,fma", Avx2Vec, avx2)
+FANNY_DEFINE_GEMV(gemvAvx512, "avx512f,avx2,fma", Avx512Vec, avx512)
+
+// Matrix-matrix kernels.  Rows are taken in cache-sized blocks; within a block, each step
+// computes a 4 row x 2 vector tile, so every weight load is used twice and every input load four
+// times.  Each output has its own accumulator, summed in the same order as the GEMV kernel.  A
+// leftover vector is passed to the GEMV kernel.
+#define FANNY_DEFINE_GEMM(NAME, GEMV, TARGET, VEC, ISA) \
+FANNY_TARGET(TARGET) static void NAME(const fann_type *w, size_t wStride, unsigned int rows, const fann_type *x, size_t xStride, unsigned int n, unsigned int count, fann_type *y, size_t yStride, unsigned int decimalPoint) { \
+	const unsigned int width = ISA##Width; \
+	unsigned int vecEnd = n - n % width; \
+	unsigned int rowBlock = gemmRowBlock(wStride); \
+	for (unsigned int rb = 0; rb < rows; rb += rowBlock) { \
+		unsigned int rbEnd = (rows - rb < rowBlock) ? rows : rb + rowBlock; \
+		unsigned int s = 0; \
+		for (; s + 2 <= count; s += 2) { \
+			const fann_type *xa = x + s * xStride; \
+			const fann_type *xb = xa + xStride; \
+			fann_type *ya = y + s * yStride; \
+			fann_type *yb = ya + yStride; \
+			unsigned int r = rb; \
+			for (; r + 4 <= rbEnd; r += 4) { \
+				const fann_type *w0 = w + r * wStride; \
+				const fann_type *w1 = w0 + wStride; \
+				const fann_type *w2 = w1 + wStride; \
+				const fann_type *w3 = w2 + wStride; \
+				VEC a0 = ISA##Zero(), a1 = ISA##Zero(), a2 = ISA##Zero(), a3 = ISA##Zero(); \
+				VEC b0 = ISA##Zero(), b1 = ISA##Zero(), b2 = ISA##Zero(), b3 = ISA##Zero(); \
+				for (unsigned int i = 0; i < vecEnd; i += width) { \
+					VEC xav = ISA##Load(xa + i); \
+					VEC xbv = ISA##Load(xb + i); \
+					VEC wv = ISA##Load(w0 + i); \
+					a0 = ISA##MulAdd(wv, xav, a0, decimalPoint); \
+					b0 = ISA##MulAdd(wv, xbv, b0, decimalPoint); \
+					wv = ISA##Load(w1 + i); \
+					a1 = ISA##MulAdd(wv, xav, a1, decimalPoint); \
+					b1 = ISA##MulAdd(wv, xbv, b1, decimalPoint); \
+					wv = ISA##Load(w2 + i); \
+					a2 = ISA##MulAdd(wv, xav, a2, decimalPoint); \
+					b2 = ISA##MulAdd(wv, xbv, b2, decimalPoint); \
+					wv = ISA##Load(w3 + i); \
+					a3 = ISA##MulAdd(wv, xav, a3, decimalPoint); \
+					b3 = ISA##MulAdd(wv, xbv, b3, decimalPoint); \
+				} \
+				ya[r] = ISA##Sum(a0) + dotScalar(w0, xa, vecEnd, n, decimalPoint); \
+				ya[r + 1] = ISA##Sum(a1) + dotScalar(w1, xa, vecEnd, n, decimalPoint); \
+				ya[r + 2] = ISA##Sum(a2) + dotScalar(w2, xa, vecEnd, n, decimalPoint); \
+				ya[r + 3] = ISA##Sum(a3) + dotScalar(w3, xa, vecEnd, n, decimalPoint); \
+				yb[r] = ISA##Sum(b0) + dotScalar(w0, xb, vecEnd, n, decimalPoint); \
+				yb[r + 1] = ISA##Sum(b1) + dotScalar(w1, xb, vecEnd, n, decimalPoint); \
+				yb[r + 2] = ISA##Sum(b2) + dotScalar(w2, xb, vecEnd, n, decimalPoint); \
+				yb[r + 3] = ISA##Sum(b3) + dotScalar(w3, xb, vecEnd, n, decimalPoint); \
+			} \
+			for (; r < rbEnd; r++) { \
+				const fann_type *w0 = w + r * wStride; \
+				VEC a0 = ISA##Zero(), b0 = ISA##Zero(); \
+				for (unsigned int i = 0; i < vecEnd; i += width) { \
+					VEC wv = ISA##Load(w0 + i); \
+					a0 = ISA##MulAdd(wv, ISA##Load(xa + i), a0, decimalPoint); \
+					b0 = ISA##MulAdd(wv, ISA##Load(xb + i), b0, decimalPoint); \
+				} \
+				ya[r] = ISA##Sum(a0) + dotScalar(w0, xa, vecEnd, n, decimalPoint); \
+				yb[r] = ISA##Sum(b0) + dotScalar(w0, xb, vecEnd, n, decimalPoint); \
+			} \
+		} \
+		if (s < count) { \
+			GEMV(w + rb * wStride, wStride, rbEnd - rb, x + s * xStride, n, y + s * yStride + rb, decimalPoint); \
+		} \
+	} \
+}
+
+FANNY_DEFINE_GEMM(gemmSse2, gemvSse2, "sse2", Sse2Vec, sse2)
+FANNY_DEFINE_GEMM(gemmAvx2, gemvAvx2, "avx2,fma", Avx2Vec, avx2)
+FANNY_DEFINE_GEMM(gemmAvx512, gemvAvx512, "avx512f,avx2,fma", Avx512Vec, avx512)
+
+// Scaled vector additions, used to add each neuron of a triangular block to the block's later
+// neurons
+#define FANNY_DEFINE_AXPY(NAME, TARGET, VEC, ISA) \
+FANNY_TARGET(TARGET) static void NAME(const fann_type *w, fann_type a, unsigned int n, fann_type *y, unsigned int decimalPoint) { \
+	const unsigned int width = ISA##Width; \
+	VEC av = ISA##Set1(a); \
+	unsigned int i = 0; \
+	for (; i + width <= n; i += width) { \
+		ISA##Store(y + i, ISA##MulAdd(ISA##Load(w + i), av, ISA##Load(y + i), decimalPoint)); \
+	} \
+	for (; i < n; i++) y[i] = mulAddScalar(w[i], a, y[i], decimalPoint); \
+}
+
+FANNY_DEFINE_AXPY(axpySse2, "sse2", Sse2Vec, sse2)
+FANNY_DEFINE_AXPY(axpyAvx2, "avx2,fma", Avx2Vec, avx2)
+FANNY_DEFINE_AXPY(axpyAvx512, "avx512f,avx2,fma", Avx512Vec, avx512)
+
+// Sparse matrix-vector kernels.  Each row's sources are gathered a vector at a time; SSE2 has no
+// gather instruction, so it uses the scalar kernel.
+#define FANNY_DEFINE_SPMV(NAME, TARGET, VEC, ISA) \
+FANNY_TARGET(TARGET) static void NAME(const uint32_t *rowStarts, const uint32_t *columns, const fann_type *weights, unsigned int rows, const fann_type *x, fann_type *y, unsigned int decimalPoint) { \
+	const unsigned int width = ISA##Width; \
+	for (unsigned int r = 0; r < rows; r++) { \
+		uint32_t k = rowStarts[r]; \
+		uint32_t end = rowStarts[r + 1]; \
+		VEC acc = ISA##Zero(); \
+		for (; k + width <= end; k += width) { \
+			acc = ISA##MulAdd(ISA##Load(weights + k), ISA##Gather(x, columns + k), acc, decimalPoint); \
+		} \
+		y[r] = ISA##Sum(acc) + sparseDotScalar(columns, weights, x, k, end, decimalPoint); \
+	} \
+}
+
+FANNY_DEFINE_SPMV(spmvAvx2, "avx2,fma", Avx2Vec, avx2)
+FANNY_DEFINE_SPMV(spmvAvx512, "avx512f,avx2,fma", Avx512Vec, avx512)
+
+#endif
+
+#ifdef FANNY_SIMD_X86
+
+// Int8 kernels.  SSE2 sign-extends to 16 bits and uses pmaddwd.  AVX2 and AVX-512 multiply |x| by
+// w with x's sign applied using pmaddubsw, which can't saturate for values in [-127, 127], then
+// widen the pair sums to 32 bits with pmaddwd.  The ends of rows shorter than a vector are summed
+// with scalar code.
+
+FANNY_TARGET("sse2") static inline int32_t sse2SumInt32(__m128i v) {
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(v);
+}
+
+FANNY_TARGET("sse2") static void gemvInt8Sse2(const int8_t *w, size_t stride, unsigned int rows, const int8_t *x, unsigned int n, int32_t *y) {
+	for (unsigned int r = 0; r < rows; r++) {
+		const int8_t *wr = w + r * stride;
+		__m128i acc = _mm_setzero_si128();
+		unsigned int i = 0;
+		for (; i + 16 <= n; i += 16) {
+			__m128i wv = _mm_loadu_si128((const __m128i *)(wr + i));
+			__m128i xv = _mm_loadu_si128((const __m128i *)(x + i));
+			__m128i wLo = _mm_srai_epi16(_mm_unpacklo_epi8(wv, wv), 8);
+			__m128i wHi = _mm_srai_epi16(_mm_unpackhi_epi8(wv, wv), 8);
+			__m128i xLo = _mm_srai_epi16(_mm_unpacklo_epi8(xv, xv), 8);
+			__m128i xHi = _mm_srai_epi16(_mm_unpackhi_epi8(xv, xv), 8);
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(wLo, xLo));
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(wHi, xHi));
+		}
+		y[r] = sse2SumInt32(acc) + dotInt8Scalar(wr, x, i, n);
+	}
+}
+
+FANNY_TARGET("avx2,fma") static inline int32_t avx2SumInt32(__m256i v) {
+	return sse2SumInt32(_mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+
+// Sum of pairs of products w * x as int32, using pmaddubsw on |x| and w with x's sign
+FANNY_TARGET("avx2,fma") static inline __m256i avx2DotInt8(__m256i w, __m256i x, __m256i absX, __m256i ones) {
+	return _mm256_madd_epi16(_mm256_maddubs_epi16(absX, _mm256_sign_epi8(w, x)), ones);
+}
+
+FANNY_TARGET("avx2,fma") static void gemvInt8Avx2(const int8_t *w, size_t stride, unsigned int rows, const int8_t *x, unsigned int n, int32_t *y) {
+	const __m256i ones = _mm256_set1_epi16(1);
+	unsigned int r = 0;
+	for (; r + 4 <= rows; r += 4) {
+		const int8_t *w0 = w + r * stride;
+		const int8_t *w1 = w0 + stride;
+		const int8_t *w2 = w1 + stride;
+		const int8_t *w3 = w2 + stride;
+		__m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256(), acc2 = _mm256_setzero_si256(), acc3 = _mm256_setzero_si256();
+		unsigned int i = 0;
+		for (; i + 32 <= n; i += 32) {
+			__m256i xv = _mm256_loadu_si256((const __m256i *)(x + i));
+			__m256i absX = _mm256_abs_epi8(xv);
+			acc0 = _mm256_add_epi32(acc0, avx2DotInt8(_mm256_loadu_si256((const __m256i *)(w0 + i)), xv, absX, ones));
+			acc1 = _mm256_add_epi32(acc1, avx2DotInt8(_mm256_loadu_si256((const __m256i *)(w1 + i)), xv, absX, ones));
+			acc2 = _mm256_add_epi32(acc2, avx2DotInt8(_mm256_loadu_si256((const __m256i *)(w2 + i)), xv, absX, ones));
+			acc3 = _mm256_add_epi32(acc3, avx2DotInt8(_mm256_loadu_si256((const __m256i *)(w3 + i)), xv, absX, ones));
+		}
+		y[r] = avx2SumInt32(acc0) + dotInt8Scalar(w0, x, i, n);
+		y[r + 1] = avx2SumInt32(acc1) + dotInt8Scalar(w1, x, i, n);
+		y[r + 2] = avx2SumInt32(acc2) + dotInt8Scalar(w2, x, i, n);
+		y[r + 3] = avx2SumInt32(acc3) + dotInt8Scalar(w3, x, i, n);
+	}
+	for (; r < rows; r++) {
+		const int8_t *wr = w + r * stride;
+		__m256i acc = _mm256_setzero_si256();
+		unsigned int i = 0;
+		for (; i + 32 <= n; i += 32) {
+			__m256i xv = _mm256_loadu_si256((const __m256i *)(x + i));
+			acc = _mm256_add_epi32(acc, avx2DotInt8(_mm256_loadu_si256((const __m256i *)(wr + i)), xv, _mm256_abs_epi8(xv), ones));
+		}
+		y[r] = avx2SumInt32(acc) + dotInt8Scalar(wr, x, i, n);
+	}
+}
+
+// AVX-512 has no psignb, so w is negated under a mask of x's sign bits instead
+FANNY_TARGET("avx512f,avx512bw,avx2,fma") static inline __m512i avx512DotInt8(__m512i w, __mmask64 negative, __m512i absX, __m512i ones) {
+	w = _mm512_mask_sub_epi8(w, negative, _mm512_setzero_si512(), w);
+	return _mm512_madd_epi16(_mm512_maddubs_epi16(absX, w), ones);
+}
+
+FANNY_TARGET("avx512f,avx512bw,avx2,fma") static inline int32_t avx512SumInt32(__m512i v) {
+	int32_t halves[16];
+	_mm512_storeu_si512((void *)halves, v);
+	return avx2SumInt32(_mm256_add_epi32(_mm256_loadu_si256((const __m256i *)halves), _mm256_loadu_si256((const __m256i *)(halves + 8))));
+}
+
+FANNY_TARGET("avx512f,avx512bw,avx2,fma") static void gemvInt8Avx512(const int8_t *w, size_t stride, unsigned int rows, const int8_t *x, unsigned int n, int32_t *y) {
+	const __m512i ones = _mm512_set1_epi16(1);
+	unsigned int r = 0;
+	for (; r + 4 <= rows; r += 4) {
+		const int8_t *w0 = w + r * stride;
+		const int8_t *w1 = w0 + stride;
+		const int8_t *w2 = w1 + stride;
+		const int8_t *w3 = w2 + stride;
+		__m512i acc0 = _mm512_setzero_si512(), acc1 = _mm512_setzero_si512(), acc2 = _mm512_setzero_si512(), acc3 = _mm512_setzero_si512();
+		unsigned int i = 0;
+		for (; i + 64 <= n; i += 64) {
+			__m512i xv = _mm512_loadu_si512((const void *)(x + i));
+			__mmask64 negative = _mm512_movepi8_mask(xv);
+			__m512i absX = _mm512_abs_epi8(xv);
+			acc0 = _mm512_add_epi32(acc0, avx512DotInt8(_mm512_loadu_si512((const void *)(w0 + i)), negative, absX, ones));
+			acc1 = _mm512_add_epi32(acc1, avx512DotInt8(_mm512_loadu_si512((const void *)(w1 + i)), negative, absX, ones));
+			acc2 = _mm512_add_epi32(acc2, avx512DotInt8(_mm512_loadu_si512((const void *)(w2 + i)), negative, absX, ones));
+			acc3 = _mm512_add_epi32(acc3, avx512DotInt8(_mm512_loadu_si512((const void *)(w3 + i)), negative, absX, ones));
+		}
+		y[r] = avx512SumInt32(acc0) + dotInt8Scalar(w0, x, i, n);
+		y[r + 1] = avx512SumInt32(acc1) + dotInt8Scalar(w1, x, i, n);
+		y[r + 2] = avx512SumInt32(acc2) + dotInt8Scalar(w2, x, i, n);
+		y[r + 3] = avx512SumInt32(acc3) + dotInt8Scalar(w3, x, i, n);
+	}
+	for (; r < rows; r++) {
+		const int8_t *wr = w + r * stride;
+		__m512i acc = _mm512_setzero_si512();
+		unsigned int i = 0;
+		for (; i + 64 <= n; i += 64) {
+			__m512i xv = _mm512_loadu_si512((const void *)(x + i));
+			acc = _mm512_add_epi32(acc, avx512DotInt8(_mm512_loadu_si512((const void *)(wr + i)), _mm512_movepi8_mask(xv), _mm512_abs_epi8(xv), ones));
+		}
+		y[r] = avx512SumInt32(acc) + dotInt8Scalar(wr, x, i, n);
+	}
+}
+
+#endif
+
+#if defined FANNY_SIMD_X86 && !defined FANNY_FIXED
+
+// Breakpoints of FANN's stepwise sigmoid approximations, from fann_activation_switch()
+static const fann_type sigmoidStepwiseV[6] = { -2.64665246009826660156e+00, -1.47221946716308593750e+00, -5.49306154251098632812e-01, 5.49306154251098632812e-01, 1.47221934795379638672e+00, 2.64665293693542480469e+00 };
+static const fann_type sigmoidStepwiseR[6] = { 4.99999988824129104614e-03, 5.00000007450580596924e-02, 2.50000000000000000000e-01, 7.50000000000000000000e-01, 9.49999988079071044922e-01, 9.95000004768371582031e-01 };
+static const fann_type sigmoidSymmetricStepwiseV[6] = { -2.64665293693542480469e+00, -1.47221934795379638672e+00, -5.49306154251098632812e-01, 5.49306154251098632812e-01, 1.47221934795379638672e+00, 2.64665293693542480469e+00 };
+static const fann_type sigmoidSymmetricStepwiseR[6] = { -9.90000009536743164062e-01, -8.99999976158142089844e-01, -5.00000000000000000000e-01, 5.00000000000000000000e-01, 8.99999976158142089844e-01, 9.90000009536743164062e-01 };
+
+// Vector activation functions.  Clamp() applies steepness and limits the sum exactly as fann_run()
+// does.  Apply() evaluates an activation function with the same operations as FANN's macros,
+// except that in fast mode exp() is replaced by a degree 5 polynomial after reduction by ln 2
+// (as in Cephes' expf), sin() and cos() by a degree 11 polynomial after reduction by pi, and the
+// stepwise sigmoids are computed in fann_type instead of double.
+#define FANNY_DEFINE_ACTIVATION_HELPERS(TARGET, VEC, ISA) \
+FANNY_TARGET(TARGET) static inline VEC ISA##Clamp(VEC sum, VEC steepness) { \
+	VEC maxSum = ISA##Div(ISA##Set1(150), steepness); \
+	VEC minSum = ISA##Sub(ISA##Set1(0), maxSum); \
+	sum = ISA##Mul(steepness, sum); \
+	sum = ISA##Select(ISA##Less(maxSum, sum), maxSum, sum); \
+	return ISA##Select(ISA##Less(sum, minSum), minSum, sum); \
+} \
+FANNY_TARGET(TARGET) static inline VEC ISA##Exp(VEC x) { \
+	x = ISA##Select(ISA##Less(x, ISA##Set1(expMin)), ISA##Set1(expMin), x); \
+	x = ISA##Select(ISA##Less(ISA##Set1(expMax), x), ISA##Set1(expMax), x); \
+	VEC magic = ISA##Set1(roundMagic); \
+	VEC n = ISA##Sub(ISA##Add(ISA##Mul(x, ISA##Set1(1.44269504088896341)), magic), magic); \
+	VEC r = ISA##Sub(ISA##Sub(x, ISA##Mul(n, ISA##Set1(0.693359375))), ISA##Mul(n, ISA##Set1(-2.12194440e-4))); \
+	VEC p = ISA##Set1(1.9875691500e-4); \
+	p = ISA##Add(ISA##Mul(p, r), ISA##Set1(1.3981999507e-3)); \
+	p = ISA##Add(ISA##Mul(p, r), ISA##Set1(8.3334519073e-3)); \
+	p = ISA##Add(ISA##Mul(p, r), ISA##Set1(4.1665795894e-2)); \
+	p = ISA##Add(ISA##Mul(p, r), ISA##Set1(1.6666665459e-1)); \
+	p = ISA##Add(ISA##Mul(p, r), ISA##Set1(5.0000001201e-1)); \
+	p = ISA##Add(ISA##Add(ISA##Mul(ISA##Mul(p, r), r), r), ISA##Set1(1)); \
+	return ISA##Mul(p, ISA##Pow2(n)); \
+} \
+FANNY_TARGET(TARGET) static inline VEC ISA##Sin(VEC x, bool cosine) { \
+	/* x = k * pi + r, with k an integer for sin() and an integer plus 0.5 for cos() */ \
+	VEC magic = ISA##Set1(roundMagic); \
+	VEC offset = ISA##Set1(cosine ? 0.5 : 0); \
+	VEC j = ISA##Sub(ISA##Add(ISA##Sub(ISA##Mul(x, ISA##Set1(0.318309886183790672)), offset), magic), magic); \
+	VEC k = ISA##Add(j, offset); \
+	VEC r = ISA##Sub(x, ISA##Mul(k, ISA##Set1(3.140625))); \
+	r = ISA##Sub(r, ISA##Mul(k, ISA##Set1(9.67502593994140625e-4))); \
+	r = ISA##Sub(r, ISA##Mul(k, ISA##Set1(1.509957990978376432e-7))); \
+	VEC r2 = ISA##Mul(r, r); \
+	VEC p = ISA##Set1(-2.5052108385441719e-8); \
+	p = ISA##Add(ISA##Mul(p, r2), ISA##Set1(2.7557319223985891e-6)); \
+	p = ISA##Add(ISA##Mul(p, r2), ISA##Set1(-1.9841269841269841e-4)); \
+	p = ISA##Add(ISA##Mul(p, r2), ISA##Set1(8.3333333333333333e-3)); \
+	p = ISA##Add(ISA##Mul(p, r2), ISA##Set1(-1.6666666666666667e-1)); \
+	p = ISA##Add(ISA##Mul(ISA##Mul(p, r2), r), r); \
+	/* sin(x) = (-1)^j sin(r) and cos(x) = -(-1)^j sin(r); half is 0.5 when j is odd */ \
+	VEC half = ISA##Mul(j, ISA##Set1(0.5)); \
+	half = ISA##Abs(ISA##Sub(half, ISA##Sub(ISA##Add(half, magic), magic))); \
+	VEC sign = ISA##Sub(ISA##Set1(1), ISA##Mul(half, ISA##Set1(4))); \
+	if (cosine) sign = ISA##Sub(ISA##Set1(0), sign); \
+	return ISA##Mul(p, sign); \
+} \
+FANNY_TARGET(TARGET) static inline VEC ISA##Stepwise(VEC sum, const fann_type *v, const fann_type *r, fann_type min, fann_type max) { \
+	VEC result = ISA##Set1(min); \
+	for (int i = 0; i < 5; i++) { \
+		VEC vi = ISA##Set1(v[i]); \
+		VEC line = ISA##Add(ISA##Mul(ISA##Set1((r[i + 1] - r[i]) / (v[i + 1] - v[i])), ISA##Sub(sum, vi)), ISA##Set1(r[i])); \
+		result = ISA##Select(ISA##Less(sum, vi), result, line); \
+	} \
+	return ISA##Select(ISA##Less(sum, ISA##Set1(v[5])), result, ISA##Set1(max)); \
+} \
+FANNY_TARGET(TARGET) static inline VEC ISA##Apply(enum fann_activationfunc_enum fn, VEC sum) { \
+	VEC zero = ISA##Set1(0); \
+	VEC one = ISA##Set1(1); \
+	VEC minusOne = ISA##Set1(-1); \
+	VEC half = ISA##Set1(0.5); \
+	switch (fn) { \
+		case FANN_LINEAR_PIECE: \
+			return ISA##Select(ISA##Less(sum, zero), zero, ISA##Select(ISA##Less(one, sum), one, sum)); \
+		case FANN_LINEAR_PIECE_SYMMETRIC: \
+			return ISA##Select(ISA##Less(sum, minusOne), minusOne, ISA##Select(ISA##Less(one, sum), one, sum)); \
+		case FANN_THRESHOLD: \
+			return ISA##Select(ISA##Less(sum, zero), zero, one); \
+		case FANN_THRESHOLD_SYMMETRIC: \
+			return ISA##Select(ISA##Less(sum, zero), minusOne, one); \
+		case FANN_ELLIOT: \
+			return ISA##Add(ISA##Div(ISA##Mul(sum, half), ISA##Add(one, ISA##Abs(sum))), half); \
+		case FANN_ELLIOT_SYMMETRIC: \
+			return ISA##Div(sum, ISA##Add(one, ISA##Abs(sum))); \
+		case FANN_SIGMOID: \
+			return ISA##Div(one, ISA##Add(one, ISA##Exp(ISA##Mul(ISA##Set1(-2), sum)))); \
+		case FANN_SIGMOID_SYMMETRIC: \
+			return ISA##Sub(ISA##Div(ISA##Set1(2), ISA##Add(one, ISA##Exp(ISA##Mul(ISA##Set1(-2), sum)))), one); \
+		case FANN_GAUSSIAN: \
+			return ISA##Exp(ISA##Mul(ISA##Sub(zero, sum), sum)); \
+		case FANN_GAUSSIAN_SYMMETRIC: \
+			return ISA##Sub(ISA##Mul(ISA##Exp(ISA##Mul(ISA##Sub(zero, sum), sum)), ISA##Set1(2)), one); \
+		case FANN_SIN_SYMMETRIC: \
+			return ISA##Sin(sum, false); \
+		case FANN_COS_SYMMETRIC: \
+			return ISA##Sin(sum, true); \
+		case FANN_SIN: \
+			return ISA##Add(ISA##Mul(ISA##Sin(sum, false), half), half); \
+		case FANN_COS: \
+			return ISA##Add(ISA##Mul(ISA##Sin(sum, true), half), half); \
+		case FANN_SIGMOID_STEPWISE: \
+			return ISA##Stepwise(sum, sigmoidStepwiseV, sigmoidStepwiseR, 0, 1); \
+		case FANN_SIGMOID_SYMMETRIC_STEPWISE: \
+			return ISA##Stepwise(sum, sigmoidSymmetricStepwiseV, sigmoidSymmetricStepwiseR, -1, 1); \
+		default: \
+			return sum; \
+	} \
+}
+
+// Activation kernels.  Functions without an exact vector form are finished with scalar code after
+// the vectorized clamp.  The last partial vector is padded so it goes through the same code.
+// Fewer values than a vector, such as the one-neuron layers cascade training adds, are cheaper to
+// do with the scalar kernel, which gives the same results unless fast approximations are in use.
+#define FANNY_DEFINE_ACTIVATE(NAME, TARGET, VEC, ISA) \
+FANNY_TARGET(TARGET) static void NAME(enum fann_activationfunc_enum fn, bool fast, const fann_type *steepness, fann_type *values, unsigned int count) { \
+	const unsigned int width = ISA##Width; \
+	bool vectorFn = isVectorActivation(fn, fast); \
+	if (count < width && (!vectorFn || isVectorActivation(fn, false))) { \
+		activateScalar(fn, fast, steepness, values, count); \
+		return; \
+	} \
+	unsigned int i = 0; \
+	for (; i + width <= count; i += width) { \
+		VEC sum = ISA##Clamp(ISA##Load(values + i), ISA##Load(steepness + i)); \
+		ISA##Store(values + i, vectorFn ? ISA##Apply(fn, sum) : sum); \
+	} \
+	if (i < count) { \
+		fann_type valueTail[ISA##Width]; \
+		fann_type steepnessTail[ISA##Width]; \
+		for (unsigned int j = 0; j < width; j++) { \
+			valueTail[j] = (i + j < count) ? values[i + j] : 0; \
+			steepnessTail[j] = (i + j < count) ? steepness[i + j] : 1; \
+		} \
+		VEC sum = ISA##Clamp(ISA##Load(valueTail), ISA##Load(steepnessTail)); \
+		ISA##Store(valueTail, vectorFn ? ISA##Apply(fn, sum) : sum); \
+		for (unsigned int j = 0; i + j < count; j++) values[i + j] = valueTail[j]; \
+	} \
+	if (!vectorFn) applyActivationScalar(fn, values, count); \
+}
+
+FANNY_DEFINE_ACTIVATION_HELPERS("sse2", Sse2Vec, sse2)
+FANNY_DEFINE_ACTIVATION_HELPERS("avx2,fma", Avx2Vec, avx2)
+FANNY_DEFINE_ACTIVATION_HELPERS("avx512f,avx2,fma", Avx512Vec, avx512)
+FANNY_DEFINE_ACTIVATE(activateSse2, "sse2", Sse2Vec, sse2)
+FANNY_DEFINE_ACTIVATE(activateAvx2, "avx2,fma", Avx2Vec, avx2)
+FANNY_DEFINE_ACTIVATE(activateAvx512, "avx512f,avx2,fma", Avx512Vec, avx512)
+
+#endif
+
+static Level detectLevel() {
+	Level level = LEVEL_SCALAR;
+	#ifdef FANNY_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2")) level = LEVEL_SSE2;
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) level = LEVEL_AVX2;
+	if (__builtin_cpu_supports("avx512f")) level = LEVEL_AVX512;
+	#endif
+	const char *requested = getenv("FANNY_SIMD");
+	if (requested) {
+		for (int l = LEVEL_SCALAR; l <= LEVEL_AVX512; l++) {
+			if (!strcmp(requested, getLevelName((Level)l))) {
+				if (l < level) level = (Level)l;
+				break;
+			}
+		}
+	}
+	return level;
+}
+
+static Kernels buildKernels() {
+	Kernels k;
+	k.level = detectLevel();
+	k.gemv = gemvScalar;
+	k.gemm = gemmScalar;
+	k.spmv = spmvScalar;
+	k.axpy = axpyScalar;
+	k.gemvInt8 = gemvInt8Scalar;
+	#ifdef FANNY_SIMD_X86
+	if (k.level >= LEVEL_SSE2) k.gemvInt8 = gemvInt8Sse2;
+	if (k.level >= LEVEL_AVX2) k.gemvInt8 = gemvInt8Avx2;
+	if (k.level >= LEVEL_AVX512 && __builtin_cpu_supports("avx512bw")) k.gemvInt8 = gemvInt8Avx512;
+	#endif
+	#ifndef FANNY_FIXED
+	k.activate = activateScalar;
+	#endif
+	#ifdef FANNY_SIMD_X86
+	if (k.level >= LEVEL_SSE2) {
+		k.gemv = gemvSse2;
+		k.gemm = gemmSse2;
+		k.axpy = axpySse2;
+	}
+	if (k.level >= LEVEL_AVX2) {
+		k.gemv = gemvAvx2;
+		k.gemm = gemmAvx2;
+		k.spmv = spmvAvx2;
+		k.axpy = axpyAvx2;
+	}
+	if (k.level >= LEVEL_AVX512) {
+		k.gemv = gemvAvx512;
+		k.gemm = gemmAvx512;
+		k.spmv = spmvAvx512;
+		k.axpy = axpyAvx512;
+	}
+	#endif
+	#if defined FANNY_SIMD_X86 && !defined FANNY_FIXED
+	if (k.level >= LEVEL_SSE2) k.activate = activateSse2;
+	if (k.level >= LEVEL_AVX2) k.activate = activateAvx2;
+	if (k.level >= LEVEL_AVX512) k.activate = activateAvx512;
+	#endif
+	return k;
+}
+
+const Kernels &getKernels() {
+	static const Kernels kernels = buildKernels();
+	return kernels;
+}
+
+Level getLevel() {
+	return getKernels().level;
+}
+
+const char *getLevelName(Level level) {
+	switch (level) {
+		case LEVEL_SSE2: return "sse2";
+		case LEVEL_AVX2: return "avx2";
+		case LEVEL_AVX512: return "avx512";
+		default: return "scalar";
+	}
+}
+
+}
+}
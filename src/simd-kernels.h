@@ -0,0 +1,71 @@
+#ifndef FANNY_SIMD_KERNELS_H
+#define FANNY_SIMD_KERNELS_H
+
+#include "fann-includes.h"
+#include <cstddef>
+#include <stdint.h>
+
+namespace fanny {
+namespace simd {
+
+// Instruction set levels the kernels are compiled for, in increasing order
+enum Level {
+	LEVEL_SCALAR = 0,
+	LEVEL_SSE2,
+	LEVEL_AVX2,
+	LEVEL_AVX512
+};
+
+// Returns the level the kernels run at.  This is the best level supported by the CPU, optionally
+// lowered by setting the FANNY_SIMD environment variable to "scalar", "sse2", "avx2" or "avx512".
+Level getLevel();
+
+const char *getLevelName(Level level);
+
+// Matrix-vector product: y[r] = sum(w[r * stride + i] * x[i]) for r in [0, rows), i in [0, n).
+// For fixed point, each product is shifted right by decimalPoint before summing, as FANN does.
+typedef void (*GemvFn)(const fann_type *w, size_t stride, unsigned int rows, const fann_type *x, unsigned int n, fann_type *y, unsigned int decimalPoint);
+
+// Matrix-matrix product over a batch of count vectors: the GEMV above for x + s * xStride and
+// y + s * yStride, s in [0, count).  Weights are reused across vectors while in cache, and each
+// output is summed in the same order as GemvFn, so results are identical to calling it per vector.
+typedef void (*GemmFn)(const fann_type *w, size_t wStride, unsigned int rows, const fann_type *x, size_t xStride, unsigned int n, unsigned int count, fann_type *y, size_t yStride, unsigned int decimalPoint);
+
+// Sparse matrix-vector product over compressed rows: y[r] = sum(weights[k] * x[columns[k]]) for k
+// in [rowStarts[r], rowStarts[r + 1]), with fixed point products shifted as for GemvFn
+typedef void (*SpmvFn)(const uint32_t *rowStarts, const uint32_t *columns, const fann_type *weights, unsigned int rows, const fann_type *x, fann_type *y, unsigned int decimalPoint);
+
+// Scaled vector addition: y[i] += w[i] * a for i in [0, n), with fixed point products shifted as
+// for GemvFn
+typedef void (*AxpyFn)(const fann_type *w, fann_type a, unsigned int n, fann_type *y, unsigned int decimalPoint);
+
+// Matrix-vector product of int8 weights and inputs with int32 sums: y[r] = sum(w[r * stride + i] *
+// x[i]).  All values must be in [-127, 127].
+typedef void (*GemvInt8Fn)(const int8_t *w, size_t stride, unsigned int rows, const int8_t *x, unsigned int n, int32_t *y);
+
+#ifndef FANNY_FIXED
+// Applies steepness, FANN's sum limit and an activation function to count sums in place, with a
+// separate steepness for each.  In fast mode, functions built on exp(), sin() and cos() use
+// polynomial approximations; otherwise results are identical to fann_run().
+typedef void (*ActivateFn)(enum fann_activationfunc_enum fn, bool fast, const fann_type *steepness, fann_type *values, unsigned int count);
+#endif
+
+// Table of kernels for the selected level
+struct Kernels {
+	Level level;
+	GemvFn gemv;
+	GemmFn gemm;
+	SpmvFn spmv;
+	AxpyFn axpy;
+	GemvInt8Fn gemvInt8;
+	#ifndef FANNY_FIXED
+	ActivateFn activate;
+	#endif
+};
+
+const Kernels &getKernels();
+
+}
+}
+
+#endif
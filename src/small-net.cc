@@ -0,0 +1,162 @@
+#include "small-net.h"
+#include "fann-access.h"
+#include <cmath>
+
+// fann_activation_switch() uses this helper from FANN's internal header
+#ifndef fann_abs
+#define fann_abs(value) (((value) > 0) ? (value) : -(value))
+#endif
+
+#ifndef FANNY_FIXED
+
+namespace fanny {
+
+// Sum of Count products in fann_run()'s order: the first Count % 4 in reverse, then the rest four
+// at a time
+template<unsigned int Count>
+static inline fann_type dot(const fann_type *w, const fann_type *v) {
+	fann_type sum = 0;
+	if ((Count & 3) > 2) sum += w[2] * v[2];
+	if ((Count & 3) > 1) sum += w[1] * v[1];
+	if ((Count & 3) > 0) sum += w[0] * v[0];
+	for (unsigned int i = Count & 3; i != Count; i += 4) {
+		sum += w[i] * v[i] + w[i + 1] * v[i + 1] + w[i + 2] * v[i + 2] + w[i + 3] * v[i + 3];
+	}
+	return sum;
+}
+
+// Computes Count neurons from NumSources source values, the last of which is the bias
+template<unsigned int NumSources, unsigned int Count>
+static inline void runLayer(const fann_type *weights, const fann_type *steepnesses, const fann_type *maxSums,
+	const enum fann_activationfunc_enum *activationFunctions, const fann_type *source, fann_type *values) {
+	for (unsigned int i = 0; i < Count; i++) {
+		fann_type sum = steepnesses[i] * dot<NumSources>(weights + i * NumSources, source);
+		if (sum > maxSums[i]) {
+			sum = maxSums[i];
+		} else if (sum < -maxSums[i]) {
+			sum = -maxSums[i];
+		}
+		fann_activation_switch(activationFunctions[i], sum, values[i]);
+	}
+}
+
+// Runs the layers after one of In neurons, whose values (followed by the bias) are in source
+template<unsigned int In, unsigned int... Sizes>
+struct SmallLayers;
+
+template<unsigned int In, unsigned int Out>
+struct SmallLayers<In, Out> {
+	static inline void run(const fann_type *weights, const fann_type *steepnesses, const fann_type *maxSums,
+		const enum fann_activationfunc_enum *activationFunctions, const fann_type *source, fann_type *output) {
+		runLayer<In + 1, Out>(weights, steepnesses, maxSums, activationFunctions, source, output);
+	}
+};
+
+template<unsigned int In, unsigned int Out, unsigned int Next, unsigned int... Rest>
+struct SmallLayers<In, Out, Next, Rest...> {
+	static inline void run(const fann_type *weights, const fann_type *steepnesses, const fann_type *maxSums,
+		const enum fann_activationfunc_enum *activationFunctions, const fann_type *source, fann_type *output) {
+		fann_type values[Out + 1];
+		runLayer<In + 1, Out>(weights, steepnesses, maxSums, activationFunctions, source, values);
+		values[Out] = 1;
+		SmallLayers<Out, Next, Rest...>::run(weights + (In + 1) * Out, steepnesses + Out, maxSums + Out,
+			activationFunctions + Out, values, output);
+	}
+};
+
+template<unsigned int In, unsigned int... Sizes>
+static void smallKernel(const fann_type *weights, const fann_type *steepnesses, const fann_type *maxSums,
+	const enum fann_activationfunc_enum *activationFunctions, const fann_type *input, fann_type *output) {
+	fann_type source[In + 1];
+	for (unsigned int i = 0; i < In; i++) source[i] = input[i];
+	source[In] = 1;
+	SmallLayers<In, Sizes...>::run(weights, steepnesses, maxSums, activationFunctions, source, output);
+}
+
+// Layer sizes with a specialized kernel.  Each entry of the registry below expands to every
+// combination of these input, hidden and output sizes.
+struct SmallNetShape {
+	unsigned int numLayers;
+	unsigned int sizes[4];
+	SmallNet::KernelFn kernel;
+};
+
+#define FANNY_SMALL_NET_3(in, hidden, out) { 3, { in, hidden, out, 0 }, &smallKernel<in, hidden, out> }
+#define FANNY_SMALL_NET_4(in, hidden, out) { 4, { in, hidden, hidden, out }, &smallKernel<in, hidden, hidden, out> }
+#define FANNY_SMALL_NET_OUTPUTS(layers, in, hidden) \
+	FANNY_SMALL_NET_##layers(in, hidden, 1), FANNY_SMALL_NET_##layers(in, hidden, 2), \
+	FANNY_SMALL_NET_##layers(in, hidden, 4), FANNY_SMALL_NET_##layers(in, hidden, 8)
+#define FANNY_SMALL_NET_INPUTS(layers, hidden) \
+	FANNY_SMALL_NET_OUTPUTS(layers, 1, hidden), FANNY_SMALL_NET_OUTPUTS(layers, 2, hidden), \
+	FANNY_SMALL_NET_OUTPUTS(layers, 4, hidden), FANNY_SMALL_NET_OUTPUTS(layers, 8, hidden), \
+	FANNY_SMALL_NET_OUTPUTS(layers, 16, hidden)
+
+static const SmallNetShape smallNetShapes[] = {
+	FANNY_SMALL_NET_INPUTS(3, 4),
+	FANNY_SMALL_NET_INPUTS(3, 8),
+	FANNY_SMALL_NET_INPUTS(3, 16),
+	FANNY_SMALL_NET_INPUTS(3, 32),
+	FANNY_SMALL_NET_INPUTS(4, 4),
+	FANNY_SMALL_NET_INPUTS(4, 8),
+	FANNY_SMALL_NET_INPUTS(4, 16)
+};
+
+std::shared_ptr<SmallNet> SmallNet::create(FANN::neural_net *net) {
+	std::shared_ptr<SmallNet> empty;
+	struct fann *ann = getFannStruct(net);
+	if (!ann || !ann->first_layer) return empty;
+	if (ann->network_type != FANN_NETTYPE_LAYER || ann->connection_rate < 1) return empty;
+
+	// Layer sizes, not counting bias neurons
+	std::vector<unsigned int> sizes;
+	for (struct fann_layer *layerIt = ann->first_layer; layerIt != ann->last_layer; layerIt++) {
+		sizes.push_back((unsigned int)(layerIt->last_neuron - layerIt->first_neuron) - 1);
+	}
+	const SmallNetShape *match = NULL;
+	for (size_t s = 0; s < sizeof(smallNetShapes) / sizeof(smallNetShapes[0]) && !match; s++) {
+		const SmallNetShape &shape = smallNetShapes[s];
+		if (shape.numLayers != sizes.size()) continue;
+		bool same = true;
+		for (unsigned int l = 0; l < shape.numLayers; l++) {
+			if (shape.sizes[l] != sizes[l]) same = false;
+		}
+		if (same) match = &shape;
+	}
+	if (!match) return empty;
+
+	std::shared_ptr<SmallNet> sn(new SmallNet());
+	sn->kernel = match->kernel;
+	sn->numInput = ann->num_input;
+	sn->numOutput = ann->num_output;
+	for (size_t l = 0; l < sizes.size(); l++) {
+		if (l) sn->shape += "-";
+		sn->shape += std::to_string(sizes[l]);
+	}
+	for (struct fann_layer *layerIt = ann->first_layer + 1; layerIt != ann->last_layer; layerIt++) {
+		unsigned int numSources = (unsigned int)((layerIt - 1)->last_neuron - (layerIt - 1)->first_neuron);
+		// Every neuron but the bias must read the whole previous layer, bias included
+		for (struct fann_neuron *neuronIt = layerIt->first_neuron; neuronIt != layerIt->last_neuron - 1; neuronIt++) {
+			if (neuronIt->last_con - neuronIt->first_con != numSources) return empty;
+			sn->weights.insert(sn->weights.end(), ann->weights + neuronIt->first_con, ann->weights + neuronIt->last_con);
+			sn->steepnesses.push_back(neuronIt->activation_steepness);
+			sn->maxSums.push_back(150 / neuronIt->activation_steepness);
+			sn->activationFunctions.push_back(neuronIt->activation_function);
+		}
+	}
+	return sn;
+}
+
+void SmallNet::run(const fann_type *input, fann_type *output) const {
+	kernel(weights.data(), steepnesses.data(), maxSums.data(), activationFunctions.data(), input, output);
+}
+
+void SmallNet::runBatch(const fann_type *inputs, unsigned int numRuns, fann_type *outputs) const {
+	for (unsigned int i = 0; i < numRuns; i++) {
+		kernel(weights.data(), steepnesses.data(), maxSums.data(), activationFunctions.data(),
+			inputs + (size_t)i * numInput, outputs + (size_t)i * numOutput);
+	}
+}
+
+}
+
+#endif
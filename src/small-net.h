@@ -0,0 +1,58 @@
+#ifndef FANNY_SMALL_NET_H
+#define FANNY_SMALL_NET_H
+
+#include "fann-includes.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef FANNY_FIXED
+
+namespace fanny {
+
+// A copy of a small standard network run by a kernel compiled for its exact layer sizes.  Loops
+// over neurons and connections have constant trip counts the compiler can unroll, and neuron
+// values stay in registers and on the stack instead of in FANN's neuron structs.  Sums are added in
+// the same order as fann_run() and activations use FANN's own formulas, so outputs are identical to
+// FANN's.  Like CompiledNet, a SmallNet never changes after create() returns and can be run from any
+// number of threads at once.
+class SmallNet {
+public:
+	// Returns a SmallNet for the network if it's a fully connected standard network whose layer
+	// sizes match one of the specialized kernels, otherwise an empty pointer
+	static std::shared_ptr<SmallNet> create(FANN::neural_net *net);
+
+	// Runs the network on one set of inputs, writing numOutput outputs
+	void run(const fann_type *input, fann_type *output) const;
+	// Same, for numRuns sets of inputs and outputs stored back-to-back
+	void runBatch(const fann_type *inputs, unsigned int numRuns, fann_type *outputs) const;
+
+	unsigned int getNumInput() const { return numInput; }
+	unsigned int getNumOutput() const { return numOutput; }
+	// Layer sizes of the kernel, such as "8-16-4"
+	const std::string &getShape() const { return shape; }
+
+	// Computes the outputs from weights stored by neuron, each neuron's row ending with its bias
+	// weight, and the steepness, sum limit and activation function of each computed neuron
+	typedef void (*KernelFn)(const fann_type *weights, const fann_type *steepnesses, const fann_type *maxSums,
+		const enum fann_activationfunc_enum *activationFunctions, const fann_type *input, fann_type *output);
+
+private:
+	SmallNet() {}
+
+	KernelFn kernel;
+	unsigned int numInput;
+	unsigned int numOutput;
+	std::string shape;
+	std::vector<fann_type> weights;
+	std::vector<fann_type> steepnesses;
+	// 150 / steepness, FANN's limit on the sum passed to the activation function
+	std::vector<fann_type> maxSums;
+	std::vector<enum fann_activationfunc_enum> activationFunctions;
+};
+
+}
+
+#endif
+
+#endif
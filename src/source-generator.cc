@@ -0,0 +1,312 @@
+#include "source-generator.h"
+#include <cmath>
+#include <cstdio>
+
+#ifndef FANNY_FIXED
+
+namespace fanny {
+
+// Generated implementation of an activation function: a function name and a C++ expression of
+// sum that mirrors fann_activation_switch(), including its C float/double promotions
+struct GeneratedActivation {
+	enum fann_activationfunc_enum fn;
+	const char *name;
+	const char *expression;
+};
+
+static const GeneratedActivation generatedActivations[] = {
+	{ FANN_LINEAR, "linear", "sum" },
+	{ FANN_THRESHOLD, "threshold", "(sum < 0) ? 0 : 1" },
+	{ FANN_THRESHOLD_SYMMETRIC, "thresholdSymmetric", "(sum < 0) ? -1 : 1" },
+	{ FANN_SIGMOID, "sigmoid", "1.0f / (1.0f + std::exp((double)(-2.0f * sum)))" },
+	{ FANN_SIGMOID_STEPWISE, "sigmoidStepwise", "stepwise(sigmoidStepwiseV, sigmoidStepwiseR, 0, 1, sum)" },
+	{ FANN_SIGMOID_SYMMETRIC, "sigmoidSymmetric", "2.0f / (1.0f + std::exp((double)(-2.0f * sum))) - 1.0f" },
+	{ FANN_SIGMOID_SYMMETRIC_STEPWISE, "sigmoidSymmetricStepwise", "stepwise(sigmoidSymmetricStepwiseV, sigmoidSymmetricStepwiseR, -1, 1, sum)" },
+	{ FANN_GAUSSIAN, "gaussian", "std::exp((double)(-sum * sum))" },
+	{ FANN_GAUSSIAN_SYMMETRIC, "gaussianSymmetric", "std::exp((double)(-sum * sum)) * 2.0f - 1.0f" },
+	{ FANN_GAUSSIAN_STEPWISE, "gaussianStepwise", "0" },
+	{ FANN_ELLIOT, "elliot", "(sum / 2.0f) / (1.0f + ((sum > 0) ? sum : -sum)) + 0.5f" },
+	{ FANN_ELLIOT_SYMMETRIC, "elliotSymmetric", "sum / (1.0f + ((sum > 0) ? sum : -sum))" },
+	{ FANN_LINEAR_PIECE, "linearPiece", "(sum < 0) ? 0 : (sum > 1) ? 1 : sum" },
+	{ FANN_LINEAR_PIECE_SYMMETRIC, "linearPieceSymmetric", "(sum < -1) ? -1 : (sum > 1) ? 1 : sum" },
+	{ FANN_SIN_SYMMETRIC, "sinSymmetric", "std::sin((double)sum)" },
+	{ FANN_COS_SYMMETRIC, "cosSymmetric", "std::cos((double)sum)" },
+	{ FANN_SIN, "sin", "std::sin((double)sum) / 2.0f + 0.5f" },
+	{ FANN_COS, "cos", "std::cos((double)sum) / 2.0f + 0.5f" }
+};
+
+static const GeneratedActivation *findGeneratedActivation(enum fann_activationfunc_enum fn) {
+	for (size_t i = 0; i < sizeof(generatedActivations) / sizeof(generatedActivations[0]); i++) {
+		if (generatedActivations[i].fn == fn) return &generatedActivations[i];
+	}
+	return NULL;
+}
+
+// Code shared by every generated network, after the value_type typedef
+static const char *generatedHelpers =
+	"// FANN's stepwise sigmoid breakpoints, in double as in fann_activation.h\n"
+	"const double sigmoidStepwiseV[6] = { -2.64665246009826660156e+00, -1.47221946716308593750e+00, -5.49306154251098632812e-01, 5.49306154251098632812e-01, 1.47221934795379638672e+00, 2.64665293693542480469e+00 };\n"
+	"const double sigmoidStepwiseR[6] = { 4.99999988824129104614e-03, 5.00000007450580596924e-02, 2.50000000000000000000e-01, 7.50000000000000000000e-01, 9.49999988079071044922e-01, 9.95000004768371582031e-01 };\n"
+	"const double sigmoidSymmetricStepwiseV[6] = { -2.64665293693542480469e+00, -1.47221934795379638672e+00, -5.49306154251098632812e-01, 5.49306154251098632812e-01, 1.47221934795379638672e+00, 2.64665293693542480469e+00 };\n"
+	"const double sigmoidSymmetricStepwiseR[6] = { -9.90000009536743164062e-01, -8.99999976158142089844e-01, -5.00000000000000000000e-01, 5.00000000000000000000e-01, 8.99999976158142089844e-01, 9.90000009536743164062e-01 };\n"
+	"\n"
+	"inline double stepwiseLine(double v1, double r1, double v2, double r2, value_type sum) {\n"
+	"\treturn ((r2 - r1) * (sum - v1)) / (v2 - v1) + r1;\n"
+	"}\n"
+	"\n"
+	"inline double stepwise(const double *v, const double *r, double min, double max, value_type sum) {\n"
+	"\tif (sum < v[4]) {\n"
+	"\t\tif (sum < v[2]) {\n"
+	"\t\t\tif (sum < v[1]) return (sum < v[0]) ? min : stepwiseLine(v[0], r[0], v[1], r[1], sum);\n"
+	"\t\t\treturn stepwiseLine(v[1], r[1], v[2], r[2], sum);\n"
+	"\t\t}\n"
+	"\t\treturn (sum < v[3]) ? stepwiseLine(v[2], r[2], v[3], r[3], sum) : stepwiseLine(v[3], r[3], v[4], r[4], sum);\n"
+	"\t}\n"
+	"\treturn (sum < v[5]) ? stepwiseLine(v[4], r[4], v[5], r[5], sum) : max;\n"
+	"}\n"
+	"\n"
+	"// Sums of Rows neurons over Cols source values.  Weights are stored by column, so each step\n"
+	"// updates every row at once and the compiler can vectorize it without reordering any sum.\n"
+	"template<unsigned int Rows, unsigned int Cols>\n"
+	"inline void denseSums(const value_type (&weights)[Cols][Rows], const value_type *source, value_type *sums) {\n"
+	"\tfor (unsigned int r = 0; r < Rows; r++) sums[r] = 0;\n"
+	"\tfor (unsigned int c = 0; c < Cols; c++) {\n"
+	"\t\tfor (unsigned int r = 0; r < Rows; r++) sums[r] += weights[c][r] * source[c];\n"
+	"\t}\n"
+	"}\n"
+	"\n"
+	"// Sums of neurons stored as compressed sparse rows, with one more row start than rows.\n"
+	"// Columns are neuron indices.\n"
+	"template<unsigned int RowStarts, unsigned int Nonzero>\n"
+	"inline void sparseSums(const unsigned int (&rowStarts)[RowStarts], const unsigned int (&columns)[Nonzero], const value_type (&weights)[Nonzero], const value_type *values, value_type *sums) {\n"
+	"\tfor (unsigned int r = 0; r + 1 < RowStarts; r++) {\n"
+	"\t\tvalue_type sum = 0;\n"
+	"\t\tfor (unsigned int k = rowStarts[r]; k < rowStarts[r + 1]; k++) sum += weights[k] * values[columns[k]];\n"
+	"\t\tsums[r] = sum;\n"
+	"\t}\n"
+	"}\n"
+	"\n"
+	"// Applies steepness and FANN's limit on sums, then the activation function, to Count neurons\n"
+	"template<value_type (*Activation)(value_type), unsigned int Count>\n"
+	"inline void activate(const value_type *steepness, value_type *values) {\n"
+	"\tfor (unsigned int i = 0; i < Count; i++) {\n"
+	"\t\tvalue_type sum = steepness[i] * values[i];\n"
+	"\t\tvalue_type maxSum = 150 / steepness[i];\n"
+	"\t\tif (sum > maxSum) {\n"
+	"\t\t\tsum = maxSum;\n"
+	"\t\t} else if (sum < -maxSum) {\n"
+	"\t\t\tsum = -maxSum;\n"
+	"\t\t}\n"
+	"\t\tvalues[i] = Activation(sum);\n"
+	"\t}\n"
+	"}\n";
+
+static void appendNumber(std::string &out, unsigned int value) {
+	char buf[16];
+	snprintf(buf, sizeof(buf), "%u", value);
+	out += buf;
+}
+
+// Appends a value_type literal that reads back as exactly the same value
+static void appendValue(std::string &out, fann_type value) {
+	if (std::isnan(value)) {
+		out += "std::numeric_limits<value_type>::quiet_NaN()";
+		return;
+	}
+	if (std::isinf(value)) {
+		out += (value < 0) ? "-std::numeric_limits<value_type>::infinity()" : "std::numeric_limits<value_type>::infinity()";
+		return;
+	}
+	char buf[40];
+	#ifdef FANNY_DOUBLE
+	snprintf(buf, sizeof(buf), "%.17g", (double)value);
+	#else
+	snprintf(buf, sizeof(buf), "%.9g", (double)value);
+	#endif
+	out += buf;
+	bool hasPoint = false;
+	for (const char *c = buf; *c; c++) {
+		if (*c == '.' || *c == 'e') hasPoint = true;
+	}
+	if (!hasPoint) out += ".0";
+	#ifndef FANNY_DOUBLE
+	out += "f";
+	#endif
+}
+
+// Appends the elements of an array initializer, eight to a line
+template<typename T, typename AppendFn>
+static void appendElements(std::string &out, const T *values, size_t count, AppendFn append) {
+	for (size_t i = 0; i < count; i++) {
+		out += (i % 8 == 0) ? "\n\t" : " ";
+		append(out, values[i]);
+		if (i + 1 < count) out += ",";
+	}
+	out += "\n";
+}
+
+std::string SourceGenerator::generate(const CompiledNet &net, const std::string &name) {
+	std::vector<bool> usedActivations(sizeof(generatedActivations) / sizeof(generatedActivations[0]), false);
+	for (size_t s = 0; s < net.activationSegments.size(); s++) {
+		const GeneratedActivation *activation = findGeneratedActivation(net.activationSegments[s].activationFunction);
+		if (!activation) return std::string();
+		usedActivations[activation - generatedActivations] = true;
+	}
+
+	std::string out;
+	out += "// Generated by fanny's generateSource().  Standalone copy of a network with ";
+	appendNumber(out, net.numInput);
+	out += " inputs, ";
+	appendNumber(out, net.numOutput);
+	out += " outputs and ";
+	appendNumber(out, net.totalNeurons);
+	out += " neurons.\n\n";
+	out += "#include <cmath>\n#include <limits>\n\n";
+	out += "namespace " + name + " {\n\n";
+	#ifdef FANNY_DOUBLE
+	out += "typedef double value_type;\n\n";
+	#else
+	out += "typedef float value_type;\n\n";
+	#endif
+	out += "const unsigned int numInput = ";
+	appendNumber(out, net.numInput);
+	out += ";\nconst unsigned int numOutput = ";
+	appendNumber(out, net.numOutput);
+	out += ";\n\n";
+	out += "// Runs the network on numInput inputs, writing numOutput outputs\n";
+	out += "void run(const value_type *input, value_type *output);\n\n";
+	out += "namespace {\n\n";
+	out += "const unsigned int numNeurons = ";
+	appendNumber(out, net.totalNeurons);
+	out += ";\n\n";
+	out += generatedHelpers;
+
+	for (size_t i = 0; i < usedActivations.size(); i++) {
+		if (!usedActivations[i]) continue;
+		out += "\ninline value_type ";
+		out += generatedActivations[i].name;
+		out += "(value_type sum) {\n\treturn (value_type)(";
+		out += generatedActivations[i].expression;
+		out += ");\n}\n";
+	}
+
+	out += "\nalignas(64) const value_type steepness[numNeurons] = {";
+	appendElements(out, net.steepnesses.data(), net.steepnesses.size(), appendValue);
+	out += "};\n";
+
+	std::vector<fann_type> row;
+	std::vector<fann_type> columns;
+	for (size_t l = 0; l < net.layers.size(); l++) {
+		const CompiledNet::Layer &layer = net.layers[l];
+		std::string prefix = "layer";
+		appendNumber(prefix, (unsigned int)l);
+		if (layer.sparse) {
+			const uint32_t *rowStarts = &net.sparseRowStarts[layer.sparseRowFirst];
+			uint32_t first = rowStarts[0];
+			uint32_t nonzero = rowStarts[layer.count] - first;
+			std::vector<uint32_t> starts(rowStarts, rowStarts + layer.count + 1);
+			for (size_t i = 0; i < starts.size(); i++) starts[i] -= first;
+			out += "\nconst unsigned int " + prefix + "RowStarts[";
+			appendNumber(out, layer.count + 1);
+			out += "] = {";
+			appendElements(out, starts.data(), starts.size(), appendNumber);
+			out += "};\nconst unsigned int " + prefix + "Columns[";
+			appendNumber(out, nonzero);
+			out += "] = {";
+			appendElements(out, &net.sparseColumns[first], nonzero, appendNumber);
+			out += "};\nalignas(64) const value_type " + prefix + "Weights[";
+			appendNumber(out, nonzero);
+			out += "] = {";
+			appendElements(out, &net.sparseWeights[first], nonzero, appendValue);
+			out += "};\n";
+			continue;
+		}
+		// Transpose the layer's rows so weights are stored by source
+		row.resize(layer.srcCount);
+		columns.assign((size_t)layer.srcCount * layer.count, 0);
+		for (unsigned int r = 0; r < layer.count; r++) {
+			net.getDenseRow(layer, r, row.data());
+			for (unsigned int c = 0; c < layer.srcCount; c++) columns[(size_t)c * layer.count + r] = row[c];
+		}
+		out += "\nalignas(64) const value_type " + prefix + "Weights[";
+		appendNumber(out, layer.srcCount);
+		out += "][";
+		appendNumber(out, layer.count);
+		out += "] = {";
+		for (unsigned int c = 0; c < layer.srcCount; c++) {
+			out += "\n\t{";
+			appendElements(out, &columns[(size_t)c * layer.count], layer.count, appendValue);
+			out += (c + 1 < layer.srcCount) ? "\t}," : "\t}";
+		}
+		out += "\n};\n";
+	}
+
+	out += "\n}\n\nvoid run(const value_type *input, value_type *output) {\n";
+	out += "\talignas(64) value_type values[numNeurons];\n";
+	out += "\tfor (unsigned int i = 0; i < numInput; i++) values[i] = input[i];\n";
+	for (size_t i = 0; i < net.biasNeurons.size(); i++) {
+		out += "\tvalues[";
+		appendNumber(out, net.biasNeurons[i]);
+		out += "] = 1;\n";
+	}
+	for (size_t l = 0; l < net.layers.size(); l++) {
+		const CompiledNet::Layer &layer = net.layers[l];
+		std::string prefix = "layer";
+		appendNumber(prefix, (unsigned int)l);
+		if (layer.sparse) {
+			out += "\tsparseSums(" + prefix + "RowStarts, " + prefix + "Columns, " + prefix + "Weights, values, values + ";
+		} else {
+			out += "\tdenseSums(" + prefix + "Weights, values + ";
+			appendNumber(out, layer.srcFirst);
+			out += ", values + ";
+		}
+		appendNumber(out, layer.first);
+		out += ");\n";
+		for (size_t s = layer.segmentFirst; s < layer.segmentFirst + layer.segmentCount; s++) {
+			const CompiledNet::ActivationSegment &segment = net.activationSegments[s];
+			out += "\tactivate<";
+			out += findGeneratedActivation(segment.activationFunction)->name;
+			out += ", ";
+			appendNumber(out, segment.count);
+			out += ">(steepness + ";
+			appendNumber(out, segment.first);
+			out += ", values + ";
+			appendNumber(out, segment.first);
+			out += ");\n";
+		}
+	}
+	out += "\tfor (unsigned int i = 0; i < numOutput; i++) output[i] = values[";
+	appendNumber(out, net.outputFirst);
+	out += " + i];\n}\n\n}\n";
+
+	out += "\n#ifdef FANNY_GENERATED_ADDON\n\n#include <nan.h>\n\n";
+	out += "namespace " + name + " {\nnamespace {\n\n";
+	out +=
+		"NAN_METHOD(runMethod) {\n"
+		"\tif (info.Length() != 1 || !info[0]->IsObject()) return Nan::ThrowTypeError(\"Argument must be an array of inputs\");\n"
+		"\tv8::Local<v8::Object> inputs = info[0].As<v8::Object>();\n"
+		"\tif (Nan::Get(inputs, Nan::New(\"length\").ToLocalChecked()).ToLocalChecked()->Uint32Value() != numInput) {\n"
+		"\t\treturn Nan::ThrowError(\"Wrong number of inputs\");\n"
+		"\t}\n"
+		"\tvalue_type input[numInput];\n"
+		"\tvalue_type output[numOutput];\n"
+		"\tfor (unsigned int i = 0; i < numInput; i++) input[i] = (value_type)Nan::Get(inputs, i).ToLocalChecked()->NumberValue();\n"
+		"\trun(input, output);\n"
+		"\tv8::Local<v8::Array> outputs = Nan::New<v8::Array>(numOutput);\n"
+		"\tfor (unsigned int i = 0; i < numOutput; i++) Nan::Set(outputs, i, Nan::New<v8::Number>(output[i]));\n"
+		"\tinfo.GetReturnValue().Set(outputs);\n"
+		"}\n"
+		"\n"
+		"NAN_MODULE_INIT(init) {\n"
+		"\tNan::Set(target, Nan::New(\"numInput\").ToLocalChecked(), Nan::New(numInput));\n"
+		"\tNan::Set(target, Nan::New(\"numOutput\").ToLocalChecked(), Nan::New(numOutput));\n"
+		"\tNan::SetMethod(target, \"run\", runMethod);\n"
+		"}\n"
+		"\n";
+	out += "}\n}\n\nNODE_MODULE(" + name + ", " + name + "::init)\n\n#endif\n";
+	return out;
+}
+
+}
+
+#endif
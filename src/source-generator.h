@@ -0,0 +1,29 @@
+#ifndef FANNY_SOURCE_GENERATOR_H
+#define FANNY_SOURCE_GENERATOR_H
+
+#include "fann-includes.h"
+#include "compiled-net.h"
+#include <string>
+
+#ifndef FANNY_FIXED
+
+namespace fanny {
+
+// Writes C++ source for a standalone copy of a CompiledNet, with no dependency on FANN or fanny.
+// Layer sizes are template arguments and weights are aligned static arrays, so the compiler can
+// unroll and vectorize every layer for this one network.  The source defines a namespace with
+// numInput, numOutput and run(const fann_type *input, fann_type *output), in float or double to
+// match the network.  Compiled with FANNY_GENERATED_ADDON defined, it is also a Node addon
+// exporting numInput, numOutput and run().
+class SourceGenerator {
+public:
+	// Returns the source, with everything in namespace name, or an empty string if the network
+	// uses an activation function the generated code doesn't implement
+	static std::string generate(const CompiledNet &net, const std::string &name);
+};
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef FANNY_TRAIN_LOOP_H
+#define FANNY_TRAIN_LOOP_H
+
+#include "fann-includes.h"
+#include "fann-internal.h"
+#include <cstdio>
+
+namespace fanny {
+
+// The loop in fann_train_on_data(), with trainEpoch() called in place of fann_train_epoch().  Stops
+// at the desired error and reports progress through the network's callback, or prints it if there
+// is none, just as FANN does.
+template<typename TrainEpochFn>
+void trainOnDataLoop(struct fann *ann, struct fann_train_data *data, unsigned int maxEpochs, unsigned int epochsBetweenReports, float desiredError, TrainEpochFn trainEpoch) {
+	if (epochsBetweenReports && ann->callback == NULL) {
+		printf("Max epochs %8d. Desired error: %.10f.\n", maxEpochs, desiredError);
+	}
+	for (unsigned int i = 1; i <= maxEpochs; i++) {
+		float error = trainEpoch();
+		int desiredErrorReached = fann_desired_error_reached(ann, desiredError);
+		if (epochsBetweenReports && (i % epochsBetweenReports == 0 || i == maxEpochs || i == 1 || desiredErrorReached == 0)) {
+			if (ann->callback == NULL) {
+				printf("Epochs     %8d. Current error: %.10f. Bit fail %d.\n", i, error, ann->num_bit_fail);
+			} else if ((*ann->callback)(ann, data, maxEpochs, epochsBetweenReports, desiredError, i) == -1) {
+				break;
+			}
+		}
+		if (desiredErrorReached == 0) break;
+	}
+}
+
+}
+
+#endif
@@ -3,6 +3,7 @@
 #include "fann-includes.h"
 #include <iostream>
 #include "utils.h"
+#include "addon-data.h"
 #include "training-data.h"
 
 namespace fanny {
@@ -50,8 +51,6 @@ public:
 };
 
 
-Nan::Persistent<v8::FunctionTemplate> TrainingData::constructorFunctionTpl;
-
 void TrainingData::Init(v8::Local<v8::Object> target) {
 	// Create new function template for this JS class constructor
 	v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
@@ -60,7 +59,7 @@ void TrainingData::Init(v8::Local<v8::Object> target) {
 	// Set the number of "slots" to allocate for fields on this class, not including prototype methods
 	tpl->InstanceTemplate()->SetInternalFieldCount(1);
 	// Save a reference to the function template
-	TrainingData::constructorFunctionTpl.Reset(tpl);
+	AddonData::get()->trainingDataConstructorTpl.Reset(tpl);
 
 	// Add prototype methods
 	Nan::SetPrototypeMethod(tpl, "readTrainFromFile", readTrainFromFile);
@@ -97,7 +96,7 @@ TrainingData::~TrainingData() {
 
 NAN_METHOD(TrainingData::New) {
 	FANN::training_data *trainingData;
-	if (info.Length() == 1 && Nan::New(TrainingData::constructorFunctionTpl)->HasInstance(info[0])) {
+	if (info.Length() == 1 && Nan::New(AddonData::get()->trainingDataConstructorTpl)->HasInstance(info[0])) {
 		TrainingData *other = Nan::ObjectWrap::Unwrap<TrainingData>(info[0].As<v8::Object>());
 		FANN::training_data *otherTrainingData = other->trainingData;
 		if (otherTrainingData->length_train_data() > 0) {
@@ -122,7 +121,7 @@ NAN_METHOD(TrainingData::merge) {
 	if (info.Length() != 1) {
 		return Nan::ThrowError("Requires single argument");
 	}
-	if (!Nan::New(TrainingData::constructorFunctionTpl)->HasInstance(info[0])) {
+	if (!Nan::New(AddonData::get()->trainingDataConstructorTpl)->HasInstance(info[0])) {
 		return Nan::ThrowError("Must be an instance of TrainingData");
 	}
 	TrainingData *other = Nan::ObjectWrap::Unwrap<TrainingData>(info[0].As<v8::Object>());
@@ -16,9 +16,6 @@ public:
 	// Encapsulated FANN training_data instance
 	FANN::training_data *trainingData;
 
-	// Reference to the javascript constructor FunctionTemplate
-	static Nan::Persistent<v8::FunctionTemplate> constructorFunctionTpl;
-
 private:
 
 	// Javascript Constructor.  Takes no arguments.
@@ -1,8 +1,10 @@
 #include "utils.h"
+#include <cstring>
 
 namespace fanny {
 
 std::vector<fann_type> v8ArrayToFannData(v8::Local<v8::Value> v8Array) {
+	if (isNumericTypedArray(v8Array)) return v8TypedArrayToFannData(v8Array);
 	std::vector<fann_type> result;
 	if (v8Array->IsArray()) {
 		v8::Local<v8::Array> localArray = v8Array.As<v8::Array>();
@@ -24,7 +26,7 @@ std::vector<fann_type> v8ArrayToFannData(v8::Local<v8::Value> v8Array) {
 	return result;
 }
 
-v8::Local<v8::Value> fannDataToV8Array(fann_type * data, unsigned int size) {
+v8::Local<v8::Value> fannDataToV8Array(const fann_type * data, unsigned int size) {
 	Nan::EscapableHandleScope scope;
 	v8::Local<v8::Array> v8Array = Nan::New<v8::Array>(size);
 	for (uint32_t idx = 0; idx < size; ++idx) {
@@ -45,6 +47,78 @@ v8::Local<v8::Value> fannDataSetToV8Array(fann_type ** data, unsigned int length
 	return scope.Escape(v8Array);
 }
 
+bool isFannTypedArray(v8::Local<v8::Value> value) {
+	#if defined FANNY_FIXED
+	return value->IsInt32Array();
+	#elif defined FANNY_DOUBLE
+	return value->IsFloat64Array();
+	#else
+	return value->IsFloat32Array();
+	#endif
+}
+
+bool isNumericTypedArray(v8::Local<v8::Value> value) {
+	return value->IsFloat32Array() || value->IsFloat64Array() || value->IsInt32Array();
+}
+
+template<typename T> static void appendTypedArrayContents(v8::Local<v8::Value> value, std::vector<fann_type> &result) {
+	Nan::TypedArrayContents<T> contents(value);
+	size_t length = contents.length();
+	result.reserve(result.size() + length);
+	for (size_t idx = 0; idx < length; ++idx) {
+		result.push_back((fann_type)(*contents)[idx]);
+	}
+}
+
+std::vector<fann_type> v8TypedArrayToFannData(v8::Local<v8::Value> value) {
+	std::vector<fann_type> result;
+	if (value->IsFloat32Array()) {
+		appendTypedArrayContents<float>(value, result);
+	} else if (value->IsFloat64Array()) {
+		appendTypedArrayContents<double>(value, result);
+	} else if (value->IsInt32Array()) {
+		appendTypedArrayContents<int32_t>(value, result);
+	}
+	return result;
+}
+
+bool isV8NumberArray(v8::Local<v8::Value> value) {
+	return value->IsArray() || isNumericTypedArray(value);
+}
+
+v8::Local<v8::Value> fannDataToV8TypedArray(const fann_type * data, unsigned int size) {
+	Nan::EscapableHandleScope scope;
+	v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), size * sizeof(fann_type));
+	v8::Local<FannTypedArray> typedArray = FannTypedArray::New(buffer, 0, size);
+	if (data && size) {
+		Nan::TypedArrayContents<fann_type> contents(typedArray);
+		memcpy(*contents, data, size * sizeof(fann_type));
+	}
+	return scope.Escape(typedArray);
+}
+
+v8::Local<v8::Value> newV8Uint32Array(unsigned int size) {
+	Nan::EscapableHandleScope scope;
+	v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), size * sizeof(uint32_t));
+	return scope.Escape(v8::Uint32Array::New(buffer, 0, size));
+}
+
+FannDataView::FannDataView(v8::Local<v8::Value> value) : dataPtr(NULL), dataSize(0) {
+	// Only built for matching arrays: nan asserts that the data is aligned for fann_type, which
+	// other views, such as a Uint8Array at an odd offset, needn't be
+	if (isFannTypedArray(value)) {
+		Nan::TypedArrayContents<fann_type> contents(value);
+		dataPtr = *contents;
+		dataSize = contents.length();
+		return;
+	}
+	converted = v8ArrayToFannData(value);
+	if (!converted.empty()) {
+		dataPtr = &converted[0];
+		dataSize = converted.size();
+	}
+}
+
 v8::Local<v8::Value> trainingAlgorithmEnumToV8String(FANN::training_algorithm_enum value) {
 	Nan::EscapableHandleScope scope;
 	const char *str = NULL;
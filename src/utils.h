@@ -1,15 +1,62 @@
+#ifndef FANNY_UTILS_H
+#define FANNY_UTILS_H
+
 #include "fann-includes.h"
 #include <nan.h>
 #include <vector>
 
 namespace fanny {
 
+// Converts an array (or numeric typed array) of numbers to fann_type
 std::vector<fann_type> v8ArrayToFannData(v8::Local<v8::Value> v8Array);
 
-v8::Local<v8::Value> fannDataToV8Array(fann_type * data, unsigned int size);
+// Returns true if the value is an array or a numeric typed array
+bool isV8NumberArray(v8::Local<v8::Value> value);
+
+v8::Local<v8::Value> fannDataToV8Array(const fann_type * data, unsigned int size);
 
 v8::Local<v8::Value> fannDataSetToV8Array(fann_type ** data, unsigned int length, unsigned int size);
 
+// Typed array class whose element type matches fann_type
+#if defined FANNY_FIXED
+typedef v8::Int32Array FannTypedArray;
+#elif defined FANNY_DOUBLE
+typedef v8::Float64Array FannTypedArray;
+#else
+typedef v8::Float32Array FannTypedArray;
+#endif
+
+// Returns true if the value is a typed array whose elements can be used as fann_type without conversion
+bool isFannTypedArray(v8::Local<v8::Value> value);
+
+// Returns true for any of the numeric typed arrays accepted as data (Float32Array, Float64Array, Int32Array)
+bool isNumericTypedArray(v8::Local<v8::Value> value);
+
+// Converts the contents of a numeric typed array to fann_type
+std::vector<fann_type> v8TypedArrayToFannData(v8::Local<v8::Value> value);
+
+// Creates a typed array (see FannTypedArray) of the given size, optionally copying data into it
+v8::Local<v8::Value> fannDataToV8TypedArray(const fann_type * data, unsigned int size);
+
+// Creates a zero-filled Uint32Array of the given size
+v8::Local<v8::Value> newV8Uint32Array(unsigned int size);
+
+// Read-only access to numeric data passed in from Javascript.  Typed arrays whose element
+// type matches fann_type are referenced in place, so value must outlive the view; arrays and
+// other typed arrays are converted.
+class FannDataView {
+public:
+	explicit FannDataView(v8::Local<v8::Value> value);
+
+	fann_type *data() const { return dataPtr; }
+	size_t size() const { return dataSize; }
+
+private:
+	std::vector<fann_type> converted;
+	fann_type *dataPtr;
+	size_t dataSize;
+};
+
 // Number converter
 inline fann_type v8NumberToFannType(v8::Local<v8::Value> number) {
 	fann_type fannNumber = 0;
@@ -49,3 +96,5 @@ v8::Local<v8::Value> activationFunctionEnumToV8String(FANN::activation_function_
 
 bool v8StringToActivationFunctionEnum(v8::Local<v8::Value> value, FANN::activation_function_enum &ret);
 }
+
+#endif
@@ -0,0 +1,64 @@
+#include "weight-snapshot.h"
+#include "fann-access.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace fanny {
+
+WeightSnapshot::~WeightSnapshot() {
+	delete net;
+}
+
+std::shared_ptr<WeightSnapshot> WeightSnapshot::create(FANN::neural_net *net) {
+	std::shared_ptr<WeightSnapshot> snapshot(new WeightSnapshot());
+	snapshot->net = new FANN::neural_net(*net);
+	return snapshot;
+}
+
+WeightSnapshot::Executor::Executor(const std::shared_ptr<WeightSnapshot> &_snapshot) : snapshot(_snapshot), privateBytes(0) {
+	struct fann *src = getFannStruct(snapshot->net);
+	struct fann_neuron *srcNeurons = src->first_layer->first_neuron;
+	size_t numLayers = src->last_layer - src->first_layer;
+
+	// Everything fann_run() reads but doesn't write is shared with the snapshot
+	ann = (struct fann *)malloc(sizeof(struct fann));
+	*ann = *src;
+	ann->errno_f = FANN_E_NO_ERROR;
+	ann->errstr = NULL;
+	ann->user_data = NULL;
+
+	struct fann_neuron *neurons = (struct fann_neuron *)malloc(src->total_neurons * sizeof(struct fann_neuron));
+	memcpy(neurons, srcNeurons, src->total_neurons * sizeof(struct fann_neuron));
+	ann->first_layer = (struct fann_layer *)malloc(numLayers * sizeof(struct fann_layer));
+	ann->last_layer = ann->first_layer + numLayers;
+	for (size_t l = 0; l < numLayers; l++) {
+		ann->first_layer[l].first_neuron = neurons + (src->first_layer[l].first_neuron - srcNeurons);
+		ann->first_layer[l].last_neuron = neurons + (src->first_layer[l].last_neuron - srcNeurons);
+	}
+	ann->output = (fann_type *)calloc(src->num_output, sizeof(fann_type));
+	privateBytes = sizeof(struct fann) + src->total_neurons * sizeof(struct fann_neuron) +
+		numLayers * sizeof(struct fann_layer) + src->num_output * sizeof(fann_type);
+
+	// Sparse networks read source values through pointers into the neuron array
+	if (src->connection_rate < 1) {
+		ann->connections = (struct fann_neuron **)malloc(src->total_connections * sizeof(struct fann_neuron *));
+		for (unsigned int i = 0; i < src->total_connections; i++) {
+			ann->connections[i] = neurons + (src->connections[i] - srcNeurons);
+		}
+		privateBytes += src->total_connections * sizeof(struct fann_neuron *);
+	}
+}
+
+WeightSnapshot::Executor::~Executor() {
+	if (ann) {
+		if (ann->connections != getFannStruct(snapshot->net)->connections) free(ann->connections);
+		free(ann->first_layer->first_neuron);
+		free(ann->first_layer);
+		free(ann->output);
+		free(ann);
+		// Keeps ~neural_net() from destroying the shared parts
+		ann = NULL;
+	}
+}
+
+}
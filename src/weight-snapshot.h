@@ -0,0 +1,47 @@
+#ifndef FANNY_WEIGHT_SNAPSHOT_H
+#define FANNY_WEIGHT_SNAPSHOT_H
+
+#include "fann-includes.h"
+#include <cstddef>
+#include <memory>
+
+namespace fanny {
+
+// A read-only copy of a FANN network taken at one point in time, shared by reference count between
+// any number of executors that run it concurrently.  The snapshot itself is never run or changed, so
+// it stays valid however the original network is trained or edited afterwards.
+class WeightSnapshot {
+public:
+	~WeightSnapshot();
+
+	static std::shared_ptr<WeightSnapshot> create(FANN::neural_net *net);
+
+	// A FANN network that runs the snapshot with fann_run().  Its layers, neurons and outputs are its
+	// own, so each executor holds only one run's worth of activations; weights, and for fully
+	// connected networks connections, are the snapshot's.  Only run() may be used on it.  It keeps the
+	// snapshot alive until it's deleted.
+	class Executor : public FANN::neural_net {
+	public:
+		explicit Executor(const std::shared_ptr<WeightSnapshot> &snapshot);
+		~Executor();
+		// Bytes allocated by this executor, not counting the shared snapshot
+		size_t getPrivateBytes() const { return privateBytes; }
+	private:
+		Executor(const Executor &);
+		Executor &operator=(const Executor &);
+
+		std::shared_ptr<WeightSnapshot> snapshot;
+		size_t privateBytes;
+	};
+
+private:
+	WeightSnapshot() : net(NULL) {}
+	WeightSnapshot(const WeightSnapshot &);
+	WeightSnapshot &operator=(const WeightSnapshot &);
+
+	FANN::neural_net *net;
+};
+
+}
+
+#endif
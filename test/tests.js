@@ -57,6 +57,98 @@ describe('Tests', function() {
 			});
 	});
 
+	it('parallel batch training test', function() {
+		var ann = createANN({ layers: [ 2, 20, 5 ] }, { trainingAlgorithm: 'RPROP' });
+		var single = ann.clone();
+		return Promise.all([
+			ann.train(booleanTrainingData, { maxEpochs: 20, desiredError: 0, threads: 3 }),
+			single.train(booleanTrainingData, { maxEpochs: 20, desiredError: 0 })
+		])
+			.then(function() {
+				// Only the order slopes are summed in differs from single-threaded training
+				var parallelConnections = ann.getConnectionArray();
+				var singleConnections = single.getConnectionArray();
+				for (var i = 0; i < parallelConnections.length; i++) {
+					expect(parallelConnections[i].weight).to.be.closeTo(singleConnections[i].weight, 1e-3);
+				}
+				return ann.train(booleanTrainingData, { desiredError: 0, stopFunction: 'BIT', threads: 2 });
+			})
+			.then(function() {
+				expect(booleanThreshold(ann.run([ 1, 1 ]))).to.deep.equal([ 1, 1, 0, 0, 0 ]);
+				expect(booleanThreshold(ann.run([ 1, 0 ]))).to.deep.equal([ 0, 1, 1, 0, 1 ]);
+				return ann.train(booleanTrainingData, { maxEpochs: 1, threads: 0 });
+			})
+			.then(function() {
+				throw new Error('Expected rejection');
+			}, function(err) {
+				expect(err).to.be.an.instanceof(XError);
+			});
+	});
+
+	it('hogwild training test', function() {
+		var ann = createANN({ layers: [ 2, 20, 5 ] }, { trainingAlgorithm: 'INCREMENTAL' });
+		var data = createTrainingData(booleanTrainingData);
+		var initialMSE;
+		return ann.testData(data)
+			.then(function(mse) {
+				initialMSE = mse;
+				return ann.train(data, { maxEpochs: 200, desiredError: 0, threads: 2, hogwild: true });
+			})
+			.then(function() {
+				return ann.testData(data);
+			})
+			.then(function(mse) {
+				expect(mse).to.be.below(initialMSE);
+				ann.setOption('trainingAlgorithm', 'RPROP');
+				return ann.train(data, { maxEpochs: 1, threads: 2, hogwild: true });
+			})
+			.then(function() {
+				throw new Error('Expected rejection');
+			}, function(err) {
+				expect(err).to.be.an.instanceof(XError);
+			});
+	});
+
+	it('minibatch training test', function() {
+		var ann = createANN({ layers: [ 2, 20, 5 ] }, { trainingAlgorithm: 'MINIBATCH', batchSize: 2 });
+		expect(ann.getOption('trainingAlgorithm')).to.equal('MINIBATCH');
+		expect(ann.getOption('batchSize')).to.equal(2);
+		var data = createTrainingData(booleanTrainingData);
+		var initialMSE;
+		return ann.testData(data)
+			.then(function(mse) {
+				initialMSE = mse;
+				return ann.train(data, { maxEpochs: 200, desiredError: 0 });
+			})
+			.then(function() {
+				return ann.testData(data);
+			})
+			.then(function(mse) {
+				expect(mse).to.be.below(initialMSE);
+			});
+	});
+
+	it('minibatch survives save and load', function() {
+		var ann = createANN({ layers: [ 2, 5, 2 ] }, { trainingAlgorithm: 'MINIBATCH', batchSize: 5 });
+		ann.userData.foo = 'bar';
+		return ann.save('/tmp/fanny_test_minibatch')
+			.then(function() {
+				expect(JSON.parse(ann.getOption('userDataString'))).to.deep.equal({ foo: 'bar' });
+				return fanny.loadANN('/tmp/fanny_test_minibatch');
+			})
+			.then(function(loaded) {
+				expect(loaded.getOption('trainingAlgorithm')).to.equal('MINIBATCH');
+				expect(loaded.getOption('batchSize')).to.equal(5);
+				expect(loaded.userData).to.deep.equal({ foo: 'bar' });
+				ann.setOption('userDataString', 'not json');
+				return ann.save('/tmp/fanny_test_minibatch');
+			})
+			.then(function() {
+				throw new Error('Expected rejection');
+			}, function(err) {
+				expect(err).to.be.an.instanceof(XError);
+			});
+	});
 
 	it('user data', function() {
 		var ann = createANN({ layers: [ 2, 5, 2 ] });
@@ -563,6 +655,570 @@ describe('Tests', function() {
 		});
 	});
 
+	describe('Batch Running', function() {
+		it('runBatch matches run', function() {
+			var ann = createANN({ layers: [ 2, 3, 5 ] });
+			var inputs = new Float32Array([ 1, 0, 0, 1, 1, 1 ]);
+			var outputs = ann.runBatch(inputs, 3);
+			expect(outputs).to.be.an.instanceof(Float32Array).to.have.a.lengthOf(15);
+			for (var i = 0; i < 3; i++) {
+				var single = ann.run([ inputs[i * 2], inputs[i * 2 + 1] ]);
+				for (var j = 0; j < 5; j++) {
+					expect(outputs[i * 5 + j]).to.be.closeTo(single[j], 1e-6);
+				}
+			}
+		});
+		it('runBatchAsync matches runBatch', function() {
+			var ann = createANN({ layers: [ 2, 3, 5 ] });
+			var inputs = new Float64Array([ 1, 0, 0, 1 ]);
+			var expected = ann.runBatch(inputs);
+			return ann.runBatchAsync(inputs)
+				.then(function(outputs) {
+					expect(Array.prototype.slice.call(outputs)).to.deep.equal(Array.prototype.slice.call(expected));
+				});
+		});
+		it('runBatch rejects the wrong number of inputs', function() {
+			var ann = createANN({ layers: [ 2, 3, 5 ] });
+			expect(function() { ann.runBatch(new Float32Array(3), 2); }).to.throw(XError);
+		});
+	});
+
+	describe('Output Reductions', function() {
+		var inputs = [ [ 0, 0 ], [ 0, 1 ], [ 1, 0 ], [ 0.3, -0.7 ] ];
+		function ranked(outputs) {
+			return outputs.map(function(value, index) { return index; }).sort(function(a, b) {
+				return (outputs[b] - outputs[a]) || (a - b);
+			});
+		}
+		it('reduces single runs', function() {
+			var ann = createANN({ layers: [ 2, 4, 40 ] });
+			inputs.forEach(function(input) {
+				var outputs = ann.run(input);
+				var order = ranked(outputs);
+				expect(ann.runArgmax(input)).to.equal(order[0]);
+				expect(ann.runTopK(input, 5)).to.deep.equal(order.slice(0, 5));
+				var threshold = outputs[order[10]];
+				var mask = ann.runThreshold(input, threshold);
+				expect(mask).to.be.an.instanceof(Uint32Array).to.have.a.lengthOf(2);
+				for (var i = 0; i < 40; i++) {
+					expect(!!(mask[i >> 5] & (1 << (i & 31)))).to.equal(outputs[i] >= threshold);
+				}
+			});
+		});
+		it('reduces batches', function() {
+			var ann = createANN({ layers: [ 2, 4, 40 ] });
+			var batch = new Float32Array([].concat.apply([], inputs));
+			var argmax = ann.runBatchArgmax(batch);
+			var topK = ann.runBatchTopK(batch, 3);
+			var masks = ann.runBatchThreshold(batch, 0.5);
+			expect(argmax).to.be.an.instanceof(Uint32Array).to.have.a.lengthOf(4);
+			expect(topK).to.have.a.lengthOf(12);
+			expect(masks).to.have.a.lengthOf(8);
+			inputs.forEach(function(input, run) {
+				expect(argmax[run]).to.equal(ann.runArgmax(input));
+				expect(Array.prototype.slice.call(topK, run * 3, run * 3 + 3)).to.deep.equal(ann.runTopK(input, 3));
+				expect(Array.prototype.slice.call(masks, run * 2, run * 2 + 2)).to.deep.equal(Array.prototype.slice.call(ann.runThreshold(input, 0.5)));
+			});
+		});
+		it('rejects invalid k', function() {
+			var ann = createANN({ layers: [ 2, 3, 5 ] });
+			expect(function() { ann.runTopK([ 0, 1 ], 0); }).to.throw(XError);
+			expect(function() { ann.runTopK([ 0, 1 ], 6); }).to.throw(XError);
+		});
+	});
+
+	describe('Concurrent Running', function() {
+		it('concurrent runAsync calls match run', function() {
+			var ann = createANN({ layers: [ 2, 3, 5 ] }, { runConcurrency: 4 });
+			var inputs = [ [ 0, 0 ], [ 0, 1 ], [ 1, 0 ], [ 1, 1 ], [ 0.5, 0.5 ], [ 0.2, 0.9 ] ];
+			var expected = inputs.map(function(input) { return ann.run(input); });
+			return Promise.all(inputs.map(function(input) { return ann.runAsync(input); }))
+				.then(function(results) {
+					expect(results).to.deep.equal(expected);
+				});
+		});
+		it('replicas pick up weight changes', function() {
+			var ann = createANN({ layers: [ 2, 3, 5 ] }, { runConcurrency: 2 });
+			return Promise.all([ ann.runAsync([ 1, 0 ]), ann.runAsync([ 0, 1 ]) ])
+				.then(function() {
+					ann.randomizeWeights(-1, 1);
+					var expected = ann.run([ 1, 0 ]);
+					return Promise.all([ ann.runAsync([ 1, 0 ]), ann.runAsync([ 1, 0 ]) ])
+						.then(function(results) {
+							expect(results[0]).to.deep.equal(expected);
+							expect(results[1]).to.deep.equal(expected);
+						});
+				});
+		});
+		it('replicas run sparse and shortcut networks and clones', function() {
+			var inputs = [ [ 0, 0 ], [ 0, 1 ], [ 1, 0 ], [ 1, 1 ], [ 0.5, 0.5 ], [ 0.2, 0.9 ] ];
+			var sparse = createANN({ layers: [ 2, 30, 5 ], type: 'sparse', connectionRate: 0.3 }, { runConcurrency: 3 });
+			var shortcut = createANN({ layers: [ 2, 4, 4, 5 ], type: 'shortcut' }, { runConcurrency: 3 });
+			shortcut.randomizeWeights(-1, 1);
+			var anns = [ sparse, shortcut, sparse.clone(), shortcut.clone() ];
+			return Promise.all(anns.map(function(ann) {
+				var expected = inputs.map(function(input) { return ann.run(input); });
+				return Promise.all(inputs.map(function(input) { return ann.runAsync(input); }))
+					.then(function(results) {
+						expect(results).to.deep.equal(expected);
+					});
+			}));
+		});
+	});
+
+	describe('Micro-batching', function() {
+		it('batches concurrent runAsync calls', function() {
+			var ann = createANN({ layers: [ 2, 3, 5 ] });
+			var inputs = [ [ 0, 0 ], [ 0, 1 ], [ 1, 0 ], [ 1, 1 ], [ 0.5, 0.5 ] ];
+			var expected = inputs.map(function(input) { return ann.run(input); });
+			ann.enableMicroBatching({ maxBatchSize: 4, maxWait: 0 });
+			return Promise.all(inputs.map(function(input) { return ann.runAsync(input); }))
+				.then(function(results) {
+					for (var i = 0; i < inputs.length; i++) {
+						expect(results[i]).to.have.a.lengthOf(5);
+						for (var j = 0; j < 5; j++) expect(results[i][j]).to.be.closeTo(expected[i][j], 1e-6);
+					}
+					var stats = ann.getMicroBatchingStats();
+					expect(stats.requests).to.equal(5);
+					expect(stats.batches).to.equal(2);
+					expect(stats.maxBatchSize).to.equal(4);
+					ann.disableMicroBatching();
+					expect(ann.getMicroBatchingStats()).to.equal(null);
+				});
+		});
+		it('rejects invalid inputs', function() {
+			var ann = createANN({ layers: [ 2, 3, 5 ] });
+			ann.enableMicroBatching();
+			return ann.runAsync([ 1, 2, 3 ])
+				.then(function() {
+					throw new Error('Expected rejection');
+				}, function(err) {
+					expect(err).to.be.an.instanceof(XError);
+				});
+		});
+	});
+
+	describe('Ensembles', function() {
+		var inputs = [ [ 0, 0 ], [ 0, 1 ], [ 1, 0 ], [ 0.3, -0.7 ] ];
+		function createMembers() {
+			return [ 0, 1, 2 ].map(function() { return createANN({ layers: [ 2, 5, 3 ] }); });
+		}
+		it('averages member outputs', function() {
+			var anns = createMembers();
+			var ensemble = fanny.createEnsemble(anns, { weights: [ 1, 2, 1 ] });
+			expect(ensemble.info).to.deep.equal({ numMembers: 3, numInput: 2, numOutput: 3 });
+			inputs.forEach(function(input) {
+				var memberOutputs = anns.map(function(ann) { return ann.run(input); });
+				var mean = ensemble.run(input);
+				var weighted = ensemble.run(input, 'weighted');
+				for (var j = 0; j < 3; j++) {
+					var sum = memberOutputs[0][j] + memberOutputs[1][j] + memberOutputs[2][j];
+					expect(mean[j]).to.be.closeTo(sum / 3, 1e-6);
+					expect(weighted[j]).to.be.closeTo((sum + memberOutputs[1][j]) / 4, 1e-6);
+				}
+				expect(ensemble.run(input, 'all')).to.deep.equal(memberOutputs);
+			});
+		});
+		it('runs batches across threads', function() {
+			var anns = createMembers();
+			var ensemble = fanny.createEnsemble(anns);
+			var batch = new Float32Array([].concat.apply([], inputs));
+			var expected = ensemble.runBatch(batch, inputs.length, 'all');
+			expect(expected.length).to.equal(inputs.length * 9);
+			return ensemble.runBatchAsync(batch, inputs.length, { mode: 'all', threads: 3 })
+				.then(function(outputs) {
+					expect(Array.prototype.slice.call(outputs)).to.deep.equal(Array.prototype.slice.call(expected));
+					return ensemble.runAsync(inputs[1], { threads: 2 });
+				})
+				.then(function(outputs) {
+					expect(outputs).to.deep.equal(ensemble.run(inputs[1]));
+				});
+		});
+		it('rejects mismatched members', function() {
+			expect(function() {
+				fanny.createEnsemble([ createANN({ layers: [ 2, 3 ] }), createANN({ layers: [ 3, 3 ] }) ]);
+			}).to.throw(XError);
+			expect(function() { fanny.createEnsemble([]); }).to.throw(XError);
+		});
+	});
+
+	describe('Stream Running', function() {
+		it('runs records written to a run stream in order', function() {
+			var ann = createANN({ layers: [ 2, 8, 3 ] });
+			var inputs = [];
+			for (var i = 0; i < 50; i++) inputs.push([ i / 50, 1 - i / 50 ]);
+			var stream = ann.createRunStream({ batchSize: 8 });
+			var outputs = [];
+			return new Promise(function(resolve, reject) {
+				stream.on('data', function(output) { outputs.push(output); });
+				stream.on('end', resolve);
+				stream.on('error', reject);
+				inputs.forEach(function(input) { stream.write(input); });
+				stream.end();
+			}).then(function() {
+				expect(outputs.length).to.equal(inputs.length);
+				inputs.forEach(function(input, i) {
+					var expected = ann.run(input);
+					for (var j = 0; j < 3; j++) expect(outputs[i][j]).to.be.closeTo(expected[j], 1e-6);
+				});
+			});
+		});
+		it('rejects records of the wrong size', function() {
+			var stream = createANN({ layers: [ 2, 3 ] }).createRunStream();
+			return new Promise(function(resolve) {
+				stream.on('error', resolve);
+				stream.write([ 1, 2, 3 ]);
+			}).then(function(err) {
+				expect(err).to.be.an.instanceof(XError);
+			});
+		});
+		it('validates options', function() {
+			var ann = createANN({ layers: [ 2, 3 ] });
+			expect(function() { ann.createRunStream({ batchSize: 0 }); }).to.throw(XError);
+		});
+	});
+
+	describe('Typed Array Data', function() {
+		it('run accepts typed array inputs', function() {
+			var ann = createANN({ layers: [ 2, 3, 5 ] });
+			var expected = ann.run([ 1, 0 ]);
+			var outputs = ann.run(new Float32Array([ 1, 0 ]));
+			expect(outputs).to.be.an.instanceof(Array).to.have.a.lengthOf(5);
+			for (var i = 0; i < 5; i++) expect(outputs[i]).to.be.closeTo(expected[i], 1e-6);
+		});
+		it('runInto fills the output buffer', function() {
+			var ann = createANN({ layers: [ 2, 3, 5 ] });
+			var expected = ann.run([ 0, 1 ]);
+			var buffer = new Float32Array(5);
+			expect(ann.runInto(new Float32Array([ 0, 1 ]), buffer)).to.equal(buffer);
+			for (var i = 0; i < 5; i++) expect(buffer[i]).to.be.closeTo(expected[i], 1e-6);
+			expect(function() { ann.runInto([ 0, 1 ], new Float32Array(2)); }).to.throw(XError);
+		});
+		it('trainOne accepts typed arrays', function() {
+			var ann = createANN({ layers: [ 2, 3, 1 ] });
+			ann.trainOne(new Float32Array([ 1, 0 ]), new Float32Array([ 1 ]));
+		});
+		it('converts typed arrays not aligned for the datatype', function() {
+			// Float32Array and Int32Array views at an offset of 4 bytes aren't aligned for doubles
+			var ann = createANN({ layers: [ 2, 3, 5 ], datatype: 'double' });
+			var expected = ann.run([ 1, 0 ]);
+			var floats = new Float32Array(new ArrayBuffer(12), 4, 2);
+			floats.set([ 1, 0 ]);
+			var ints = new Int32Array(new ArrayBuffer(12), 4, 2);
+			ints.set([ 1, 0 ]);
+			[ floats, ints ].forEach(function(inputs) {
+				var outputs = ann.run(inputs);
+				for (var i = 0; i < 5; i++) expect(outputs[i]).to.be.closeTo(expected[i], 1e-6);
+			});
+			expect(function() { ann.run(new Uint8Array(new ArrayBuffer(3), 1, 2)); }).to.throw();
+		});
+	});
+
+	describe('SIMD Engine', function() {
+		var inputs = [ [ 0, 0 ], [ 0, 1 ], [ 1, 0 ], [ 1, 1 ], [ 0.3, -0.7 ] ];
+		function expectSameOutputs(ann) {
+			var expected = inputs.map(function(input) { return ann.run(input); });
+			ann.setOption('engine', 'simd');
+			inputs.forEach(function(input, i) {
+				var outputs = ann.run(input);
+				for (var j = 0; j < outputs.length; j++) expect(outputs[j]).to.be.closeTo(expected[i][j], 1e-5);
+			});
+			ann.setOption('engine', 'fann');
+		}
+		it('matches FANN for standard networks', function() {
+			var ann = createANN({ layers: [ 2, 67, 130, 5 ], activationFunctions: { hidden: 'SIGMOID_SYMMETRIC' } });
+			ann.randomizeWeights(-0.2, 0.2);
+			expectSameOutputs(ann);
+		});
+		it('matches FANN for sparse networks', function() {
+			var ann = createANN({ layers: [ 2, 60, 40, 5 ], type: 'sparse', connectionRate: 0.1 });
+			expect(ann.info.totalConnections).to.be.below(1000);
+			expectSameOutputs(ann);
+			expectSameOutputs(createANN({ layers: [ 2, 10, 5 ], type: 'sparse', connectionRate: 0.5 }));
+		});
+		it('matches FANN for shortcut and cascade trained networks', function() {
+			var ann = createANN({ layers: [ 2, 3, 3, 3, 2, 5 ], type: 'shortcut' });
+			ann.randomizeWeights(-0.5, 0.5);
+			expectSameOutputs(ann);
+			var cascade = createANN({ layers: [ 2, 5 ], type: 'shortcut' });
+			return cascade.train(booleanTrainingData, { desiredError: 0, cascade: true, maxNeurons: 20 })
+				.then(function() {
+					expect(cascade.info.numLayers).to.be.above(3);
+					expectSameOutputs(cascade);
+				});
+		});
+		it('picks up weight changes in asynchronous runs', function() {
+			var ann = createANN({ layers: [ 2, 20, 5 ] }, { engine: 'simd', runConcurrency: 2 });
+			return ann.runAsync([ 1, 0 ])
+				.then(function() {
+					ann.randomizeWeights(-1, 1);
+					var expected = ann.run([ 1, 0 ]);
+					return Promise.all([ ann.runAsync([ 1, 0 ]), ann.runBatchAsync(new Float32Array([ 1, 0 ]), 1) ])
+						.then(function(results) {
+							for (var j = 0; j < 5; j++) {
+								expect(results[0][j]).to.be.closeTo(expected[j], 1e-6);
+								expect(results[1][j]).to.be.closeTo(expected[j], 1e-6);
+							}
+						});
+				});
+		});
+		it('runs batches the same as single runs', function() {
+			var ann = createANN({ layers: [ 3, 40, 7 ] }, { engine: 'simd' });
+			var numRuns = 70;
+			var inputs = new Float32Array(numRuns * 3);
+			for (var i = 0; i < inputs.length; i++) inputs[i] = Math.sin(i);
+			var outputs = ann.runBatch(inputs, numRuns);
+			for (var run = 0; run < numRuns; run++) {
+				var single = ann.run(inputs.subarray(run * 3, run * 3 + 3));
+				for (var j = 0; j < 7; j++) expect(outputs[run * 7 + j]).to.equal(single[j]);
+			}
+		});
+		it('tests data the same as FANN', function() {
+			var data = createTrainingData(booleanTrainingData);
+			var ann = createANN({ layers: [ 2, 30, 5 ] });
+			var expectedMSE;
+			return ann.testData(data)
+				.then(function(mse) {
+					expectedMSE = mse;
+					ann.setOption('engine', 'simd');
+					return ann.testData(data);
+				})
+				.then(function(mse) {
+					expect(mse).to.be.closeTo(expectedMSE, 1e-6);
+					expect(ann.getMSE()).to.be.closeTo(expectedMSE, 1e-6);
+				});
+		});
+		it('fast activations are close to exact ones', function() {
+			var functions = [ 'SIGMOID', 'SIGMOID_SYMMETRIC', 'GAUSSIAN', 'ELLIOT', 'SIN', 'COS_SYMMETRIC', 'SIGMOID_STEPWISE' ];
+			functions.forEach(function(fn) {
+				var ann = createANN({ layers: [ 2, 40, 5 ], activationFunctions: { hidden: fn, output: fn } }, { engine: 'simd' });
+				ann.randomizeWeights(-2, 2);
+				var expected = inputs.map(function(input) { return ann.run(input); });
+				ann.setOption('activationMode', 'fast');
+				inputs.forEach(function(input, i) {
+					var outputs = ann.run(input);
+					for (var j = 0; j < outputs.length; j++) expect(outputs[j]).to.be.closeTo(expected[i][j], 1e-5);
+				});
+			});
+		});
+		it('runs fixed point networks the same as FANN', function() {
+			var floatAnn = createANN({ layers: [ 20, 37, 9 ], activationFunctions: { hidden: 'SIGMOID_SYMMETRIC', output: 'LINEAR' } });
+			floatAnn.randomizeWeights(-0.5, 0.5);
+			return floatAnn.save('/tmp/fanny_test_fixed', true)
+				.then(function() { return loadANN('/tmp/fanny_test_fixed', 'fixed'); })
+				.then(function(ann) {
+					expect(ann.info.multiplier).to.equal(Math.pow(2, ann.info.decimalPoint));
+					var numRuns = 10;
+					var batch = new Int32Array(numRuns * 20);
+					for (var i = 0; i < batch.length; i++) batch[i] = Math.round(Math.sin(i) * ann.info.multiplier);
+					var expected = ann.runBatch(batch, numRuns);
+					ann.setOption('engine', 'simd');
+					expect(Array.prototype.slice.call(ann.runBatch(batch, numRuns))).to.deep.equal(Array.prototype.slice.call(expected));
+					expect(ann.run(batch.subarray(0, 20))).to.deep.equal(Array.prototype.slice.call(expected, 0, 9));
+				});
+		});
+		it('quantizes to int8 with a small error', function() {
+			var data = createTrainingData(booleanTrainingData);
+			var ann = createANN({ layers: [ 2, 30, 5 ] });
+			var expected = inputs.map(function(input) { return ann.run(input); });
+			var report = ann.quantize(data);
+			expect(ann.getOption('engine')).to.equal('int8');
+			expect(report.numSamples).to.equal(4);
+			expect(report.maxError).to.be.below(0.05);
+			inputs.slice(0, 4).forEach(function(input, i) {
+				var outputs = ann.run(input);
+				for (var j = 0; j < 5; j++) expect(outputs[j]).to.be.closeTo(expected[i][j], report.maxError + 1e-6);
+			});
+			// Once the weights change, runs go through FANN
+			ann.randomizeWeights(-1, 1);
+			expect(ann.getOption('engine')).to.equal('fann');
+			var fannCopy = ann.clone();
+			fannCopy.setOption('engine', 'fann');
+			expect(ann.run([ 0, 1 ])).to.deep.equal(fannCopy.run([ 0, 1 ]));
+		});
+		it('stores wide quantized layers in about a quarter of the memory', function() {
+			var ann = createANN({ layers: [ 2, 256, 256, 5 ], datatype: 'float' });
+			var report = ann.quantize(createTrainingData(booleanTrainingData));
+			// The int8 weights plus a scale and bias sum per neuron, against 4 byte weights
+			expect(report.quantizedWeightBytes).to.be.below(report.floatWeightBytes * 0.3);
+		});
+		it('runs small networks with specialized kernels', function() {
+			var ann = createANN({ layers: [ 8, 16, 4 ], activationFunctions: { hidden: 'SIGMOID_SYMMETRIC' } });
+			ann.randomizeWeights(-1, 1);
+			ann.setOption('engine', 'fann');
+			expect(ann.info.specializedKernel).to.equal('8-16-4');
+			var input = [ 0.1, -0.2, 0.3, -0.4, 0.5, -0.6, 0.7, -0.8 ];
+			// test() always goes through fann_run()
+			expect(ann.run(input)).to.deep.equal(ann.test(input, [ 0, 0, 0, 0 ]));
+			expect(createANN({ layers: [ 3, 5, 2 ] }).info.specializedKernel).to.equal(null);
+		});
+		it('reports the SIMD level', function() {
+			expect([ 'scalar', 'sse2', 'avx2', 'avx512' ]).to.include(fanny.getSimdLevel());
+		});
+	});
+
+	describe('Code Generation', function() {
+		it('generates source for a network', function() {
+			var ann = createANN({ layers: [ 2, 8, 5 ] });
+			var source = ann.generateSource('xorNet');
+			expect(source).to.contain('namespace xorNet');
+			expect(source).to.contain('const unsigned int numInput = 2;');
+			expect(function() { ann.generateSource('not a name'); }).to.throw(XError);
+		});
+		it('builds a module matching the network', function() {
+			this.timeout(120000);
+			var ann = createANN({ layers: [ 2, 8, 5 ], activationFunctions: { hidden: 'SIGMOID_SYMMETRIC' } });
+			var dir = require('path').join(require('os').tmpdir(), 'fanny-codegen-' + process.pid);
+			return fanny.buildGeneratedModule(ann, { dir: dir, name: 'testNet' })
+				.then(function(modulePath) {
+					var generated = require(modulePath);
+					expect(generated.numInput).to.equal(2);
+					expect(generated.numOutput).to.equal(5);
+					[ [ 0, 0 ], [ 0, 1 ], [ 1, 0 ], [ 1, 1 ], [ 0.3, -0.7 ] ].forEach(function(input) {
+						var expected = ann.run(input);
+						var outputs = generated.run(input);
+						for (var j = 0; j < 5; j++) expect(outputs[j]).to.be.closeTo(expected[j], 1e-5);
+					});
+				});
+		});
+	});
+
+	describe('Shared Models', function() {
+		var hasSharedArrayBuffer = typeof SharedArrayBuffer !== 'undefined';
+		it('attaches to exported weights read-only', function() {
+			if (!hasSharedArrayBuffer) return this.skip();
+			var ann = createANN({ layers: [ 2, 6, 3 ], activationFunctions: { hidden: 'SIGMOID_SYMMETRIC' } });
+			var attached = fanny.attachANN(ann.exportShared());
+			expect(attached.info.shared).to.equal(true);
+			expect(ann.info.shared).to.equal(false);
+			[ [ 0, 0 ], [ 0, 1 ], [ 1, 0 ], [ 0.3, -0.7 ] ].forEach(function(input) {
+				expect(attached.run(input)).to.deep.equal(ann.run(input));
+			});
+			expect(function() { attached.randomizeWeights(-1, 1); }).to.throw(XError);
+			var copy = attached.clone();
+			expect(copy.info.shared).to.equal(false);
+			copy.randomizeWeights(-1, 1);
+			expect(function() { fanny.attachANN(new SharedArrayBuffer(16)); }).to.throw(XError);
+		});
+		it('rejects exported buffers with corrupted offsets', function() {
+			if (!hasSharedArrayBuffer) return this.skip();
+			var ann = createANN({ layers: [ 2, 6, 3 ] });
+			// The header's offsets start after ten 32-bit fields: layers, neurons, connections, weights
+			[ 10, 12, 14, 16 ].forEach(function(index) {
+				var buffer = ann.exportShared();
+				new Uint32Array(buffer)[index] = 0x7ffffff0;
+				expect(function() { fanny.attachANN(buffer); }).to.throw(XError);
+			});
+			var buffer = ann.exportShared();
+			new Uint32Array(buffer)[12] += 8;
+			expect(function() { fanny.attachANN(buffer); }).to.throw(XError);
+		});
+		it('runs a shared model in worker threads', function() {
+			var workerThreads;
+			try {
+				workerThreads = require('worker_threads');
+			} catch (ex) {
+				return this.skip();
+			}
+			var ann = createANN({ layers: [ 2, 6, 3 ] });
+			var buffer = ann.exportShared();
+			var inputs = [ [ 0, 0 ], [ 0, 1 ], [ 1, 0 ], [ 0.3, -0.7 ] ];
+			var expected = inputs.map(function(input) { return ann.run(input); });
+			var code = 'var wt = require("worker_threads");' +
+				'var attached = require(' + JSON.stringify(require('path').join(__dirname, '../lib')) + ').attachANN(wt.workerData.buffer);' +
+				'wt.parentPort.postMessage(wt.workerData.inputs.map(function(input) { return attached.run(input); }));';
+			return Promise.all([ 0, 1 ].map(function() {
+				return new Promise(function(resolve, reject) {
+					var worker = new workerThreads.Worker(code, { eval: true, workerData: { buffer: buffer, inputs: inputs } });
+					worker.on('message', resolve);
+					worker.on('error', reject);
+				});
+			})).then(function(results) {
+				results.forEach(function(outputs) {
+					expect(outputs).to.deep.equal(expected);
+				});
+			});
+		});
+	});
+
+	describe('Prediction Cache', function() {
+		it('returns cached outputs for repeated inputs', function() {
+			var ann = createANN({ layers: [ 2, 4, 3 ] });
+			var expected = ann.run([ 0.25, -0.5 ]);
+			ann.setOption('predictionCache', { maxBytes: 1 << 16 });
+			expect(ann.getOption('predictionCache')).to.deep.equal({ maxBytes: 1 << 16, quantum: 0 });
+			expect(ann.run([ 0.25, -0.5 ])).to.deep.equal(expected);
+			expect(ann.run([ 0.25, -0.5 ])).to.deep.equal(expected);
+			var stats = ann.getPredictionCacheStats();
+			expect(stats.hits).to.equal(1);
+			expect(stats.misses).to.equal(1);
+			expect(stats.entries).to.equal(1);
+			var batch = new Float32Array([ 0.25, -0.5, 1, 1, 0.25, -0.5 ]);
+			var outputs = ann.runBatch(batch, 3);
+			expect(Array.prototype.slice.call(outputs, 0, 3)).to.deep.equal(Array.prototype.slice.call(outputs, 6, 9));
+			expect(ann.getPredictionCacheStats().hits).to.equal(3);
+			return ann.runAsync([ 1, 1 ]).then(function(result) {
+				expect(result).to.deep.equal(Array.prototype.slice.call(outputs, 3, 6));
+				expect(ann.getPredictionCacheStats().hits).to.equal(4);
+				ann.resetPredictionCacheStats();
+				expect(ann.getPredictionCacheStats().hits).to.equal(0);
+				// -0 shares an entry with 0
+				ann.run([ 0, 0.5 ]);
+				ann.run([ -0, 0.5 ]);
+				expect(ann.getPredictionCacheStats().hits).to.equal(1);
+			});
+		});
+		it('is cleared when the weights change', function() {
+			var ann = createANN({ layers: [ 2, 4, 3 ] });
+			ann.setOption('predictionCache', { maxBytes: 1 << 16 });
+			ann.run([ 0.25, -0.5 ]);
+			ann.randomizeWeights(-0.5, 0.5);
+			expect(ann.getPredictionCacheStats().entries).to.equal(0);
+			var expected = ann.run([ 0.25, -0.5 ]);
+			var connection = ann.getConnectionArray()[0];
+			ann.setWeight(connection.fromNeuron, connection.toNeuron, connection.weight + 1);
+			expect(ann.run([ 0.25, -0.5 ])).to.not.deep.equal(expected);
+			expect(ann.getPredictionCacheStats().hits).to.equal(0);
+		});
+		it('shares entries between nearby inputs with a quantum', function() {
+			var ann = createANN({ layers: [ 2, 4, 3 ] });
+			ann.setOption('predictionCache', { maxBytes: 1 << 16, quantum: 0.01 });
+			var first = ann.run([ 0.5, 0.5 ]);
+			expect(ann.run([ 0.501, 0.499 ])).to.deep.equal(first);
+			expect(ann.getPredictionCacheStats().hits).to.equal(1);
+			ann.setOption('predictionCache', { maxBytes: 0 });
+			expect(ann.getPredictionCacheStats().maxBytes).to.equal(0);
+		});
+	});
+
+	describe('Latency Stats', function() {
+		it('records runs and training epochs', function() {
+			var ann = createANN({ layers: [ 2, 4, 5 ] });
+			expect(ann.getStats()).to.equal(null);
+			ann.setOption('collectStats', true);
+			ann.run([ 0, 1 ]);
+			ann.runBatch(new Float32Array([ 0, 1, 1, 0 ]));
+			return ann.runAsync([ 1, 1 ])
+				.then(function() {
+					return ann.train(booleanTrainingData, { maxEpochs: 10, desiredError: 0 });
+				})
+				.then(function() {
+					var stats = ann.getStats();
+					expect(stats.run.count).to.equal(2);
+					expect(stats.runQueue.count).to.equal(1);
+					expect(stats.runExecute.count).to.equal(1);
+					expect(stats.trainEpoch.count).to.equal(10);
+					expect(stats.run.p50).to.be.at.most(stats.run.p99);
+					expect(stats.run.p99).to.be.at.most(stats.run.max);
+					expect(stats.trainEpoch.max).to.be.above(0);
+					ann.resetStats();
+					expect(ann.getStats().run.count).to.equal(0);
+					ann.setOption('collectStats', false);
+					expect(ann.getStats()).to.equal(null);
+				});
+		});
+	});
+
 	describe('Testing Data', function() {
 		it('can test set of data', function() {
 			var data = createTrainingData(booleanTrainingData);